@@ -24,6 +24,11 @@ export namespace boost::json
 
     using bj::string_view;
 
+    using bj::storage_ptr;
+    using bj::memory_resource;
+    using bj::monotonic_resource;
+    using bj::make_shared_resource;
+
     using bj::kind;
     using bj::visit;
 
@@ -32,6 +37,7 @@ export namespace boost::json
     using bj::value_from;
 
     using bj::parse;
+    using bj::stream_parser;
     using bj::serialize;
     using bj::serializer;
     using bj::to_string;
@@ -0,0 +1,207 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <format>
+#include <mutex>
+#endif
+
+module lsp_boot.response_cache;
+
+namespace lsp_boot
+{
+	using namespace lsp;
+
+	namespace
+	{
+		auto append_normalized(std::string& out, boost::json::value const& js, bool const is_params) -> void
+		{
+			switch (js.kind())
+			{
+			case boost::json::kind::object:
+			{
+				auto members = std::vector< boost::json::key_value_pair const* >{};
+				members.reserve(js.get_object().size());
+				for (auto const& member : js.get_object())
+				{
+					if (is_params && (member.key() == keys::work_done_token || member.key() == keys::partial_result_token))
+					{
+						continue;
+					}
+					members.push_back(&member);
+				}
+				std::ranges::sort(members, [](auto const lhs, auto const rhs) {
+					return std::string_view{ lhs->key() } < std::string_view{ rhs->key() };
+					});
+
+				out += '{';
+				for (auto const member : members)
+				{
+					out += boost::json::serialize(member->key());
+					out += ':';
+					append_normalized(out, member->value(), false);
+					out += ',';
+				}
+				out += '}';
+				break;
+			}
+			case boost::json::kind::array:
+				out += '[';
+				for (auto const& element : js.get_array())
+				{
+					append_normalized(out, element, false);
+					out += ',';
+				}
+				out += ']';
+				break;
+			default:
+				out += boost::json::serialize(js);
+				break;
+			}
+		}
+
+		// Approximate heap footprint of a DOM.
+		auto json_size(boost::json::value const& js) -> std::size_t
+		{
+			auto size = sizeof(boost::json::value);
+			switch (js.kind())
+			{
+			case boost::json::kind::object:
+				for (auto const& member : js.get_object())
+				{
+					size += sizeof(boost::json::key_value_pair) + member.key().size() + json_size(member.value());
+				}
+				break;
+			case boost::json::kind::array:
+				for (auto const& element : js.get_array())
+				{
+					size += json_size(element);
+				}
+				break;
+			case boost::json::kind::string:
+				size += js.get_string().size();
+				break;
+			default:
+				break;
+			}
+			return size;
+		}
+	}
+
+	auto ResponseCache::make_key(std::string_view const method, std::string_view const uri, std::int64_t const version, lsp::RawMessage const& request) -> Key
+	{
+		auto key = Key{
+			.uri = std::string{ uri },
+			.request = std::format("{}@{}:", method, version),
+		};
+		if (auto const params = request.if_contains(keys::params); params != nullptr)
+		{
+			append_normalized(key.request, *params, true);
+		}
+		auto const hasher = std::hash< std::string_view >{};
+		key.hash = hasher(key.uri) ^ (hasher(key.request) * 31);
+		return key;
+	}
+
+	auto ResponseCache::find(Key const& key) -> std::optional< Response >
+	{
+		auto lock = std::scoped_lock{ mtx };
+		auto const it = index.find(key);
+		if (it == index.end())
+		{
+			return std::nullopt;
+		}
+
+		entries.splice(entries.begin(), entries, it->second);
+		auto const& response = it->second->response;
+		return Response{
+			.json = boost::json::value(response.json, boost::json::storage_ptr{}),
+			.integer_arrays = response.integer_arrays,
+		};
+	}
+
+	auto ResponseCache::insert(Key key, boost::json::value const& json, std::vector< IntegerArrayField > const& integer_arrays) -> void
+	{
+		// The key is held both by the entry and the index.
+		auto size = sizeof(Entry) + 2 * (key.uri.size() + key.request.size()) + json_size(json);
+		for (auto const& field : integer_arrays)
+		{
+			size += sizeof(IntegerArrayField) + field.key.size() + field.values.size() * sizeof(std::uint32_t);
+		}
+		if (size > capacity)
+		{
+			return;
+		}
+
+		auto lock = std::scoped_lock{ mtx };
+		if (auto const existing = index.find(key); existing != index.end())
+		{
+			erase(existing->second);
+		}
+		while (used + size > capacity)
+		{
+			erase(std::prev(entries.end()));
+		}
+
+		entries.push_front(Entry{
+			.key = std::move(key),
+			// Copied out of the result's storage, which may be an arena freed once the response has been written.
+			.response = Response{ boost::json::value(json, boost::json::storage_ptr{}), integer_arrays },
+			.size = size,
+			});
+		index.emplace(entries.front().key, entries.begin());
+		++document_entries[entries.front().key.uri];
+		used += size;
+	}
+
+	auto ResponseCache::invalidate(std::string_view const uri) -> void
+	{
+		auto lock = std::scoped_lock{ mtx };
+		if (!document_entries.contains(uri))
+		{
+			return;
+		}
+		for (auto it = entries.begin(); it != entries.end(); )
+		{
+			auto const next = std::next(it);
+			if (it->key.uri == uri)
+			{
+				erase(it);
+			}
+			it = next;
+		}
+	}
+
+	auto ResponseCache::clear() -> void
+	{
+		auto lock = std::scoped_lock{ mtx };
+		index.clear();
+		entries.clear();
+		document_entries.clear();
+		used = 0;
+	}
+
+	auto ResponseCache::erase(EntryList::iterator const it) -> void
+	{
+		if (auto const document = document_entries.find(it->key.uri); document != document_entries.end() && --document->second == 0)
+		{
+			document_entries.erase(document);
+		}
+		index.erase(it->key);
+		used -= it->size;
+		entries.erase(it);
+	}
+}
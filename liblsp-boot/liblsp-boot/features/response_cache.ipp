@@ -0,0 +1,113 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#endif
+
+export module lsp_boot.response_cache;
+
+import lsp_boot.lsp;
+import lsp_boot.work_queue;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	/**
+	 * Successful responses to requests on open documents, keyed by method, document URI and version, and the request's params,
+	 * so that a request repeated while the document is unchanged can be answered without involving the implementation.
+	 * Bounded by an approximate memory budget, least recently used entries being evicted first. Safe to use from multiple threads.
+	 */
+	export class ResponseCache
+	{
+	public:
+		struct Key
+		{
+			std::string uri;
+			// Method, document version and normalized params.
+			std::string request;
+			std::size_t hash;
+
+			auto operator== (Key const& rhs) const -> bool = default;
+		};
+
+		struct Response
+		{
+			boost::json::value json;
+			std::vector< IntegerArrayField > integer_arrays;
+		};
+
+		explicit ResponseCache(std::size_t capacity_bytes) : capacity{ capacity_bytes }
+		{
+		}
+
+		/**
+		 * Params are normalized by ordering object members by key, and dropping the progress tokens, which don't affect the result.
+		 */
+		static auto make_key(std::string_view method, std::string_view uri, std::int64_t version, lsp::RawMessage const& request) -> Key;
+
+		/**
+		 * Copy of the cached response, in default storage.
+		 */
+		auto find(Key const& key) -> std::optional< Response >;
+
+		/**
+		 * Caches a copy of response, unless on its own it exceeds the budget.
+		 */
+		auto insert(Key key, boost::json::value const& json, std::vector< IntegerArrayField > const& integer_arrays) -> void;
+
+		/**
+		 * Drops all entries for the given document, regardless of version.
+		 */
+		auto invalidate(std::string_view uri) -> void;
+		auto clear() -> void;
+
+		auto size_bytes() const -> std::size_t
+		{
+			auto lock = std::scoped_lock{ mtx };
+			return used;
+		}
+
+	private:
+		struct KeyHash
+		{
+			auto operator() (Key const& key) const -> std::size_t
+			{
+				return key.hash;
+			}
+		};
+
+		struct Entry
+		{
+			Key key;
+			Response response;
+			std::size_t size;
+		};
+
+		using EntryList = std::list< Entry >;
+
+		auto erase(EntryList::iterator it) -> void;
+
+	private:
+		std::size_t capacity;
+		mutable std::mutex mtx;
+		// Most recently used first.
+		EntryList entries;
+		std::unordered_map< Key, EntryList::iterator, KeyHash > index;
+		// Number of entries per document, allowing invalidation of documents with nothing cached to skip the scan of all entries.
+		std::map< std::string, std::size_t, std::less<> > document_entries;
+		std::size_t used = 0;
+	};
+}
@@ -0,0 +1,170 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <mutex>
+#endif
+
+module lsp_boot.semantic_tokens;
+
+namespace lsp_boot
+{
+	using namespace lsp;
+
+	namespace
+	{
+		// Data is compared in blocks via memcmp, which is implemented with wide vector compares, before finishing element-wise.
+		constexpr std::size_t compare_block_size = 16;
+		constexpr std::size_t compare_block_bytes = compare_block_size * sizeof(std::uint32_t);
+
+		auto common_prefix_length(std::span< std::uint32_t const > const a, std::span< std::uint32_t const > const b) -> std::size_t
+		{
+			auto const limit = std::min(a.size(), b.size());
+			std::size_t length = 0;
+			while (length + compare_block_size <= limit && std::memcmp(a.data() + length, b.data() + length, compare_block_bytes) == 0)
+			{
+				length += compare_block_size;
+			}
+			while (length < limit && a[length] == b[length])
+			{
+				++length;
+			}
+			return length;
+		}
+
+		auto common_suffix_length(std::span< std::uint32_t const > const a, std::span< std::uint32_t const > const b, std::size_t const limit) -> std::size_t
+		{
+			auto const a_end = a.data() + a.size();
+			auto const b_end = b.data() + b.size();
+			std::size_t length = 0;
+			while (length + compare_block_size <= limit
+				&& std::memcmp(a_end - length - compare_block_size, b_end - length - compare_block_size, compare_block_bytes) == 0)
+			{
+				length += compare_block_size;
+			}
+			while (length < limit && *(a_end - length - 1) == *(b_end - length - 1))
+			{
+				++length;
+			}
+			return length;
+		}
+
+		auto decode_token_data(boost::json::array const& data_js) -> std::optional< std::vector< std::uint32_t > >
+		{
+			auto data = std::vector< std::uint32_t >{};
+			data.reserve(data_js.size());
+			for (auto const& value : data_js)
+			{
+				if (value.is_uint64())
+				{
+					data.push_back(static_cast< std::uint32_t >(value.get_uint64()));
+				}
+				else if (value.is_int64())
+				{
+					data.push_back(static_cast< std::uint32_t >(value.get_int64()));
+				}
+				else
+				{
+					return std::nullopt;
+				}
+			}
+			return data;
+		}
+	}
+
+	auto diff_semantic_tokens(std::span< std::uint32_t const > const previous, std::span< std::uint32_t const > const current) -> std::optional< SemanticTokensEdit >
+	{
+		auto const prefix = common_prefix_length(previous, current);
+		if (prefix == previous.size() && prefix == current.size())
+		{
+			return std::nullopt;
+		}
+
+		auto const suffix = common_suffix_length(previous, current, std::min(previous.size(), current.size()) - prefix);
+		return SemanticTokensEdit{
+			.start = prefix,
+			.delete_count = previous.size() - prefix - suffix,
+			.data = current.subspan(prefix, current.size() - prefix - suffix),
+		};
+	}
+
+	auto SemanticTokensCache::process_result(
+		std::string_view const uri,
+		std::optional< std::string_view > const previous_result_id,
+		boost::json::object& result,
+		std::vector< IntegerArrayField >& integer_arrays) -> void
+	{
+		auto const data_field = std::ranges::find(integer_arrays, keys::data, &IntegerArrayField::key);
+		auto data = std::optional< std::vector< std::uint32_t > >{};
+		if (data_field != integer_arrays.end())
+		{
+			data = data_field->values;
+		}
+		else if (auto const data_js = result.if_contains(keys::data); data_js != nullptr && data_js->is_array())
+		{
+			data = decode_token_data(data_js->get_array());
+		}
+		if (!data)
+		{
+			return;
+		}
+
+		auto result_id = std::string{};
+		auto previous = std::optional< Entry >{};
+		{
+			auto lock = std::scoped_lock{ mtx };
+			result_id = std::to_string(next_result_id++);
+			if (auto const it = entries.find(uri); it != entries.end() && previous_result_id == it->second.result_id)
+			{
+				previous = std::move(it->second);
+			}
+		}
+
+		if (previous)
+		{
+			auto edits = boost::json::array{};
+			if (auto const edit = diff_semantic_tokens(previous->data, *data); edit)
+			{
+				edits.push_back(boost::json::object{
+					{ keys::start, edit->start },
+					{ keys::delete_count, edit->delete_count },
+					{ keys::data, boost::json::array(edit->data.begin(), edit->data.end()) },
+					});
+			}
+			if (data_field != integer_arrays.end())
+			{
+				integer_arrays.erase(data_field);
+			}
+			else
+			{
+				result.erase(keys::data);
+			}
+			result[keys::edits] = std::move(edits);
+		}
+		result[keys::result_id] = result_id;
+
+		auto lock = std::scoped_lock{ mtx };
+		entries.insert_or_assign(std::string{ uri }, Entry{ std::move(result_id), std::move(*data) });
+	}
+
+	auto SemanticTokensCache::erase(std::string_view const uri) -> void
+	{
+		auto lock = std::scoped_lock{ mtx };
+		if (auto const it = entries.find(uri); it != entries.end())
+		{
+			entries.erase(it);
+		}
+	}
+}
@@ -5,16 +5,27 @@ module;
 import std;
 #else
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <array>
 #include <vector>
+#include <span>
+#include <map>
+#include <functional>
 #include <ranges>
 #include <algorithm>
+#include <mutex>
+#include <thread>
 #endif
 
 export module lsp_boot.semantic_tokens;
 
 import lsp_boot.lsp;
+import lsp_boot.work_queue;
+import lsp_boot.ext_mod_wrap.boost.json;
 
 namespace lsp_boot
 {
@@ -34,36 +45,160 @@ namespace lsp_boot
 		return encode_semantic_token_modifiers(std::array{ modifiers... });
 	}
 
+	namespace detail
+	{
+		/**
+		 * Encodes tokens [begin, end) to out. Each token's encoding depends only on itself and its predecessor, so there's no loop carried dependency
+		 * and separate ranges of tokens may be encoded independently.
+		 */
+		auto encode_semantic_token_range(std::ranges::random_access_range auto const& tokens, std::size_t const begin, std::size_t const end, std::uint32_t* out) -> void
+		{
+			for (auto i = begin; i < end; ++i, out += 5)
+			{
+				auto const& [line_index, char_offset, len, stt, mods] = tokens[i];
+				std::uint32_t prev_line = 0;
+				std::uint32_t prev_offset = 0;
+				if (i > 0)
+				{
+					[[maybe_unused]] auto const& [prev_line_index, prev_char_offset, prev_len, prev_stt, prev_mods] = tokens[i - 1];
+					prev_line = std::uint32_t(prev_line_index);
+					prev_offset = std::uint32_t(prev_char_offset);
+				}
+
+				auto const line_delta = std::uint32_t(line_index) - prev_line;
+				out[0] = line_delta; // line delta
+				out[1] = line_delta > 0 ? std::uint32_t(char_offset) : std::uint32_t(char_offset) - prev_offset; // char delta
+				out[2] = std::uint32_t(len); // token length
+				out[3] = std::uint32_t(stt); // token type index
+				out[4] = std::uint32_t(mods); // modifiers mask
+			}
+		}
+	}
+
 	/**
 	 * @tokens Range of tuples (line_index, character_offset, length, semantic_token_type, semantic_token_modifiers), with the character offset being relative to the start of the line.
 	 * @return Tokens encoded as a vector of unsigned integers, as per LSP TokenFormat.relative (https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#textDocument_semanticTokens).
+	 * Suitable for returning directly via Server::RequestSuccessResult::integer_arrays.
 	 */
-	export auto generate_semantic_token_deltas(std::ranges::sized_range auto&& tokens) -> std::vector< unsigned int >
+	export auto generate_semantic_token_deltas(std::ranges::sized_range auto&& tokens) -> std::vector< std::uint32_t >
 	{
-		std::vector< unsigned int > tokens_data;
-		tokens_data.reserve(std::ranges::size(tokens) * 5);
-
-		unsigned int prev_line = 0;
-		unsigned int prev_offset = 0;
-		for (auto const& [line_index, char_offset, len, stt, mods] : tokens)
+		std::vector< std::uint32_t > tokens_data;
+		if constexpr (std::ranges::random_access_range< decltype(tokens) >)
 		{
-			auto const line_delta = unsigned(line_index - prev_line);
-			bool const is_new_line = line_delta > 0;
-			unsigned const char_delta = is_new_line ? char_offset : (char_offset - prev_offset);
-			tokens_data.append_range(std::array< unsigned int, 5 >{
-				line_delta, // line delta
-				char_delta, // char delta
-				unsigned(len), // token length
-				unsigned(stt), // token type index
-				unsigned(mods), // modifiers mask
-			});
-			if (is_new_line)
+			tokens_data.resize(std::ranges::size(tokens) * 5);
+			detail::encode_semantic_token_range(tokens, 0, std::ranges::size(tokens), tokens_data.data());
+		}
+		else
+		{
+			tokens_data.reserve(std::ranges::size(tokens) * 5);
+
+			std::uint32_t prev_line = 0;
+			std::uint32_t prev_offset = 0;
+			for (auto const& [line_index, char_offset, len, stt, mods] : tokens)
 			{
-				prev_line = line_index;
+				auto const line_delta = std::uint32_t(line_index - prev_line);
+				bool const is_new_line = line_delta > 0;
+				std::uint32_t const char_delta = is_new_line ? char_offset : (char_offset - prev_offset);
+				tokens_data.append_range(std::array< std::uint32_t, 5 >{
+					line_delta, // line delta
+					char_delta, // char delta
+					std::uint32_t(len), // token length
+					std::uint32_t(stt), // token type index
+					std::uint32_t(mods), // modifiers mask
+				});
+				if (is_new_line)
+				{
+					prev_line = line_index;
+				}
+				prev_offset = char_offset;
 			}
-			prev_offset = char_offset;
 		}
 
 		return tokens_data;
 	}
+
+	/**
+	 * As generate_semantic_token_deltas, with the encoding of large inputs split across up to max_threads threads (including the calling thread).
+	 * Inputs of less than min_tokens_per_thread tokens are encoded on the calling thread.
+	 */
+	export auto generate_semantic_token_deltas_parallel(
+		std::ranges::random_access_range auto&& tokens,
+		std::size_t const max_threads = std::thread::hardware_concurrency(),
+		std::size_t const min_tokens_per_thread = 64 * 1024) -> std::vector< std::uint32_t >
+	{
+		auto const token_count = std::size_t(std::ranges::size(tokens));
+		auto tokens_data = std::vector< std::uint32_t >(token_count * 5);
+
+		auto const thread_count = std::clamp< std::size_t >(token_count / std::max< std::size_t >(min_tokens_per_thread, 1), 1, std::max< std::size_t >(max_threads, 1));
+		auto const tokens_per_thread = (token_count + thread_count - 1) / thread_count;
+		auto const encode_chunk = [&](std::size_t const chunk) {
+			auto const begin = std::min(chunk * tokens_per_thread, token_count);
+			auto const end = std::min(begin + tokens_per_thread, token_count);
+			detail::encode_semantic_token_range(tokens, begin, end, tokens_data.data() + begin * 5);
+			};
+
+		auto helpers = std::vector< std::thread >{};
+		helpers.reserve(thread_count - 1);
+		for (std::size_t chunk = 1; chunk < thread_count; ++chunk)
+		{
+			helpers.emplace_back(encode_chunk, chunk);
+		}
+		encode_chunk(0);
+		for (auto& helper : helpers)
+		{
+			helper.join();
+		}
+
+		return tokens_data;
+	}
+
+	/**
+	 * Single edit transforming one encoded token array into another, as per LSP SemanticTokensEdit.
+	 */
+	export struct SemanticTokensEdit
+	{
+		std::size_t start;
+		std::size_t delete_count;
+		std::span< std::uint32_t const > data;
+	};
+
+	/**
+	 * Minimal single edit transforming previous into current, found by trimming their common prefix and suffix, or std::nullopt if they're equal.
+	 * The returned data refers into current.
+	 */
+	export auto diff_semantic_tokens(std::span< std::uint32_t const > previous, std::span< std::uint32_t const > current) -> std::optional< SemanticTokensEdit >;
+
+	/**
+	 * Server side record of the token data last sent for each document, allowing textDocument/semanticTokens/full/delta requests to be answered
+	 * with just the edits since the client's previous result. Safe to use from multiple threads, though requests for a given document are assumed
+	 * not to be processed concurrently.
+	 */
+	export class SemanticTokensCache
+	{
+	public:
+		/**
+		 * Takes the result of a full or full/delta request for uri, holding the complete token data, and caches that data under a newly assigned resultId.
+		 * The data may be held either in result, or in integer_arrays (see Server::RequestSuccessResult).
+		 * If previous_result_id identifies the data currently cached for uri, the data is replaced by the edits from the previous data.
+		 * Results not holding a data array are left untouched.
+		 */
+		auto process_result(
+			std::string_view uri,
+			std::optional< std::string_view > previous_result_id,
+			boost::json::object& result,
+			std::vector< IntegerArrayField >& integer_arrays) -> void;
+
+		auto erase(std::string_view uri) -> void;
+
+	private:
+		struct Entry
+		{
+			std::string result_id;
+			std::vector< std::uint32_t > data;
+		};
+
+		std::mutex mtx;
+		std::map< std::string, Entry, std::less<> > entries;
+		std::uint64_t next_result_id = 1;
+	};
 }
@@ -0,0 +1,299 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <exception>
+#include <format>
+#include <map>
+#include <mutex>
+#endif
+
+module lsp_boot.background_tasks;
+
+import lsp_boot.lsp;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	struct BackgroundJob::State
+	{
+		enum class ProgressState : std::uint8_t
+		{
+			none,
+			awaiting_token,
+			begun,
+			ended,
+		};
+
+		State(BackgroundScheduler& job_scheduler, BackgroundTaskOptions job_options, std::string job_title, WorkDoneProgress job_progress)
+			: scheduler{ job_scheduler }, options{ std::move(job_options) }, title{ std::move(job_title) }, progress{ std::move(job_progress) },
+			progress_state{ progress.is_active() ? ProgressState::awaiting_token : ProgressState::none }
+		{
+		}
+
+		// Held by each submitted task, counting it as completed once run, skipped or discarded.
+		struct Completion
+		{
+			std::shared_ptr< State > state;
+
+			~Completion()
+			{
+				state->complete_task();
+			}
+		};
+
+		auto add_task() -> void
+		{
+			auto lock = std::scoped_lock{ mtx };
+			++submitted;
+		}
+
+		auto complete_task() -> void
+		{
+			auto lock = std::scoped_lock{ mtx };
+			++completed;
+			update_progress();
+		}
+
+		auto finish() -> void
+		{
+			auto lock = std::scoped_lock{ mtx };
+			finished = true;
+			update_progress();
+		}
+
+		auto token_response(bool const accepted) -> void
+		{
+			auto lock = std::scoped_lock{ mtx };
+			if (progress_state != ProgressState::awaiting_token)
+			{
+				return;
+			}
+			if (!accepted)
+			{
+				progress_state = ProgressState::none;
+				return;
+			}
+
+			progress_state = ProgressState::begun;
+			reported_percentage = percentage();
+			progress.begin(title, reported_percentage);
+			update_progress();
+		}
+
+		// Percentage of the tasks submitted so far.
+		auto percentage() const -> std::uint32_t
+		{
+			return submitted > 0 ? std::uint32_t(completed * 100 / submitted) : 0;
+		}
+
+		// Called with the lock held, keeping notifications in order.
+		auto update_progress() -> void
+		{
+			if (progress_state != ProgressState::begun)
+			{
+				return;
+			}
+			if (finished && completed == submitted)
+			{
+				progress.end();
+				progress_state = ProgressState::ended;
+				return;
+			}
+			// Not allowed to go backwards as further tasks are submitted.
+			if (auto const current = percentage(); current > reported_percentage)
+			{
+				reported_percentage = current;
+				progress.report(current);
+			}
+		}
+
+		BackgroundScheduler& scheduler;
+		BackgroundTaskOptions options;
+		std::string title;
+		WorkDoneProgress progress;
+
+		std::mutex mtx;
+		ProgressState progress_state;
+		std::size_t submitted = 0;
+		std::size_t completed = 0;
+		std::uint32_t reported_percentage = 0;
+		bool finished = false;
+	};
+
+	auto BackgroundJob::operator= (BackgroundJob&& rhs) -> BackgroundJob&
+	{
+		if (this != &rhs)
+		{
+			finish();
+			state = std::move(rhs.state);
+		}
+		return *this;
+	}
+
+	BackgroundJob::~BackgroundJob()
+	{
+		finish();
+	}
+
+	auto BackgroundJob::submit(BackgroundTask task) const -> void
+	{
+		if (!state)
+		{
+			return;
+		}
+
+		state->add_task();
+		auto completion = std::make_shared< State::Completion >(state);
+		state->scheduler.submit([completion = std::move(completion), task = std::move(task)](BackgroundTaskContext const& context) {
+			task(context);
+			}, state->options);
+	}
+
+	auto BackgroundJob::finish() -> void
+	{
+		if (state)
+		{
+			state->finish();
+			state.reset();
+		}
+	}
+
+	BackgroundScheduler::BackgroundScheduler(std::size_t const worker_count, OutputQueue& output_queue, ErrorHandler on_error)
+		: out_queue{ output_queue }, report_error{ std::move(on_error) }
+	{
+		if (worker_count > 0)
+		{
+			pool = std::make_unique< WorkStealingPool >(worker_count);
+		}
+	}
+
+	BackgroundScheduler::~BackgroundScheduler()
+	{
+		// The pool, destroyed first of the members, then waits for running tasks.
+		auto lock = std::scoped_lock{ mtx };
+		shutdown_source.cancel();
+		for (auto const& [uri, source] : document_sources)
+		{
+			source.cancel();
+		}
+	}
+
+	auto BackgroundScheduler::task_token(std::string_view const document) -> CancellationToken
+	{
+		auto lock = std::scoped_lock{ mtx };
+		if (document.empty())
+		{
+			return shutdown_source.token();
+		}
+		auto it = document_sources.find(document);
+		if (it == document_sources.end())
+		{
+			it = document_sources.emplace(std::string{ document }, CancellationSource{}).first;
+		}
+		return it->second.token();
+	}
+
+	auto BackgroundScheduler::submit(BackgroundTask task, BackgroundTaskOptions const& options) -> void
+	{
+		auto run = [this, task = std::move(task), token = task_token(options.document)] {
+			if (token.is_cancelled())
+			{
+				return;
+			}
+			try
+			{
+				task(BackgroundTaskContext{ token, pool.get() });
+			}
+			catch (std::exception const& e)
+			{
+				report_error(std::format("Unhandled exception in background task: {}", e.what()));
+			}
+			catch (...)
+			{
+				report_error("Unhandled exception in background task");
+			}
+			};
+
+		if (pool)
+		{
+			pool->submit(std::move(run), options.priority);
+		}
+		else
+		{
+			run();
+		}
+	}
+
+	auto BackgroundScheduler::start_job(std::string_view const title, BackgroundTaskOptions options) -> BackgroundJob
+	{
+		if (!progress_enabled.load(std::memory_order_relaxed))
+		{
+			return BackgroundJob{ std::make_shared< BackgroundJob::State >(*this, std::move(options), std::string{ title }, WorkDoneProgress{}) };
+		}
+
+		// The request id doubles as the token.
+		auto const id = std::format("lsp-boot/background/{}", next_progress_id.fetch_add(1, std::memory_order_relaxed));
+		auto const token = boost::json::value(id);
+		auto state = std::make_shared< BackgroundJob::State >(*this, std::move(options), std::string{ title }, WorkDoneProgress::for_server_token(out_queue, token));
+		{
+			auto lock = std::scoped_lock{ mtx };
+			// Clients needn't respond before the job completes, or at all.
+			std::erase_if(progress_requests, [](auto const& request) {
+				return request.second.expired();
+				});
+			progress_requests.emplace(id, state);
+		}
+
+		out_queue.push(lsp::RawMessage{
+			{ "jsonrpc", "2.0" },
+			{ lsp::keys::id, token },
+			{ lsp::keys::method, lsp::requests::WorkDoneProgressCreate::name },
+			{ lsp::keys::params, boost::json::object{
+				{ lsp::keys::token, token },
+				} },
+			});
+		return BackgroundJob{ std::move(state) };
+	}
+
+	auto BackgroundScheduler::handle_progress_response(std::string_view const id, bool const accepted) -> bool
+	{
+		auto job = std::weak_ptr< BackgroundJob::State >{};
+		{
+			auto lock = std::scoped_lock{ mtx };
+			auto const it = progress_requests.find(id);
+			if (it == progress_requests.end())
+			{
+				return false;
+			}
+			job = std::move(it->second);
+			progress_requests.erase(it);
+		}
+
+		// Gone if the job has completed in the meantime.
+		if (auto const state = job.lock())
+		{
+			state->token_response(accepted);
+		}
+		return true;
+	}
+
+	auto BackgroundScheduler::cancel_document(std::string_view const uri) -> void
+	{
+		auto lock = std::scoped_lock{ mtx };
+		if (auto const it = document_sources.find(uri); it != document_sources.end())
+		{
+			it->second.cancel();
+			document_sources.erase(it);
+		}
+	}
+}
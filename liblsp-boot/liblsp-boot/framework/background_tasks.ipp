@@ -0,0 +1,195 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <atomic>
+#endif
+
+export module lsp_boot.background_tasks;
+
+import lsp_boot.work_queue;
+import lsp_boot.cancellation;
+import lsp_boot.progress;
+export import lsp_boot.work_stealing_pool;
+
+namespace lsp_boot
+{
+	export struct BackgroundTaskOptions
+	{
+		TaskPriority priority = TaskPriority::normal;
+
+		/**
+		 * If set, the task is cancelled when this document is changed or closed: skipped if not yet started, and otherwise signalled through
+		 * its cancellation token.
+		 */
+		std::string document;
+	};
+
+	export class BackgroundTaskContext
+	{
+	public:
+		BackgroundTaskContext(CancellationToken task_token, WorkStealingPool const* task_pool) : token{ std::move(task_token) }, pool{ task_pool }
+		{
+		}
+
+		auto cancellation_token() const -> CancellationToken const&
+		{
+			return token;
+		}
+
+		auto is_cancelled() const -> bool
+		{
+			return token.is_cancelled();
+		}
+
+		/**
+		 * Whether a request is currently being handled. Long running tasks should check periodically, and if so resubmit their remaining work
+		 * and return, freeing the core for the request. Low priority tasks are in addition not started until no request is being handled.
+		 */
+		auto should_yield() const -> bool
+		{
+			return pool != nullptr && pool->foreground_busy();
+		}
+
+	private:
+		CancellationToken token;
+		WorkStealingPool const* pool;
+	};
+
+	export using BackgroundTask = std::function< void(BackgroundTaskContext const&) >;
+
+	export class BackgroundScheduler;
+
+	/**
+	 * Group of background tasks whose progress is reported to the client as a whole, as the proportion of the job's tasks completed.
+	 * The job is finished by calling finish(), or destroying the handle, after which its progress ends once all its tasks are done.
+	 */
+	export class BackgroundJob
+	{
+	public:
+		BackgroundJob() = default;
+		BackgroundJob(BackgroundJob&&) = default;
+		auto operator= (BackgroundJob&& rhs) -> BackgroundJob&;
+		~BackgroundJob();
+
+		/**
+		 * Tasks run with the job's options. Has no effect once the job is finished.
+		 */
+		auto submit(BackgroundTask task) const -> void;
+		auto finish() -> void;
+
+	private:
+		friend class BackgroundScheduler;
+
+		struct State;
+
+		explicit BackgroundJob(std::shared_ptr< State > job_state) : state{ std::move(job_state) }
+		{
+		}
+
+		std::shared_ptr< State > state;
+	};
+
+	/**
+	 * Runs the implementation's background work (eg. indexing a workspace) on a work stealing pool owned by the server, alongside request handling.
+	 * Tasks can be tied to a document, so that they're cancelled when it changes, and grouped into jobs reported to the client as work done progress.
+	 */
+	export class BackgroundScheduler
+	{
+	public:
+		using ErrorHandler = std::function< void(std::string_view) >;
+
+		/**
+		 * With 0 workers, tasks are run synchronously on the submitting thread.
+		 * on_error is invoked with a description of any exception escaping a task, on the thread that ran it.
+		 */
+		BackgroundScheduler(std::size_t worker_count, OutputQueue& output_queue, ErrorHandler on_error);
+
+		/**
+		 * Cancels all tasks, waiting for those running to return. Tasks not yet started are discarded.
+		 */
+		~BackgroundScheduler();
+
+		BackgroundScheduler(BackgroundScheduler const&) = delete;
+		auto operator= (BackgroundScheduler const&) -> BackgroundScheduler& = delete;
+
+		/**
+		 * May be called from any thread, including from within a task, in which case the task is queued on the same worker.
+		 */
+		auto submit(BackgroundTask task, BackgroundTaskOptions const& options = {}) -> void;
+
+		/**
+		 * If the client supports it (see enable_progress), requests creation of a progress token with window/workDoneProgress/create.
+		 * Work done progress with the given title begins once the client accepts the token (see handle_progress_response), and is dropped
+		 * if it's rejected. Nothing is reported for a job completed before then.
+		 */
+		auto start_job(std::string_view title, BackgroundTaskOptions options = {}) -> BackgroundJob;
+
+		/**
+		 * To be passed the client's responses to requests made by the server.
+		 * @return Whether id is that of a window/workDoneProgress/create request made for a job.
+		 */
+		auto handle_progress_response(std::string_view id, bool accepted) -> bool;
+
+		/**
+		 * Cancels all tasks tied to the document. Tasks subsequently submitted for it are unaffected.
+		 */
+		auto cancel_document(std::string_view uri) -> void;
+
+		/**
+		 * Whether the client declared support for server initiated progress (the window.workDoneProgress client capability).
+		 */
+		auto enable_progress(bool enable) -> void
+		{
+			progress_enabled.store(enable, std::memory_order_relaxed);
+		}
+
+		/**
+		 * See WorkStealingPool::enter_foreground.
+		 */
+		auto enter_foreground() -> void
+		{
+			if (pool)
+			{
+				pool->enter_foreground();
+			}
+		}
+
+		auto leave_foreground() -> void
+		{
+			if (pool)
+			{
+				pool->leave_foreground();
+			}
+		}
+
+	private:
+		auto task_token(std::string_view document) -> CancellationToken;
+
+	private:
+		OutputQueue& out_queue;
+		ErrorHandler report_error;
+		std::atomic< bool > progress_enabled = false;
+		std::atomic< std::uint64_t > next_progress_id = 1;
+
+		std::mutex mtx;
+		// Sources are replaced on cancellation, so that tasks submitted afterwards are unaffected.
+		std::map< std::string, CancellationSource, std::less<> > document_sources;
+		CancellationSource shutdown_source;
+		// Jobs awaiting the client's response to the creation of their progress token, by request id.
+		std::map< std::string, std::weak_ptr< BackgroundJob::State >, std::less<> > progress_requests;
+
+		// Declared last, so that workers are stopped before anything they use is destroyed. Not reset explicitly, as running tasks read it.
+		std::unique_ptr< WorkStealingPool > pool;
+	};
+}
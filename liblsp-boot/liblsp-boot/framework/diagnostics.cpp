@@ -0,0 +1,246 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <variant>
+#include <span>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#endif
+
+module lsp_boot.diagnostics;
+
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	namespace
+	{
+		auto hash_diagnostics(std::vector< lsp::Diagnostic > const& diagnostics) -> std::uint64_t
+		{
+			// FNV-1a style mixing of the members' values and string hashes.
+			auto hash = std::uint64_t{ 14695981039346656037ull };
+			auto const mix = [&](std::uint64_t const value) {
+				hash = (hash ^ value) * 1099511628211ull;
+				};
+			auto const string_hash = std::hash< std::string_view >{};
+			for (auto const& diagnostic : diagnostics)
+			{
+				mix(diagnostic.range.start.line);
+				mix(diagnostic.range.start.character);
+				mix(diagnostic.range.end.line);
+				mix(diagnostic.range.end.character);
+				mix(std::uint64_t(diagnostic.severity));
+				mix(string_hash(diagnostic.message));
+				mix(string_hash(diagnostic.source));
+				mix(diagnostic.code.index());
+				if (auto const integer_code = std::get_if< std::int32_t >(&diagnostic.code))
+				{
+					mix(std::uint64_t(*integer_code));
+				}
+				else if (auto const string_code = std::get_if< std::string >(&diagnostic.code))
+				{
+					mix(string_hash(*string_code));
+				}
+				mix(string_hash(diagnostic.code_description));
+				mix(diagnostic.tags.size());
+				for (auto const tag : diagnostic.tags)
+				{
+					mix(std::uint64_t(tag));
+				}
+				mix(diagnostic.related_information.size());
+				for (auto const& related : diagnostic.related_information)
+				{
+					mix(string_hash(related.uri));
+					mix(related.range.start.line);
+					mix(related.range.start.character);
+					mix(related.range.end.line);
+					mix(related.range.end.character);
+					mix(string_hash(related.message));
+				}
+				// Rarely present, so simply hashed in serialized form.
+				if (!diagnostic.data.is_null())
+				{
+					mix(string_hash(boost::json::serialize(diagnostic.data)));
+				}
+			}
+			return hash;
+		}
+
+		auto make_notification(std::string_view const uri, std::optional< std::int64_t > const version, std::vector< lsp::Diagnostic > const& diagnostics)
+			-> lsp::RawMessage
+		{
+			auto diagnostics_js = boost::json::array{};
+			diagnostics_js.reserve(diagnostics.size());
+			for (auto const& diagnostic : diagnostics)
+			{
+				diagnostics_js.push_back(boost::json::value(diagnostic));
+			}
+
+			auto params = boost::json::object{
+				{ lsp::keys::uri, uri },
+				{ lsp::keys::diagnostics, std::move(diagnostics_js) },
+			};
+			if (version)
+			{
+				params[lsp::keys::version] = *version;
+			}
+			return {
+				{ "jsonrpc", "2.0" },
+				{ lsp::keys::method, lsp::notifications::PublishDiagnostics::name },
+				{ lsp::keys::params, std::move(params) },
+			};
+		}
+	}
+
+	DiagnosticsPublisher::DiagnosticsPublisher(OutputQueue& output_queue, DiagnosticsOptions const publish_options)
+		: out_queue{ output_queue }, options{ publish_options }
+	{
+		sender = std::thread([this] { run(); });
+	}
+
+	DiagnosticsPublisher::~DiagnosticsPublisher()
+	{
+		{
+			auto lock = std::scoped_lock{ mtx };
+			stopping = true;
+		}
+		cvar.notify_one();
+		sender.join();
+	}
+
+	auto DiagnosticsPublisher::publish(std::string_view const uri, std::optional< std::int64_t > const version, std::vector< lsp::Diagnostic > diagnostics) -> void
+	{
+		auto const hash = hash_diagnostics(diagnostics);
+		auto const now = std::chrono::steady_clock::now();
+
+		auto lock = std::scoped_lock{ mtx };
+		auto it = documents.find(uri);
+		if (it == documents.end())
+		{
+			it = documents.emplace(std::string{ uri }, DocumentState{}).first;
+		}
+		auto& document = it->second;
+
+		// Either this update supersedes one still pending, or it's what the client already has; if both, it's counted once.
+		auto const unchanged = document.sent_hash == hash && document.sent == diagnostics;
+		if (document.pending || unchanged)
+		{
+			suppressed.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (unchanged)
+		{
+			document.pending.reset();
+			return;
+		}
+
+		auto const deadline = document.pending ? document.pending->deadline : now + options.max_delay;
+		document.pending = PendingUpdate{
+			.version = version,
+			.diagnostics = std::move(diagnostics),
+			.hash = hash,
+			.due = std::min(now + options.debounce, deadline),
+			.deadline = deadline,
+		};
+		cvar.notify_one();
+	}
+
+	auto DiagnosticsPublisher::forget(std::string_view const uri) -> void
+	{
+		auto lock = std::scoped_lock{ mtx };
+		if (auto const it = documents.find(uri); it != documents.end())
+		{
+			documents.erase(it);
+		}
+	}
+
+	auto DiagnosticsPublisher::run() -> void
+	{
+		using Clock = std::chrono::steady_clock;
+
+		struct DueDocument
+		{
+			Clock::time_point due;
+			std::string const* uri;
+			DocumentState* state;
+		};
+
+		auto due_documents = std::vector< DueDocument >{};
+		auto notifications = std::vector< lsp::RawMessage >{};
+
+		auto lock = std::unique_lock{ mtx };
+		while (!stopping)
+		{
+			auto const now = Clock::now();
+			auto next_due = Clock::time_point::max();
+			due_documents.clear();
+			for (auto& [uri, document] : documents)
+			{
+				if (!document.pending)
+				{
+					continue;
+				}
+				if (document.pending->due <= now)
+				{
+					due_documents.push_back({ document.pending->due, &uri, &document });
+				}
+				else
+				{
+					next_due = std::min(next_due, document.pending->due);
+				}
+			}
+
+			if (due_documents.empty())
+			{
+				if (next_due == Clock::time_point::max())
+				{
+					cvar.wait(lock);
+				}
+				else
+				{
+					cvar.wait_until(lock, next_due);
+				}
+				continue;
+			}
+
+			// Longest waiting first; whatever exceeds this burst goes out after the pacing interval.
+			auto const burst_size = std::min(due_documents.size(), std::max< std::size_t >(options.max_burst, 1));
+			std::ranges::partial_sort(due_documents, due_documents.begin() + std::ptrdiff_t(burst_size), std::ranges::less{}, &DueDocument::due);
+			for (auto const& document : std::span(due_documents).first(burst_size))
+			{
+				auto& pending = *document.state->pending;
+				notifications.push_back(make_notification(*document.uri, pending.version, pending.diagnostics));
+				document.state->sent_hash = pending.hash;
+				document.state->sent = std::move(pending.diagnostics);
+				document.state->pending.reset();
+			}
+
+			lock.unlock();
+			for (auto& notification : notifications)
+			{
+				out_queue.push(std::move(notification));
+			}
+			published.fetch_add(notifications.size(), std::memory_order_relaxed);
+			notifications.clear();
+			lock.lock();
+
+			if (due_documents.size() > burst_size)
+			{
+				cvar.wait_until(lock, Clock::now() + options.pace_interval, [this] { return stopping; });
+			}
+		}
+	}
+}
@@ -0,0 +1,114 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#endif
+
+export module lsp_boot.diagnostics;
+
+import lsp_boot.lsp;
+import lsp_boot.work_queue;
+
+namespace lsp_boot
+{
+	export struct DiagnosticsOptions
+	{
+		/**
+		 * How long a document's diagnostics must go without being updated before they're sent. Each update restarts the wait, though a document's
+		 * diagnostics are never held back for longer than max_delay after the first update since they were last sent.
+		 */
+		std::chrono::milliseconds debounce{ 50 };
+		std::chrono::milliseconds max_delay{ 500 };
+
+		/**
+		 * At most max_burst documents' diagnostics are queued for output per pace_interval, so that a burst of updates across many documents
+		 * is interleaved with responses to requests, rather than queued ahead of them.
+		 */
+		std::size_t max_burst = 8;
+		std::chrono::milliseconds pace_interval{ 5 };
+	};
+
+	/**
+	 * Sends textDocument/publishDiagnostics notifications on behalf of the implementation (see ServerImplAPI::publish_diagnostics).
+	 * The last set sent for each document is kept, along with its hash, so that re-analysis producing an unchanged set sends nothing.
+	 * Updates are held for a short time and only the latest set for a document is sent; sending happens on a dedicated thread.
+	 */
+	export class DiagnosticsPublisher
+	{
+	public:
+		explicit DiagnosticsPublisher(OutputQueue& output_queue, DiagnosticsOptions publish_options = {});
+		~DiagnosticsPublisher();
+
+		DiagnosticsPublisher(DiagnosticsPublisher const&) = delete;
+		auto operator= (DiagnosticsPublisher const&) -> DiagnosticsPublisher& = delete;
+
+		/**
+		 * Replaces the diagnostics for uri. May be called from any thread.
+		 */
+		auto publish(std::string_view uri, std::optional< std::int64_t > version, std::vector< lsp::Diagnostic > diagnostics) -> void;
+
+		/**
+		 * Drops any pending update and the record of what was sent for uri (eg. on the document being closed).
+		 */
+		auto forget(std::string_view uri) -> void;
+
+		/**
+		 * Number of notifications sent, and of updates dropped: those superseded by a later update before being sent, and those unchanged from
+		 * what was last sent. An unchanged update which also supersedes a pending one is counted once.
+		 */
+		auto published_count() const -> std::uint64_t
+		{
+			return published.load(std::memory_order_relaxed);
+		}
+
+		auto suppressed_count() const -> std::uint64_t
+		{
+			return suppressed.load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct PendingUpdate
+		{
+			std::optional< std::int64_t > version;
+			std::vector< lsp::Diagnostic > diagnostics;
+			std::uint64_t hash;
+			std::chrono::steady_clock::time_point due;
+			std::chrono::steady_clock::time_point deadline;
+		};
+
+		struct DocumentState
+		{
+			std::optional< std::uint64_t > sent_hash;
+			std::vector< lsp::Diagnostic > sent;
+			std::optional< PendingUpdate > pending;
+		};
+
+		auto run() -> void;
+
+	private:
+		OutputQueue& out_queue;
+		DiagnosticsOptions options;
+		std::mutex mtx;
+		std::condition_variable cvar;
+		std::map< std::string, DocumentState, std::less<> > documents;
+		bool stopping = false;
+		std::atomic< std::uint64_t > published = 0;
+		std::atomic< std::uint64_t > suppressed = 0;
+		std::thread sender;
+	};
+}
@@ -0,0 +1,136 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <variant>
+#include <string_view>
+#include <array>
+#include <bit>
+#endif
+
+export module lsp_boot.dispatch_table;
+
+import lsp_boot.lsp;
+
+namespace lsp_boot
+{
+	constexpr auto method_hash(std::string_view const method, std::uint32_t const seed) -> std::uint32_t
+	{
+		// FNV-1a, with the seed perturbing the offset basis
+		auto hash = std::uint32_t{ 2166136261u } ^ seed;
+		for (auto const c : method)
+		{
+			hash ^= static_cast< unsigned char >(c);
+			hash *= 16777619u;
+		}
+		return hash ^ (hash >> 16);
+	}
+
+	export template < typename MessageVariant >
+	class DispatchTable;
+
+	/**
+	 * Maps LSP method names to the corresponding alternative of a variant of lsp::JsonMessage types (lsp::Request, lsp::Notification).
+	 * The table is generated at compile time from the alternatives' names, using a perfect hash, so lookup costs a single hash of the method
+	 * plus one string comparison regardless of the number of message types.
+	 */
+	export template < typename... Msgs >
+	class DispatchTable< std::variant< Msgs... > >
+	{
+	public:
+		using Message = std::variant< Msgs... >;
+
+		static constexpr auto message_count = sizeof...(Msgs);
+
+		/**
+		 * Index within the variant of the alternative for method, if any.
+		 */
+		static constexpr auto find(std::string_view const method) -> std::optional< std::size_t >
+		{
+			auto const slot = layout.slots[method_hash(method, layout.seed) & slot_mask];
+			if (slot != 0 && names[slot - 1] == method)
+			{
+				return slot - 1;
+			}
+			return std::nullopt;
+		}
+
+		/**
+		 * Wraps msg in the alternative for method, if any.
+		 */
+		static auto make(std::string_view const method, lsp::RawMessage&& msg) -> std::optional< Message >
+		{
+			if (auto const index = find(method); index)
+			{
+				return factories[*index](std::move(msg));
+			}
+			return std::nullopt;
+		}
+
+		static constexpr auto name(std::size_t const index) -> std::string_view
+		{
+			return names[index];
+		}
+
+	private:
+		static_assert(message_count > 0 && message_count < 256);
+
+		static constexpr auto names = std::array< std::string_view, message_count >{ Msgs::name... };
+
+		// Load factor of at most 0.5 keeps the seed search short.
+		static constexpr auto slot_count = std::bit_ceil(message_count * 2);
+		static constexpr auto slot_mask = slot_count - 1;
+
+		struct Layout
+		{
+			std::uint32_t seed = 0;
+			// 1-based index into names; 0 denotes an empty slot.
+			std::array< std::uint8_t, slot_count > slots{};
+		};
+
+		static constexpr auto layout = [] {
+			for (std::size_t i = 0; i < message_count; ++i)
+			{
+				for (std::size_t j = i + 1; j < message_count; ++j)
+				{
+					if (names[i] == names[j])
+					{
+						throw "Duplicate method name in message variant";
+					}
+				}
+			}
+
+			for (std::uint32_t seed = 0; seed < 100'000; ++seed)
+			{
+				auto candidate = Layout{ .seed = seed };
+				auto collision = false;
+				for (std::size_t i = 0; i < message_count && !collision; ++i)
+				{
+					auto& slot = candidate.slots[method_hash(names[i], seed) & slot_mask];
+					collision = slot != 0;
+					slot = static_cast< std::uint8_t >(i + 1);
+				}
+				if (!collision)
+				{
+					return candidate;
+				}
+			}
+
+			throw "Failed to generate perfect hash for message names";
+			}();
+
+		using Factory = auto (*)(lsp::RawMessage&&) -> Message;
+
+		static constexpr auto factories = std::array< Factory, message_count >{
+			[](lsp::RawMessage&& msg) -> Message {
+				return Message{ std::in_place_type< Msgs >, std::move(msg) };
+				}...
+		};
+	};
+}
@@ -0,0 +1,181 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <mutex>
+#endif
+
+module lsp_boot.document_store;
+
+namespace lsp_boot
+{
+	using namespace lsp;
+
+	namespace
+	{
+		// Offset of the end of the given line, excluding its terminator.
+		auto line_end(TextRope const& text, std::size_t const line) -> std::size_t
+		{
+			if (line + 1 >= text.line_count())
+			{
+				return text.size();
+			}
+			auto end = text.line_start(line + 1) - 1;
+			if (end > 0 && text.substr(end - 1, 1) == "\r")
+			{
+				--end;
+			}
+			return end;
+		}
+
+		auto position_offset(TextRope const& text, Location const position, PositionEncoding const encoding) -> std::size_t
+		{
+			auto const begin = text.line_start(position.line);
+			auto const end = std::max(begin, line_end(text, position.line));
+
+			if (encoding == PositionEncoding::utf8)
+			{
+				return std::min(begin + position.character, end);
+			}
+
+			// Every non-continuation byte begins a code point; those encoded as 4 bytes lie outside the BMP and occupy two UTF-16 code units.
+			auto offset = begin;
+			std::uint32_t units = 0;
+			text.for_each_chunk(begin, end - begin, [&](std::string_view const piece) {
+				for (auto const c : piece)
+				{
+					auto const byte = static_cast< unsigned char >(c);
+					if ((byte & 0xC0) != 0x80)
+					{
+						if (units >= position.character)
+						{
+							return false;
+						}
+						units += byte >= 0xF0 ? 2 : 1;
+					}
+					++offset;
+				}
+				return true;
+				});
+			return offset;
+		}
+	}
+
+	auto DocumentSnapshot::line(std::size_t const index) const -> std::string
+	{
+		auto const begin = doc_text.line_start(index);
+		auto const end = std::max(begin, line_end(doc_text, index));
+		return doc_text.substr(begin, end - begin);
+	}
+
+	auto DocumentSnapshot::offset_of(Location const position) const -> std::size_t
+	{
+		return position_offset(doc_text, position, encoding);
+	}
+
+	auto DocumentStore::set_position_encoding(PositionEncoding const position_encoding) -> void
+	{
+		auto lock = std::scoped_lock{ mtx };
+		encoding = position_encoding;
+	}
+
+	auto DocumentStore::apply(notifications::DidOpenTextDocument const& msg) -> void
+	{
+		auto const params = msg.typed_params();
+		if (!params)
+		{
+			return;
+		}
+
+		auto uri = DocumentURI{ params->uri };
+		auto text = TextRope{ params->text };
+
+		auto lock = std::scoped_lock{ mtx };
+		auto snapshot = DocumentSnapshot{ uri, params->version, std::move(text), encoding };
+		documents.insert_or_assign(std::move(uri), std::move(snapshot));
+	}
+
+	auto DocumentStore::apply(notifications::DidChangeTextDocument const& msg) -> void
+	{
+		auto const params = msg.typed_params();
+		if (!params)
+		{
+			return;
+		}
+
+		// Updates are only made from a single thread, so we can apply the edits without holding the lock.
+		auto const current = snapshot(params->uri);
+		if (!current)
+		{
+			return;
+		}
+
+		auto text = current->text();
+		auto const position_encoding = [&] {
+			auto lock = std::scoped_lock{ mtx };
+			return encoding;
+			}();
+
+		for (auto const& change : params->content_changes)
+		{
+			if (change.range)
+			{
+				// Each range is relative to the content as updated by the preceding changes.
+				auto const start = position_offset(text, change.range->start, position_encoding);
+				auto const end = std::max(start, position_offset(text, change.range->end, position_encoding));
+				text = text.replace(start, end - start, change.text);
+			}
+			else
+			{
+				text = TextRope{ change.text };
+			}
+		}
+
+		auto lock = std::scoped_lock{ mtx };
+		documents.insert_or_assign(current->uri(), DocumentSnapshot{ current->uri(), params->version, std::move(text), position_encoding });
+	}
+
+	auto DocumentStore::apply(notifications::DidCloseTextDocument const& msg) -> void
+	{
+		auto const params = msg.typed_params();
+		if (!params)
+		{
+			return;
+		}
+
+		auto lock = std::scoped_lock{ mtx };
+		if (auto const it = documents.find(params->uri); it != documents.end())
+		{
+			documents.erase(it);
+		}
+	}
+
+	auto DocumentStore::snapshot(std::string_view const uri) const -> std::optional< DocumentSnapshot >
+	{
+		auto lock = std::scoped_lock{ mtx };
+		if (auto const it = documents.find(uri); it != documents.end())
+		{
+			return it->second;
+		}
+		return std::nullopt;
+	}
+
+	auto DocumentStore::version(std::string_view const uri) const -> std::optional< std::int64_t >
+	{
+		auto lock = std::scoped_lock{ mtx };
+		if (auto const it = documents.find(uri); it != documents.end())
+		{
+			return it->second.version();
+		}
+		return std::nullopt;
+	}
+}
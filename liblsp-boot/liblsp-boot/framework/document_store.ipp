@@ -0,0 +1,129 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <map>
+#include <functional>
+#include <mutex>
+#endif
+
+export module lsp_boot.document_store;
+
+export import lsp_boot.rope;
+import lsp_boot.lsp;
+
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	/**
+	 * Units in which the character component of an LSP position is expressed, as negotiated via the positionEncoding capability.
+	 */
+	export enum class PositionEncoding
+	{
+		utf8,
+		utf16, // LSP default
+	};
+
+	/**
+	 * Immutable view of the content of an open document at a specific version.
+	 * Copies share the underlying text, so snapshots are cheap to take and can be held on to from any thread.
+	 */
+	export class DocumentSnapshot
+	{
+	public:
+		DocumentSnapshot(lsp::DocumentURI document_uri, std::int64_t const document_version, TextRope document_text, PositionEncoding const encoding)
+			: doc_uri{ std::move(document_uri) }, doc_version{ document_version }, doc_text{ std::move(document_text) }, encoding{ encoding }
+		{
+		}
+
+		auto uri() const -> lsp::DocumentURI const&
+		{
+			return doc_uri;
+		}
+
+		auto version() const -> std::int64_t
+		{
+			return doc_version;
+		}
+
+		auto text() const -> TextRope const&
+		{
+			return doc_text;
+		}
+
+		/**
+		 * Full content as a contiguous string. Note this copies the document; prefer text() where possible.
+		 */
+		auto content() const -> lsp::DocumentContent
+		{
+			return doc_text.str();
+		}
+
+		auto line_count() const -> std::size_t
+		{
+			return doc_text.line_count();
+		}
+
+		/**
+		 * Content of the given line, excluding the line terminator.
+		 */
+		auto line(std::size_t index) const -> std::string;
+
+		/**
+		 * Byte offset into text() of an LSP position. Positions past the end of a line are clamped to the end of that line.
+		 */
+		auto offset_of(lsp::Location position) const -> std::size_t;
+
+		auto substr(lsp::Range range) const -> std::string
+		{
+			auto const start = offset_of(range.start);
+			auto const end = offset_of(range.end);
+			return doc_text.substr(start, end > start ? end - start : 0);
+		}
+
+	private:
+		lsp::DocumentURI doc_uri;
+		std::int64_t doc_version;
+		TextRope doc_text;
+		PositionEncoding encoding;
+	};
+
+	/**
+	 * Content of the documents currently open in the client, maintained from the textDocument/did{Open,Change,Close} notifications.
+	 * Updates are made by the server on its dispatching thread; snapshots may be requested from any thread.
+	 */
+	export class DocumentStore
+	{
+	public:
+		auto set_position_encoding(PositionEncoding) -> void;
+
+		// Notifications with malformed params are ignored.
+		auto apply(lsp::notifications::DidOpenTextDocument const&) -> void;
+		auto apply(lsp::notifications::DidChangeTextDocument const&) -> void;
+		auto apply(lsp::notifications::DidCloseTextDocument const&) -> void;
+
+		/**
+		 * Latest version of the given document, if open.
+		 */
+		auto snapshot(std::string_view uri) const -> std::optional< DocumentSnapshot >;
+
+		/**
+		 * Version of the given document, if open.
+		 */
+		auto version(std::string_view uri) const -> std::optional< std::int64_t >;
+
+	private:
+		mutable std::mutex mtx;
+		std::map< lsp::DocumentURI, DocumentSnapshot, std::less<> > documents;
+		PositionEncoding encoding = PositionEncoding::utf16;
+	};
+}
@@ -0,0 +1,105 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <iterator>
+#include <algorithm>
+#include <format>
+#include <thread>
+#include <atomic>
+#endif
+
+module lsp_boot.logging;
+
+namespace lsp_boot
+{
+	AsyncLogWriter::AsyncLogWriter(LoggingSink log_sink, std::size_t const capacity) : sink{ std::move(log_sink) }, ring{ capacity }
+	{
+		writer = std::thread([this] { run(); });
+	}
+
+	AsyncLogWriter::~AsyncLogWriter()
+	{
+		stopping.store(true, std::memory_order_seq_cst);
+		signal.fetch_add(1, std::memory_order_seq_cst);
+		signal.notify_one();
+		writer.join();
+	}
+
+	auto AsyncLogWriter::submit(LogRecord& record) -> void
+	{
+		if (!ring.try_push(record))
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			// Releases the payload's storage now, rather than whenever the caller's record is next reused.
+			record.text.clear();
+			record.payload.reset();
+			return;
+		}
+
+		// Pairs with the fence in run(), ensuring that either the writer sees the record or we see that it's waiting.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (writer_waiting.load(std::memory_order_relaxed) && writer_waiting.exchange(false, std::memory_order_relaxed))
+		{
+			signal.fetch_add(1, std::memory_order_seq_cst);
+			signal.notify_one();
+		}
+	}
+
+	auto AsyncLogWriter::run() -> void
+	{
+		auto record = LogRecord{};
+		while (true)
+		{
+			auto const epoch = signal.load(std::memory_order_seq_cst);
+
+			if (ring.try_pop(record))
+			{
+				write(record);
+				record.text.clear();
+				record.payload.reset();
+				continue;
+			}
+			if (auto const count = dropped.exchange(0, std::memory_order_relaxed); count > 0)
+			{
+				write(std::format("[{} log records dropped]", count));
+				continue;
+			}
+			if (stopping.load(std::memory_order_acquire))
+			{
+				// Everything submitted prior to shutdown has been written.
+				return;
+			}
+
+			writer_waiting.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!ring.ready() && !stopping.load(std::memory_order_acquire))
+			{
+				signal.wait(epoch, std::memory_order_seq_cst);
+			}
+			writer_waiting.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	auto AsyncLogWriter::write(LogRecord& record) const -> void
+	{
+		if (record.payload)
+		{
+			std::format_to(std::back_inserter(record.text), "{}", JsonText{ *record.payload, record.payload_max_chars });
+		}
+		write(record.text);
+	}
+
+	auto AsyncLogWriter::write(std::string_view const text) const -> void
+	{
+		sink([&](LogOutputIter out) {
+			return std::ranges::copy(text, out).out;
+			});
+	}
+}
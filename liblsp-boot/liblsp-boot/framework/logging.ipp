@@ -0,0 +1,197 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <iterator>
+#include <functional>
+#include <optional>
+#include <algorithm>
+#include <format>
+#include <thread>
+#include <atomic>
+#endif
+
+export module lsp_boot.logging;
+
+import lsp_boot.ring_buffer;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	export using LogOutputIter = std::ostream_iterator< char >;
+	export using LogOutputCallbackView = std::function< LogOutputIter(LogOutputIter) >&&; // Ideally would be function_view
+	export using LoggingSink = std::function< void(LogOutputCallbackView) >;
+
+	/**
+	 * Output iterator with which log records are formatted, into a reused per thread buffer.
+	 */
+	export using LogRecordIter = std::back_insert_iterator< std::string >;
+
+	export enum class LogLevel : std::uint8_t
+	{
+		trace,
+		debug,
+		info,
+		warning,
+		error,
+		off, // Threshold only, disables all logging
+	};
+
+	export enum class LogCategory : std::uint8_t
+	{
+		server,			// Framework lifecycle and failures
+		dispatch,		// Per message dispatch and completion
+		payload,		// Full message content
+		implementation,	// Records logged by the server implementation
+		metrics,		// Periodic metrics reports
+	};
+
+	export constexpr auto log_category_mask(LogCategory const category) -> std::uint32_t
+	{
+		return std::uint32_t{ 1 } << std::to_underlying(category);
+	}
+
+	export constexpr auto all_log_categories = std::uint32_t{ 0xffffff };
+
+	/**
+	 * Active minimum level and set of enabled categories, checkable with a single relaxed load so that disabled logging costs next to nothing.
+	 */
+	export class LogFilter
+	{
+	public:
+		explicit LogFilter(LogLevel const level = LogLevel::info, std::uint32_t const categories = all_log_categories) : state{ pack(level, categories) }
+		{
+		}
+
+		auto is_enabled(LogLevel const level, LogCategory const category) const -> bool
+		{
+			auto const current = state.load(std::memory_order_relaxed);
+			return std::to_underlying(level) >= (current & 0xff) && ((current >> 8) & log_category_mask(category)) != 0;
+		}
+
+		auto set(LogLevel const level, std::uint32_t const categories = all_log_categories) -> void
+		{
+			state.store(pack(level, categories), std::memory_order_relaxed);
+		}
+
+	private:
+		static constexpr auto pack(LogLevel const level, std::uint32_t const categories) -> std::uint32_t
+		{
+			return std::to_underlying(level) | ((categories & all_log_categories) << 8);
+		}
+
+		std::atomic< std::uint32_t > state;
+	};
+
+	/**
+	 * Format argument deferring serialization of JSON to the point of formatting, so that it's not performed for disabled log records.
+	 * Output is truncated to max_chars.
+	 */
+	export struct JsonText
+	{
+		JsonText(boost::json::value const& js, std::size_t const max = std::string::npos) : value{ &js }, max_chars{ max }
+		{
+		}
+
+		JsonText(boost::json::object const& js, std::size_t const max = std::string::npos) : object{ &js }, max_chars{ max }
+		{
+		}
+
+		boost::json::value const* value = nullptr;
+		boost::json::object const* object = nullptr;
+		std::size_t max_chars;
+	};
+
+	/**
+	 * Record handed to an AsyncLogWriter. A payload is serialized (truncated to payload_max_chars) and appended to the text on the writer thread,
+	 * rather than by the submitting thread. It holds its own storage, so when copied from a message into the message's arena it keeps that alive
+	 * until written.
+	 */
+	export struct LogRecord
+	{
+		std::string text;
+		std::optional< boost::json::value > payload;
+		std::size_t payload_max_chars = std::string::npos;
+	};
+
+	/**
+	 * Passes log records to a sink on a dedicated thread, via a lock-free ring buffer.
+	 * Submitting threads don't block: should the writer fall behind and the ring fill up, records are dropped and a count of them later reported.
+	 */
+	export class AsyncLogWriter
+	{
+	public:
+		static constexpr std::size_t default_capacity = 4096;
+
+		explicit AsyncLogWriter(LoggingSink log_sink, std::size_t capacity = default_capacity);
+		~AsyncLogWriter();
+
+		AsyncLogWriter(AsyncLogWriter const&) = delete;
+		auto operator= (AsyncLogWriter const&) -> AsyncLogWriter& = delete;
+
+		/**
+		 * Hands record over to the writer. May be called from any thread.
+		 * record is left holding a previously written (and cleared) record, allowing its text buffer to be reused.
+		 */
+		auto submit(LogRecord& record) -> void;
+
+	private:
+		auto run() -> void;
+		auto write(LogRecord& record) const -> void;
+		auto write(std::string_view text) const -> void;
+
+	private:
+		LoggingSink sink;
+		MpscRingBuffer< LogRecord > ring;
+		std::atomic< std::size_t > dropped = 0;
+		std::atomic< bool > stopping = false;
+		std::atomic< bool > writer_waiting = false;
+		std::atomic< std::uint32_t > signal = 0;
+		std::thread writer;
+	};
+}
+
+template <>
+struct std::formatter< lsp_boot::JsonText, char >
+{
+	constexpr auto parse(std::format_parse_context& ctx)
+	{
+		return ctx.begin();
+	}
+
+	template < typename FormatContext >
+	auto format(lsp_boot::JsonText const& text, FormatContext& ctx) const
+	{
+		auto serializer = boost::json::serializer{};
+		if (text.value != nullptr)
+		{
+			serializer.reset(text.value);
+		}
+		else
+		{
+			serializer.reset(text.object);
+		}
+
+		char buffer[256];
+		auto out = ctx.out();
+		auto remaining = text.max_chars;
+		while (!serializer.done() && remaining > 0)
+		{
+			auto const chunk = serializer.read(buffer, std::min(sizeof(buffer), remaining));
+			out = std::ranges::copy(chunk, out).out;
+			remaining -= chunk.size();
+		}
+		if (!serializer.done())
+		{
+			out = std::ranges::copy(std::string_view{ "..." }, out).out;
+		}
+		return out;
+	}
+};
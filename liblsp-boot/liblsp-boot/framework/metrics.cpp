@@ -0,0 +1,165 @@
+
+module;
+
+// workaround: MSVC modules template specialization and boost::system::error_code
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <boost/json/value_to.hpp>
+#endif
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <iterator>
+#include <format>
+#include <atomic>
+#endif
+
+module lsp_boot.metrics;
+
+import lsp_boot.lsp;
+import lsp_boot.dispatch_table;
+
+namespace lsp_boot
+{
+	namespace
+	{
+		using RequestTable = DispatchTable< lsp::Request >;
+		using NotificationTable = DispatchTable< lsp::Notification >;
+
+		constexpr auto method_count = RequestTable::message_count + NotificationTable::message_count + 1;
+		constexpr auto other_method_index = method_count - 1;
+
+		constexpr auto microseconds_per_nanosecond = 1e-3;
+
+		auto method_name(std::size_t const index) -> std::string_view
+		{
+			if (index < RequestTable::message_count)
+			{
+				return RequestTable::name(index);
+			}
+			else if (index < other_method_index)
+			{
+				return NotificationTable::name(index - RequestTable::message_count);
+			}
+			return "(other)";
+		}
+
+		auto summarize(Histogram const& histogram, double const scale) -> boost::json::object
+		{
+			return {
+				{ "count", histogram.count() },
+				{ "mean", histogram.mean() * scale },
+				{ "p50", histogram.quantile(0.5) * scale },
+				{ "p90", histogram.quantile(0.9) * scale },
+				{ "p99", histogram.quantile(0.99) * scale },
+				{ "max", histogram.max() * scale },
+			};
+		}
+
+		auto format_latency(Histogram const& histogram) -> std::string
+		{
+			constexpr auto scale = microseconds_per_nanosecond;
+			return std::format("{:.1f}/{:.1f}/{:.1f}/{:.1f}",
+				histogram.quantile(0.5) * scale, histogram.quantile(0.9) * scale, histogram.quantile(0.99) * scale, histogram.max() * scale);
+		}
+	}
+
+	MetricsRegistry::MetricsRegistry() : methods{ std::make_unique< MethodMetrics[] >(method_count) }
+	{
+	}
+
+	auto MetricsRegistry::method(std::string_view const name) -> MethodMetrics&
+	{
+		if (auto const index = RequestTable::find(name); index)
+		{
+			return methods[*index];
+		}
+		if (auto const index = NotificationTable::find(name); index)
+		{
+			return methods[RequestTable::message_count + *index];
+		}
+		return methods[other_method_index];
+	}
+
+	auto MetricsRegistry::report() const -> boost::json::object
+	{
+		constexpr auto time_scale = microseconds_per_nanosecond;
+
+		auto methods_js = boost::json::object{};
+		for (std::size_t index = 0; index < method_count; ++index)
+		{
+			auto const& entry = methods[index];
+			if (entry.size.count() == 0)
+			{
+				continue;
+			}
+
+			methods_js[method_name(index)] = boost::json::object{
+				{ "size_bytes", summarize(entry.size, 1.0) },
+				{ "parse_us", summarize(entry.parse, time_scale) },
+				{ "queue_wait_us", summarize(entry.queue_wait, time_scale) },
+				{ "pump_us", summarize(entry.pump, time_scale) },
+				{ "handler_us", summarize(entry.handler, time_scale) },
+				{ "response_us", summarize(entry.response, time_scale) },
+				{ "serialize_us", summarize(entry.serialize, time_scale) },
+			};
+		}
+
+		return {
+			{ "methods", std::move(methods_js) },
+			{ "input", boost::json::object{
+				{ "backlog_depth", summarize(backlog, 1.0) },
+				{ "coalesced_changes", coalesced.load(std::memory_order_relaxed) },
+				{ "stale_requests", stale.load(std::memory_order_relaxed) },
+				} },
+			{ "response_cache", boost::json::object{
+				{ "hits", cache_hits.load(std::memory_order_relaxed) },
+				{ "misses", cache_misses.load(std::memory_order_relaxed) },
+				} },
+			{ "output", boost::json::object{
+				{ "serialize_us", summarize(output_metrics.serialize, time_scale) },
+				{ "message_bytes", summarize(output_metrics.message_size, 1.0) },
+				{ "batch_messages", summarize(output_metrics.batch_messages, 1.0) },
+				} },
+		};
+	}
+
+	auto MetricsRegistry::format_report() const -> std::string
+	{
+		auto text = std::string{ "Metrics (p50/p90/p99/max, us):" };
+		auto out = std::back_inserter(text);
+		for (std::size_t index = 0; index < method_count; ++index)
+		{
+			auto const& entry = methods[index];
+			if (entry.size.count() == 0)
+			{
+				continue;
+			}
+
+			out = std::format_to(out, "\n  {}: count={} parse={} queue_wait={} pump={} handler={} response={} serialize={}",
+				method_name(index),
+				entry.size.count(),
+				format_latency(entry.parse),
+				format_latency(entry.queue_wait),
+				format_latency(entry.pump),
+				format_latency(entry.handler),
+				format_latency(entry.response),
+				format_latency(entry.serialize));
+		}
+
+		out = std::format_to(out, "\n  input: backlog_depth p99={} max={} coalesced_changes={} stale_requests={}",
+			backlog.quantile(0.99), backlog.max(), coalesced.load(std::memory_order_relaxed), stale.load(std::memory_order_relaxed));
+		out = std::format_to(out, "\n  response_cache: hits={} misses={}",
+			cache_hits.load(std::memory_order_relaxed), cache_misses.load(std::memory_order_relaxed));
+		out = std::format_to(out, "\n  output: count={} serialize={} message_bytes p99={} batch_messages p99={}",
+			output_metrics.serialize.count(),
+			format_latency(output_metrics.serialize),
+			output_metrics.message_size.quantile(0.99),
+			output_metrics.batch_messages.quantile(0.99));
+		return text;
+	}
+}
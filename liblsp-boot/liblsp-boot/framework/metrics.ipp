@@ -0,0 +1,123 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <atomic>
+#endif
+
+export module lsp_boot.metrics;
+
+export import lsp_boot.histogram;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	/**
+	 * Custom request to which the server responds with MetricsRegistry::report().
+	 */
+	export constexpr auto metrics_request_method = std::string_view{ "$/lsp-boot/metrics" };
+
+	/**
+	 * Breakdown of messages of a given method. Durations are recorded in nanoseconds.
+	 */
+	export struct MethodMetrics
+	{
+		Histogram size;			// Content bytes
+		Histogram parse;		// Transport JSON parsing
+		Histogram queue_wait;	// Receipt to start of dispatch
+		Histogram pump;			// Implementation pump preceding a request
+		Histogram handler;		// Implementation handler
+		Histogram response;		// Receipt to completion of handling
+		Histogram serialize;	// Transport serialization of the response
+	};
+
+	export struct OutputMetrics
+	{
+		Histogram serialize;		// Per message, nanoseconds
+		Histogram message_size;		// Bytes
+		Histogram batch_messages;	// Messages per transport write
+	};
+
+	/**
+	 * Built in, always on collection of per method and transport statistics.
+	 * Recording is lock-free and may happen from any thread; methods are mapped to their entry via the message dispatch tables.
+	 */
+	export class MetricsRegistry
+	{
+	public:
+		MetricsRegistry();
+
+		/**
+		 * Entry for the given method. Methods not known to the framework share a single entry.
+		 */
+		auto method(std::string_view name) -> MethodMetrics&;
+
+		/**
+		 * Number of messages waiting in the server's input backlog, sampled at each dispatch.
+		 */
+		auto input_backlog() -> Histogram&
+		{
+			return backlog;
+		}
+
+		/**
+		 * Number of didChange notifications folded into an earlier queued notification (see ServerOptions::coalesce_document_changes).
+		 */
+		auto coalesced_changes() -> std::atomic< std::uint64_t >&
+		{
+			return coalesced;
+		}
+
+		/**
+		 * Number of requests answered with ServerCancelled rather than dispatched, having waited past their deadline (see RequestSchedule).
+		 */
+		auto stale_requests() -> std::atomic< std::uint64_t >&
+		{
+			return stale;
+		}
+
+		/**
+		 * Requests answered from, and not found in, the response cache (see ServerOptions::response_cache_bytes).
+		 */
+		auto response_cache_hits() -> std::atomic< std::uint64_t >&
+		{
+			return cache_hits;
+		}
+
+		auto response_cache_misses() -> std::atomic< std::uint64_t >&
+		{
+			return cache_misses;
+		}
+
+		auto output() -> OutputMetrics&
+		{
+			return output_metrics;
+		}
+
+		/**
+		 * Summary (count, mean, p50/p90/p99/max) of all non-empty histograms. Durations are reported in microseconds.
+		 */
+		auto report() const -> boost::json::object;
+
+		/**
+		 * Human readable form of report(), one line per method.
+		 */
+		auto format_report() const -> std::string;
+
+	private:
+		std::unique_ptr< MethodMetrics[] > methods;
+		Histogram backlog;
+		std::atomic< std::uint64_t > coalesced = 0;
+		std::atomic< std::uint64_t > stale = 0;
+		std::atomic< std::uint64_t > cache_hits = 0;
+		std::atomic< std::uint64_t > cache_misses = 0;
+		OutputMetrics output_metrics;
+	};
+}
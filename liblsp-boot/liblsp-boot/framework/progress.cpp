@@ -0,0 +1,142 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <mutex>
+#endif
+
+module lsp_boot.progress;
+
+namespace lsp_boot
+{
+	namespace
+	{
+		using WorkDoneState = detail::ProgressChannel::WorkDoneState;
+
+		auto make_work_done_value(std::string_view const kind, std::string_view const message, std::optional< std::uint32_t > const percentage) -> boost::json::value
+		{
+			auto value = boost::json::object{
+				{ lsp::keys::kind, kind },
+			};
+			if (!message.empty())
+			{
+				value[lsp::keys::message] = message;
+			}
+			if (percentage)
+			{
+				value[lsp::keys::percentage] = std::min< std::uint32_t >(*percentage, 100);
+			}
+			return value;
+		}
+	}
+
+	namespace detail
+	{
+		auto ProgressChannel::push(boost::json::value&& value) -> void
+		{
+			// Built in the value's storage, so that the value is moved in rather than copied.
+			auto params = boost::json::object({
+				{ lsp::keys::token, token },
+				}, value.storage());
+			params[lsp::keys::value] = std::move(value);
+
+			auto notification = lsp::RawMessage({
+				{ "jsonrpc", "2.0" },
+				{ lsp::keys::method, lsp::notifications::Progress::name },
+				}, params.storage());
+			notification[lsp::keys::params] = std::move(params);
+			out_queue.push(std::move(notification));
+		}
+
+		auto ProgressChannel::close() -> void
+		{
+			auto lock = std::scoped_lock{ mtx };
+			if (closed)
+			{
+				return;
+			}
+			if (work_done == WorkDoneState::begun)
+			{
+				push(make_work_done_value("end", {}, std::nullopt));
+				work_done = WorkDoneState::ended;
+				++sent;
+			}
+			closed = true;
+		}
+	}
+
+	auto PartialResultStream::send(boost::json::value chunk) const -> bool
+	{
+		return channel && channel->send(std::move(chunk), [](WorkDoneState) {
+			return true;
+			});
+	}
+
+	auto WorkDoneProgress::begin(std::string_view const title, std::optional< std::uint32_t > const percentage, std::string_view const message) const -> bool
+	{
+		if (!channel)
+		{
+			return false;
+		}
+		auto value = make_work_done_value("begin", message, percentage);
+		value.get_object()[lsp::keys::title] = title;
+		return channel->send(std::move(value), [](WorkDoneState& state) {
+			if (state != WorkDoneState::not_begun)
+			{
+				return false;
+			}
+			state = WorkDoneState::begun;
+			return true;
+			});
+	}
+
+	auto WorkDoneProgress::report(std::optional< std::uint32_t > const percentage, std::string_view const message) const -> bool
+	{
+		return channel && channel->send(make_work_done_value("report", message, percentage), [](WorkDoneState const state) {
+			return state == WorkDoneState::begun;
+			});
+	}
+
+	auto WorkDoneProgress::end(std::string_view const message) const -> bool
+	{
+		return channel && channel->send(make_work_done_value("end", message, std::nullopt), [](WorkDoneState& state) {
+			if (state != WorkDoneState::begun)
+			{
+				return false;
+			}
+			state = WorkDoneState::ended;
+			return true;
+			});
+	}
+
+	RequestProgress::RequestProgress(OutputQueue& output_queue, lsp::RawMessage const& request)
+	{
+		auto const params = request.if_contains(lsp::keys::params);
+		if (params == nullptr || !params->is_object())
+		{
+			return;
+		}
+
+		auto const make_channel = [&](std::string_view const key) -> std::shared_ptr< detail::ProgressChannel > {
+			// ProgressToken = integer | string
+			auto const token = params->get_object().if_contains(key);
+			if (token == nullptr || !(token->is_int64() || token->is_uint64() || token->is_string()))
+			{
+				return nullptr;
+			}
+			// Copied out of the request's storage, which may be an arena freed once the request has been dispatched.
+			return std::make_shared< detail::ProgressChannel >(output_queue, boost::json::value(*token, boost::json::storage_ptr{}));
+			};
+		partial_result_channel = make_channel(lsp::keys::partial_result_token);
+		work_done_channel = make_channel(lsp::keys::work_done_token);
+	}
+}
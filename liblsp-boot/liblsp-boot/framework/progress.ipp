@@ -0,0 +1,197 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <memory>
+#include <optional>
+#include <mutex>
+#endif
+
+export module lsp_boot.progress;
+
+import lsp_boot.lsp;
+import lsp_boot.work_queue;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	namespace detail
+	{
+		// $/progress notifications for one progress token.
+		class ProgressChannel
+		{
+		public:
+			ProgressChannel(OutputQueue& output_queue, boost::json::value progress_token) : out_queue{ output_queue }, token{ std::move(progress_token) }
+			{
+			}
+
+			enum class WorkDoneState : std::uint8_t
+			{
+				not_begun,
+				begun,
+				ended,
+			};
+
+			// Sends value unless the channel is closed, or update returns false. update is passed the current work done state, which it may change.
+			template < typename Update >
+			auto send(boost::json::value&& value, Update&& update) -> bool
+			{
+				auto lock = std::scoped_lock{ mtx };
+				if (closed || !update(work_done))
+				{
+					return false;
+				}
+				push(std::move(value));
+				++sent;
+				return true;
+			}
+
+			// Ends work done progress left open, and stops anything further being sent.
+			auto close() -> void;
+
+			auto sent_count() const -> std::size_t
+			{
+				auto lock = std::scoped_lock{ mtx };
+				return sent;
+			}
+
+		private:
+			auto push(boost::json::value&& value) -> void;
+
+		private:
+			OutputQueue& out_queue;
+			boost::json::value token;
+			mutable std::mutex mtx;
+			bool closed = false;
+			WorkDoneState work_done = WorkDoneState::not_begun;
+			std::size_t sent = 0;
+		};
+	}
+
+	/**
+	 * Streams a request's result to the client in chunks, as $/progress notifications for the partialResultToken given with the request.
+	 * Only active if the client supplied a token; otherwise send does nothing, and the handler should return its complete result as usual.
+	 * Once any chunk has been sent, the final response must not repeat it: for array results, for example, the handler returns an empty array.
+	 * Usable from any thread, until the request's response is sent, after which further chunks are dropped.
+	 */
+	export class PartialResultStream
+	{
+	public:
+		PartialResultStream() = default;
+
+		auto is_active() const -> bool
+		{
+			return channel != nullptr;
+		}
+
+		/**
+		 * Sends chunk, in the form of the request's partial result (eg. an array of DocumentSymbol, or for semantic tokens, an object holding
+		 * a data array). Building it in ServerImplAPI::json_storage avoids a copy.
+		 * @return Whether the chunk was sent.
+		 */
+		auto send(boost::json::value chunk) const -> bool;
+
+	private:
+		friend class RequestProgress;
+
+		explicit PartialResultStream(std::shared_ptr< detail::ProgressChannel > progress_channel) : channel{ std::move(progress_channel) }
+		{
+		}
+
+		std::shared_ptr< detail::ProgressChannel > channel;
+	};
+
+	/**
+	 * Reports progress of a request's handling to the client, for the workDoneToken given with the request. Only active if the client supplied a token.
+	 * begin is sent once, followed by any number of reports, and end. If the handler doesn't end it, end is sent ahead of the response.
+	 * Usable from any thread, until the request's response is sent.
+	 */
+	export class WorkDoneProgress
+	{
+	public:
+		WorkDoneProgress() = default;
+
+		/**
+		 * Progress for a token created by the server, which must already have been sent to the client in a window/workDoneProgress/create request.
+		 * Never ended by the framework.
+		 */
+		static auto for_server_token(OutputQueue& output_queue, boost::json::value token) -> WorkDoneProgress
+		{
+			return WorkDoneProgress{ std::make_shared< detail::ProgressChannel >(output_queue, std::move(token)) };
+		}
+
+		auto is_active() const -> bool
+		{
+			return channel != nullptr;
+		}
+
+		/**
+		 * @percentage In the range [0, 100], if given. Once given on beginning, progress is expected to be reported with a percentage throughout.
+		 * @return Whether the notification was sent, which it isn't if out of sequence.
+		 */
+		auto begin(std::string_view title, std::optional< std::uint32_t > percentage = std::nullopt, std::string_view message = {}) const -> bool;
+		auto report(std::optional< std::uint32_t > percentage, std::string_view message = {}) const -> bool;
+		auto end(std::string_view message = {}) const -> bool;
+
+	private:
+		friend class RequestProgress;
+
+		explicit WorkDoneProgress(std::shared_ptr< detail::ProgressChannel > progress_channel) : channel{ std::move(progress_channel) }
+		{
+		}
+
+		std::shared_ptr< detail::ProgressChannel > channel;
+	};
+
+	/**
+	 * Framework side of the progress tokens supplied with a request.
+	 */
+	export class RequestProgress
+	{
+	public:
+		RequestProgress() = default;
+
+		/**
+		 * Takes the partialResultToken and workDoneToken, if any, from the request's params.
+		 */
+		RequestProgress(OutputQueue& output_queue, lsp::RawMessage const& request);
+
+		auto partial_results() const -> PartialResultStream
+		{
+			return PartialResultStream{ partial_result_channel };
+		}
+
+		auto work_done() const -> WorkDoneProgress
+		{
+			return WorkDoneProgress{ work_done_channel };
+		}
+
+		auto partial_results_sent() const -> bool
+		{
+			return partial_result_channel && partial_result_channel->sent_count() > 0;
+		}
+
+		/**
+		 * To be called ahead of sending the request's response.
+		 */
+		auto close() const -> void
+		{
+			for (auto const& channel : { partial_result_channel, work_done_channel })
+			{
+				if (channel)
+				{
+					channel->close();
+				}
+			}
+		}
+
+	private:
+		std::shared_ptr< detail::ProgressChannel > partial_result_channel;
+		std::shared_ptr< detail::ProgressChannel > work_done_channel;
+	};
+}
@@ -0,0 +1,154 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#endif
+
+export module lsp_boot.request_executor;
+
+import lsp_boot.thread_pool;
+
+namespace lsp_boot
+{
+	/**
+	 * Runs request tasks on a worker pool, serialized per document.
+	 * Tasks for the same document run one at a time in submission order; tasks for different documents run concurrently.
+	 * The pool is either owned by the executor, or shared with other executors (eg. those of the sessions hosted by a SocketHost).
+	 */
+	export class RequestExecutor
+	{
+	public:
+		using Task = std::function< void() >;
+
+		explicit RequestExecutor(std::size_t const worker_count)
+			: owned_pool{ std::make_unique< ThreadPool >(worker_count) }, pool{ *owned_pool }
+		{
+		}
+
+		/**
+		 * Runs tasks on shared_pool, which must outlive the executor.
+		 */
+		explicit RequestExecutor(ThreadPool& shared_pool) : pool{ shared_pool }
+		{
+		}
+
+		~RequestExecutor()
+		{
+			wait_all();
+		}
+
+		/**
+		 * Queues task to run once all previously submitted tasks for the same document have completed.
+		 */
+		auto submit(std::string const& document, Task task) -> void
+		{
+			auto lock = std::scoped_lock{ mtx };
+			++in_flight;
+			auto& strand = strands[document];
+			strand.pending.push_back(std::move(task));
+			if (!strand.running)
+			{
+				strand.running = true;
+				pool.submit([this, document] { run_strand(document); });
+			}
+		}
+
+		/**
+		 * Blocks until all tasks submitted for document have completed.
+		 */
+		auto wait_document(std::string const& document) -> void
+		{
+			auto lock = std::unique_lock{ mtx };
+			idle.wait(lock, [&] {
+				return !strands.contains(document);
+				});
+		}
+
+		/**
+		 * Blocks until all submitted tasks have completed, and the workers that ran them are done with the executor.
+		 */
+		auto wait_all() -> void
+		{
+			auto lock = std::unique_lock{ mtx };
+			idle.wait(lock, [&] {
+				return in_flight == 0 && strands.empty();
+				});
+		}
+
+		/**
+		 * As wait_document and wait_all, but giving up after timeout. Returns whether the tasks waited on have completed.
+		 */
+		auto wait_document_for(std::string const& document, std::chrono::milliseconds const timeout) -> bool
+		{
+			auto lock = std::unique_lock{ mtx };
+			return idle.wait_for(lock, timeout, [&] {
+				return !strands.contains(document);
+				});
+		}
+
+		auto wait_all_for(std::chrono::milliseconds const timeout) -> bool
+		{
+			auto lock = std::unique_lock{ mtx };
+			return idle.wait_for(lock, timeout, [&] {
+				return in_flight == 0 && strands.empty();
+				});
+		}
+
+	private:
+		struct Strand
+		{
+			std::deque< Task > pending;
+			bool running = false;
+		};
+
+		auto run_strand(std::string const& document) -> void
+		{
+			while (true)
+			{
+				Task task;
+				{
+					auto lock = std::scoped_lock{ mtx };
+					auto const it = strands.find(document);
+					if (it->second.pending.empty())
+					{
+						strands.erase(it);
+						idle.notify_all();
+						return;
+					}
+					task = std::move(it->second.pending.front());
+					it->second.pending.pop_front();
+				}
+
+				task();
+
+				{
+					auto lock = std::scoped_lock{ mtx };
+					--in_flight;
+				}
+				idle.notify_all();
+			}
+		}
+
+	private:
+		std::mutex mtx;
+		std::condition_variable idle;
+		std::unordered_map< std::string, Strand > strands;
+		std::size_t in_flight = 0;
+		// Declared last so that workers are joined before the state they reference is destroyed. A shared pool's workers are known to be done
+		// with the executor once its strands are all gone (see wait_all, called on destruction).
+		std::unique_ptr< ThreadPool > owned_pool;
+		ThreadPool& pool;
+	};
+}
@@ -9,147 +9,564 @@ module;
 #if defined(LSP_BOOT_ENABLE_IMPORT_STD)
 import std;
 #else
+#include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <optional>
+#include <variant>
 #include <string_view>
 #include <string>
+#include <iterator>
 #include <ranges>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
 #include <chrono>
 #include <format>
 #endif
 
 module lsp_boot.server;
 
+import lsp_boot.dispatch_table;
+
 using namespace std::string_view_literals;
 
 namespace lsp_boot
 {
 	using namespace lsp;
 
-	auto Server::dispatch_request(std::string_view const method, lsp::RawMessage&& msg) -> InternalMessageResult
+	namespace
 	{
-		auto request_id = msg.at(keys::id);
+		auto nanoseconds_between(auto const start, auto const end) -> std::uint64_t
+		{
+			// Clamped, as the system clock may have been adjusted in between.
+			auto const elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >(end - start).count();
+			return elapsed > 0 ? std::uint64_t(elapsed) : 0;
+		}
 
-		log("Dispatching request: id={}, method={}", boost::json::serialize(request_id), method);
-		log([&](auto out) {
-			return std::ranges::copy(boost::json::serialize(msg), out).out;
-			});
+		auto nanoseconds_since(std::chrono::steady_clock::time_point const start) -> std::uint64_t
+		{
+			return nanoseconds_between(start, std::chrono::steady_clock::now());
+		}
 
-		// @todo: not sure how best to appoach this, but as we currently return the request result synchronously we need to ensure that
-		// any pending notifications or prior requests that could potentially affect our result have already been processed.
-		// this would be fairly complex to try to handle based on what notifications there were and in what order they came, so for now
-		// we simply enforce synchronization before each request.
-		// may want to consider at least making the response async so we can move the pump invocation off the server dispatching thread.
-		impl.pump();
+		auto has_method(lsp::RawMessage const& msg, std::string_view const name) -> bool
+		{
+			auto const method = msg.if_contains(keys::method);
+			return method != nullptr && method->is_string() && method->get_string() == name;
+		}
 
-		auto result = [&]() -> RequestResult {
-			// @todo: consider dispatching via type list
-			if (method == requests::Initialize::name)
+		struct DocumentChangeParts
+		{
+			boost::json::object& text_document;
+			boost::json::array& content_changes;
+		};
+
+		// params.textDocument and params.contentChanges of a didChange notification, if well formed.
+		auto document_change_parts(lsp::RawMessage& msg) -> std::optional< DocumentChangeParts >
+		{
+			auto const params = msg.if_contains(keys::params);
+			auto const params_obj = params != nullptr ? params->if_object() : nullptr;
+			auto const text_document = params_obj != nullptr ? params_obj->if_contains(keys::text_document) : nullptr;
+			auto const content_changes = params_obj != nullptr ? params_obj->if_contains(keys::content_changes) : nullptr;
+			if (text_document == nullptr || !text_document->is_object() || content_changes == nullptr || !content_changes->is_array())
 			{
-				return handle_request(requests::Initialize(std::move(msg)));
+				return std::nullopt;
 			}
-			else if (method == requests::Shutdown::name)
+			return DocumentChangeParts{ text_document->get_object(), content_changes->get_array() };
+		}
+
+		// params.capabilities.window.workDoneProgress of an initialize request.
+		auto client_supports_work_done_progress(lsp::RawMessage const& msg) -> bool
+		{
+			auto value = static_cast< boost::json::value const* >(nullptr);
+			auto object = &msg;
+			for (auto const key : { keys::params, keys::capabilities, keys::window, keys::work_done_progress })
 			{
-				return handle_request(requests::Shutdown(std::move(msg)));
+				value = object != nullptr ? object->if_contains(key) : nullptr;
+				object = value != nullptr ? value->if_object() : nullptr;
 			}
-			//else if (method == requests::DocumentHighlight::name)
-			//{
-			//	return handle_request(requests::DocumentHighlight(std::move(msg)));
-			//}
-			else if (method == requests::InlayHint::name)
+			return value != nullptr && value->is_bool() && value->get_bool();
+		}
+	}
+
+	struct Server::DeferredRequestResult::State
+	{
+		std::mutex mtx;
+		bool completed = false;
+		// Held until the server attaches its continuation.
+		std::optional< RequestResult > result;
+		std::function< void(RequestResult&&) > on_complete;
+
+		auto complete(RequestResult&& value) -> void
+		{
+			// The continuation runs under the lock, so that the server can't be destroyed from under it (see detach).
+			auto lock = std::scoped_lock{ mtx };
+			if (std::exchange(completed, true))
 			{
-				return handle_request(requests::InlayHint(std::move(msg)));
+				return;
 			}
-			else if (method == requests::Hover::name)
+			if (on_complete)
 			{
-				return handle_request(requests::Hover(std::move(msg)));
+				std::exchange(on_complete, {})(std::move(value));
 			}
-			else if (method == requests::SemanticTokensFull::name)
+			else
 			{
-				return handle_request(requests::SemanticTokensFull(std::move(msg)));
+				result = std::move(value);
 			}
-			else if (method == requests::SemanticTokensRange::name)
+		}
+
+		// Invoked immediately if the result is already available.
+		auto attach(std::function< void(RequestResult&&) > continuation) -> void
+		{
+			auto lock = std::scoped_lock{ mtx };
+			if (result)
 			{
-				return handle_request(requests::SemanticTokensRange(std::move(msg)));
+				auto value = *std::move(result);
+				result.reset();
+				continuation(std::move(value));
 			}
-			else if (method == requests::DocumentSymbols::name)
+			else if (!completed)
 			{
-				return handle_request(requests::DocumentSymbols(std::move(msg)));
+				on_complete = std::move(continuation);
 			}
-			else
+		}
+
+		auto detach() -> void
+		{
+			auto lock = std::scoped_lock{ mtx };
+			on_complete = {};
+		}
+	};
+
+	struct Server::RequestCompletion::Owner
+	{
+		explicit Owner(std::shared_ptr< DeferredRequestResult::State > result_state) : state{ std::move(result_state) }
+		{
+		}
+
+		~Owner()
+		{
+			state->complete(make_error_result(error_codes::internal_error, "Deferred request result abandoned"));
+		}
+
+		std::shared_ptr< DeferredRequestResult::State > state;
+	};
+
+	auto Server::RequestCompletion::operator() (RequestResult result) const -> void
+	{
+		owner->state->complete(std::move(result));
+	}
+
+	auto Server::defer_result() -> std::pair< DeferredRequestResult, RequestCompletion >
+	{
+		auto state = std::make_shared< DeferredRequestResult::State >();
+		auto owner = std::make_shared< RequestCompletion::Owner >(state);
+		return { DeferredRequestResult{ std::move(state) }, RequestCompletion{ std::move(owner) } };
+	}
+
+	Server::~Server()
+	{
+		// Outstanding requests have then all been handed to the implementation, or responded to.
+		if (executor)
+		{
+			executor->wait_all();
+		}
+
+		auto deferred = std::vector< std::shared_ptr< DeferredRequestResult::State > >{};
+		{
+			auto lock = std::scoped_lock{ active_requests_mtx };
+			for (auto const& active : active_requests)
 			{
-				return make_not_implemented_result();
+				if (active->deferred)
+				{
+					deferred.push_back(active->deferred);
+				}
 			}
-			}();
+		}
+		// Outside of active_requests_mtx, which the continuations take; detaching waits out any completion in progress.
+		for (auto const& state : deferred)
+		{
+			state->detach();
+		}
+	}
+
+	thread_local Server::ActiveRequest const* Server::current_request = nullptr;
+
+	auto Server::execute_request(std::optional< lsp::Request >&& request, DispatchedRequest& dispatched) -> PendingRequestResult
+	{
+		dispatched.handler_start = std::chrono::steady_clock::now();
+		if (!request)
+		{
+			return make_not_implemented_result();
+		}
+		if (dispatched.active->cancellation.is_cancelled())
+		{
+			// Cancelled while waiting to be executed.
+			return make_cancelled_result();
+		}
+
+		struct CurrentRequestScope
+		{
+			ActiveRequest const* previous;
+
+			~CurrentRequestScope()
+			{
+				current_request = previous;
+			}
+		} const scope{ std::exchange(current_request, dispatched.active.get()) };
+
+		return handle_request(std::move(*request));
+	}
+
+	auto Server::respond(PendingRequestResult&& result, DispatchedRequest&& dispatched) -> void
+	{
+		auto const deferred = std::get_if< DeferredRequestResult >(&result);
+		if (deferred == nullptr)
+		{
+			finish_request(std::move(dispatched), std::get< RequestResult >(std::move(result)), false);
+			return;
+		}
+
+		auto const state = deferred->state;
+		{
+			auto lock = std::scoped_lock{ active_requests_mtx };
+			dispatched.active->deferred = state;
+		}
+		state->attach([this, dispatched = std::move(dispatched)](RequestResult&& deferred_result) mutable {
+			finish_request(std::move(dispatched), std::move(deferred_result), true);
+			});
+	}
+
+	auto Server::finish_request(DispatchedRequest&& dispatched, RequestResult&& result, bool const deferred) -> void
+	{
+		dispatched.context.method_metrics->handler.record(nanoseconds_since(dispatched.handler_start));
+		unregister_request(dispatched.active);
+		if (dispatched.is_initialize)
+		{
+			apply_negotiated_capabilities(result);
+		}
+		process_semantic_tokens_result(dispatched.tokens_request, *dispatched.active, result);
+		if (!deferred)
+		{
+			// The document may since have changed, and its cached responses been invalidated.
+			cache_response(std::move(dispatched.cache_key), *dispatched.active, result);
+		}
+		complete_request(std::move(dispatched.id), std::move(result), dispatched.context.method_metrics);
 
-		// @todo: currently server implementation is able to send notifications itself, but responses are expected to be returned synchronously and handled here.
-		// feels inconsistent, and likely will want to allow an implementation to generate an async response - though could do that with similar approach using a future.
+		postprocess_message(DispatchResult{
+			.context = std::move(dispatched.context),
+			.dispatch_end = std::chrono::system_clock::now(),
+			.result = {
+				.response_cache = dispatched.cache_outcome,
+			},
+			});
+	}
+
+	auto Server::complete_request(boost::json::value&& request_id, RequestResult&& result, MethodMetrics* const method_metrics) const -> void
+	{
 		auto response = [&] {
-			auto json = boost::json::object{
+			// Built in the result's storage, so that the result is moved in rather than copied.
+			auto json = boost::json::object({
 				{ "jsonrpc", "2.0" },
 				{ keys::id, std::move(request_id) },
-			};
+				}, result.has_value() ? result->json.storage() : boost::json::storage_ptr{});
 
 			if (result.has_value())
 			{
 				static constexpr auto max_log_chars = 128;
-				log([&](auto out) {
-					return std::format_to(out, "Queueing response [success]: result={:s}...", boost::json::serialize(result->json) | std::views::take(max_log_chars));
-					});
+				log(LogLevel::debug, LogCategory::dispatch, "Queueing response [success]: result={}", JsonText{ result->json, max_log_chars });
 
+				if (!result->integer_arrays.empty() && result->json.is_null())
+				{
+					result->json = boost::json::object(result->json.storage());
+				}
 				json["result"] = std::move(result->json);
 			}
 			else
 			{
-				log([&](auto out) {
-					return std::format_to(out, "Queueing response [failure]: error={}", boost::json::serialize(result.error()));
-					});
+				log(LogLevel::debug, LogCategory::dispatch, "Queueing response [failure]: error={}", JsonText{ result.error() });
 
 				json["error"] = std::move(result).error();
 			}
 
 			return json;
 			}();
-		out_queue.push(std::move(response));
 
-		return {};
+		auto output = [&] {
+			if (result.has_value() && !result->integer_arrays.empty() && response.at("result").is_object())
+			{
+				// The result is the response's last member, as required for the transport to append the arrays to it.
+				return OutputMessage{ std::move(response), std::move(result->integer_arrays) };
+			}
+			return OutputMessage{ std::move(response) };
+			}();
+		output.serialize_metric = method_metrics != nullptr ? &method_metrics->serialize : nullptr;
+		out_queue.push(std::move(output));
 	}
 
-	auto Server::dispatch_notification(std::string_view const method, lsp::RawMessage&& msg) -> InternalMessageResult
+	auto Server::apply_negotiated_capabilities(RequestResult& initialize_result) -> void
 	{
-		log("Dispatching notification: method={}", method);
-		log([&](auto out) {
-			return std::ranges::copy(boost::json::serialize(msg), out).out;
-			});
+		if (!initialize_result.has_value() || !initialize_result->json.is_object())
+		{
+			return;
+		}
+
+		auto const capabilities = initialize_result->json.get_object().if_contains(keys::capabilities);
+		if (capabilities == nullptr || !capabilities->is_object())
+		{
+			documents.set_position_encoding(PositionEncoding::utf16);
+			return;
+		}
+
+		auto const encoding = capabilities->get_object().if_contains(keys::position_encoding);
+		if (encoding != nullptr && encoding->is_string() && encoding->get_string() == "utf-8")
+		{
+			documents.set_position_encoding(PositionEncoding::utf8);
+		}
+		else
+		{
+			documents.set_position_encoding(PositionEncoding::utf16);
+		}
 
-		if (method == notifications::Initialized::name)
+		// Advertise delta support on behalf of an implementation providing only full semantic tokens.
+		auto const tokens_provider = capabilities->get_object().if_contains(keys::semantic_tokens_provider);
+		if (impl.semantic_tokens_delta_from_full && tokens_provider != nullptr && tokens_provider->is_object())
+		{
+			auto const full = tokens_provider->get_object().if_contains(keys::full);
+			if (full != nullptr && full->is_bool() && full->get_bool())
+			{
+				*full = boost::json::object{
+					{ keys::delta, true },
+				};
+			}
+		}
+	}
+
+	auto Server::make_semantic_tokens_request(std::string_view const method, lsp::RawMessage const& msg) -> std::optional< SemanticTokensRequest >
+	{
+		if (method != requests::SemanticTokensFull::name && method != requests::SemanticTokensFullDelta::name)
+		{
+			return std::nullopt;
+		}
+		auto const document = message_document_uri(msg);
+		if (!document)
+		{
+			return std::nullopt;
+		}
+
+		auto request = SemanticTokensRequest{
+			.document = std::string{ *document },
+		};
+		auto const params = msg.if_contains(keys::params);
+		auto const previous_result_id = params != nullptr && params->is_object() ? params->get_object().if_contains(keys::previous_result_id) : nullptr;
+		if (previous_result_id != nullptr && previous_result_id->is_string())
+		{
+			request.previous_result_id = std::string{ previous_result_id->get_string() };
+		}
+		return request;
+	}
+
+	auto Server::process_semantic_tokens_result(std::optional< SemanticTokensRequest > const& request, ActiveRequest const& active, RequestResult& result) -> void
+	{
+		if (!request || !result.has_value())
 		{
-			// client initialization completed
-			handle_notification(notifications::Initialized(std::move(msg)));
+			return;
 		}
-		else if (method == notifications::Exit::name)
+		if (active.progress.partial_results_sent())
+		{
+			// The client assembled the data from the streamed chunks, which weren't recorded, so a later delta request is answered in full.
+			semantic_tokens.erase(request->document);
+			return;
+		}
+		if (result->json.is_null() && !result->integer_arrays.empty())
+		{
+			result->json = boost::json::object{};
+		}
+		if (result->json.is_object())
+		{
+			semantic_tokens.process_result(request->document, request->previous_result_id, result->json.get_object(), result->integer_arrays);
+		}
+	}
+
+	auto Server::dispatch_request(std::string_view const method, lsp::RawMessage&& msg, MessageContext const& context) -> InternalMessageResult
+	{
+		auto request_id = msg.at(keys::id);
+
+		if (take_queued_cancellation(request_id))
+		{
+			log(LogLevel::debug, LogCategory::dispatch, "Request cancelled before dispatch: id={}, method={}", JsonText{ request_id }, method);
+			complete_request(std::move(request_id), make_cancelled_result(), context.method_metrics);
+			return {};
+		}
+
+		if (auto const deadline = request_schedule(method).deadline; deadline.count() > 0 && context.dispatch_start - context.received > deadline)
+		{
+			log(LogLevel::debug, LogCategory::dispatch, "Request past its deadline, not dispatched: id={}, method={}", JsonText{ request_id }, method);
+			registry.stale_requests().fetch_add(1, std::memory_order_relaxed);
+			complete_request(std::move(request_id), make_error_result(error_codes::server_cancelled, "Request deadline exceeded"), context.method_metrics);
+			return {};
+		}
+
+		log(LogLevel::debug, LogCategory::dispatch, "Dispatching request: id={}, method={}", JsonText{ request_id }, method);
+		log_payload(msg);
+
+		if (method == metrics_request_method)
+		{
+			complete_request(std::move(request_id), RequestSuccessResult{ registry.report() }, context.method_metrics);
+			return {};
+		}
+
+		auto cache_key = response_cache_key(method, msg);
+		if (cache_key)
+		{
+			if (auto cached = response_cache->find(*cache_key); cached)
+			{
+				log(LogLevel::debug, LogCategory::dispatch, "Request answered from response cache: id={}, method={}", JsonText{ request_id }, method);
+				registry.response_cache_hits().fetch_add(1, std::memory_order_relaxed);
+				complete_request(std::move(request_id), RequestSuccessResult{ std::move(cached->json), std::move(cached->integer_arrays) }, context.method_metrics);
+				return {
+					.response_cache = ResponseCacheOutcome::hit,
+				};
+			}
+			registry.response_cache_misses().fetch_add(1, std::memory_order_relaxed);
+		}
+		auto const cache_outcome = cache_key ? ResponseCacheOutcome::miss : ResponseCacheOutcome::not_cacheable;
+
+		// @todo: not sure how best to appoach this, but as we currently return the request result synchronously we need to ensure that
+		// any pending notifications or prior requests that could potentially affect our result have already been processed.
+		// this would be fairly complex to try to handle based on what notifications there were and in what order they came, so for now
+		// we simply enforce synchronization before each request.
+		// with concurrent execution enabled the pump still runs here on the dispatching thread, ahead of handing the request off to a worker.
+		auto const pump_start = std::chrono::steady_clock::now();
+		impl.pump();
+		context.method_metrics->pump.record(nanoseconds_since(pump_start));
+
+		auto document = executor ? message_document_uri(msg).transform([](std::string_view uri) { return std::string{ uri }; }) : std::nullopt;
+		// Implementations handling delta requests themselves issue their own result ids, so their results are passed through untouched.
+		auto tokens_request = impl.semantic_tokens_delta_from_full ? make_semantic_tokens_request(method, msg) : std::nullopt;
+		auto const is_initialize = method == requests::Initialize::name;
+		if (is_initialize)
+		{
+			background.enable_progress(client_supports_work_done_progress(msg));
+		}
+
+		auto progress = RequestProgress(out_queue, msg);
+		auto request = DispatchTable< lsp::Request >::make(method, std::move(msg));
+		auto active = register_request(request_id, std::move(progress));
+		auto dispatched = DispatchedRequest{
+			.id = std::move(request_id),
+			.active = std::move(active),
+			.context = context,
+			.tokens_request = std::move(tokens_request),
+			.cache_key = std::move(cache_key),
+			.cache_outcome = cache_outcome,
+			.is_initialize = is_initialize,
+		};
+
+		if (document && request)
+		{
+			// Ordering relative to notifications for this document is ensured by dispatch_notification waiting on the document's outstanding requests.
+			executor->submit(*document, [this, request = std::move(request), dispatched = std::move(dispatched)]() mutable {
+				auto result = [&]() -> PendingRequestResult {
+					try
+					{
+						return execute_request(std::move(request), dispatched);
+					}
+					catch (...)
+					{
+						log(LogLevel::error, LogCategory::server, "Unhandled exception in request handler");
+						return make_error_result(error_codes::internal_error, "Request handler failed");
+					}
+					}();
+				respond(std::move(result), std::move(dispatched));
+				});
+		}
+		else
+		{
+			if (executor)
+			{
+				// Requests not associated with a document (initialize, shutdown) are ordered after all outstanding requests.
+				wait_for_requests(std::nullopt);
+			}
+			auto result = execute_request(std::move(request), dispatched);
+			respond(std::move(result), std::move(dispatched));
+		}
+
+		return {
+			.deferred = true,
+		};
+	}
+
+	auto Server::dispatch_notification(std::string_view const method, lsp::RawMessage&& msg, MessageContext const& context) -> InternalMessageResult
+	{
+		log(LogLevel::debug, LogCategory::dispatch, "Dispatching notification: method={}", method);
+		log_payload(msg);
+
+		if (executor)
+		{
+			// Notifications may modify state that outstanding requests depend on, so those must complete first.
+			wait_for_requests(message_document_uri(msg));
+		}
+
+		if (method == notifications::Exit::name)
 		{
 			return {
 				.exit = true,
 			};
 		}
-		else if (method == notifications::DidChangeConfiguration::name)
+
+		if (method == notifications::DidCloseTextDocument::name)
 		{
-			handle_notification(notifications::DidChangeConfiguration(std::move(msg)));
+			if (auto const document = message_document_uri(msg); document)
+			{
+				semantic_tokens.erase(*document);
+				diagnostics.forget(*document);
+			}
 		}
-		else if (method == notifications::DidOpenTextDocument::name)
+
+		if (method == notifications::DidChangeTextDocument::name || method == notifications::DidCloseTextDocument::name)
 		{
-			handle_notification(notifications::DidOpenTextDocument(std::move(msg)));
+			if (auto const document = message_document_uri(msg); document)
+			{
+				background.cancel_document(*document);
+			}
 		}
-		else if (method == notifications::DidChangeTextDocument::name)
+
+		if (response_cache)
 		{
-			handle_notification(notifications::DidChangeTextDocument(std::move(msg)));
+			// Notifications may change what the implementation would respond with.
+			if (auto const document = message_document_uri(msg); document)
+			{
+				response_cache->invalidate(*document);
+			}
+			else
+			{
+				response_cache->clear();
+			}
 		}
-		else if (method == notifications::DidCloseTextDocument::name)
+
+		auto notification = DispatchTable< lsp::Notification >::make(method, std::move(msg));
+		if (!notification)
 		{
-			handle_notification(notifications::DidCloseTextDocument(std::move(msg)));
+			log(LogLevel::debug, LogCategory::dispatch, "Ignoring unsupported notification: method={}", method);
+			return {};
 		}
 
+		// Text synchronization is applied to the server's document store before the implementation sees it.
+		std::visit([this]< typename Msg >(Msg const& typed) {
+			if constexpr (requires { this->documents.apply(typed); })
+			{
+				documents.apply(typed);
+			}
+			}, *notification);
+
+		auto const handler_start = std::chrono::steady_clock::now();
+		handle_notification(std::move(*notification));
+		context.method_metrics->handler.record(nanoseconds_since(handler_start));
+
 		return {};
 	}
 
@@ -164,34 +581,48 @@ namespace lsp_boot
 		auto const extract_document_id = [&]() -> std::string_view {
 			// @todo: intention is to include the readable name of the document. to do so will need to move top level control of the active documents
 			// from the implementation into the base server. which probably does make sense to do.
-			try
-			{
-				return message_params(json_msg)
-					.at(keys::text_document).as_object()
-					.at(keys::uri).as_string();
-			}
-			catch (...)
-			{
-				return "?"sv;
-			}
+			return message_document_uri(json_msg).value_or("?"sv);
 			};
 
-		auto identifier = std::format("{}:{} [{}]",
-			id_it != json_msg.end() ? std::to_string(value_to< std::uint64_t >(id_it->value())) : "?",
-			method_it != json_msg.end() ? std::string_view{ method_it->value().as_string() } : "?"sv,
-			extract_document_id());
+		// Only reported to the metrics sink, so not built without one.
+		auto identifier = std::string{};
+		if (metrics)
+		{
+			identifier = std::format("{}:{} [{}]",
+				// Ids may be strings, as in responses to requests made by the server.
+				id_it != json_msg.end() ? boost::json::serialize(id_it->value()) : "?",
+				method_it != json_msg.end() ? std::string_view{ method_it->value().as_string() } : "?"sv,
+				extract_document_id());
+		}
+
+		auto const method_metrics = method_it != json_msg.end() ? &registry.method(std::string_view{ method_it->value().as_string() }) : nullptr;
+		if (method_metrics != nullptr)
+		{
+			method_metrics->size.record(msg.size);
+			method_metrics->parse.record(std::uint64_t(msg.parse_time.count()));
+			method_metrics->queue_wait.record(nanoseconds_between(msg.received_time, dispatch_start_timestamp));
+		}
+		registry.input_backlog().record(backlog.size());
+
+		auto context = MessageContext{
+			.identifier = std::move(identifier),
+			.received = msg.received_time,
+			.dispatch_start = dispatch_start_timestamp,
+			.method_metrics = method_metrics,
+		};
 
 		auto const result = [&] {
 			if (id_it != json_msg.end())
 			{
 				if (method_it != json_msg.end())
 				{
-					return dispatch_request(method_it->value().as_string(), std::move(json_msg));
+					return dispatch_request(method_it->value().as_string(), std::move(json_msg), context);
 				}
+				dispatch_response(json_msg);
 			}
 			else if (method_it != json_msg.end())
 			{
-				return dispatch_notification(method_it->value().as_string(), std::move(json_msg));
+				return dispatch_notification(method_it->value().as_string(), std::move(json_msg), context);
 			}
 			return InternalMessageResult{};
 			}();
@@ -199,35 +630,367 @@ namespace lsp_boot
 		auto const dispatch_completion_timestamp = std::chrono::system_clock::now();
 
 		return {
-			.identifier = identifier,
-			.received = msg.received_time,
-			.dispatch_start = dispatch_start_timestamp,
+			.context = std::move(context),
 			.dispatch_end = dispatch_completion_timestamp,
 			.result = std::move(result)
 		};
 	}
 
-	auto Server::run() -> void
+	auto Server::dispatch_response(lsp::RawMessage const& msg) -> void
 	{
-		while (!shutdown)
+		// The only requests made by the server are those creating progress tokens for background jobs.
+		auto const& id = msg.at(keys::id);
+		auto const accepted = !msg.contains(keys::error);
+		if (!id.is_string() || !background.handle_progress_response(id.get_string(), accepted))
 		{
-			if (auto msg = in_queue.pop_with_abort([this] { return shutdown.load(); }); msg.has_value())
+			log(LogLevel::debug, LogCategory::dispatch, "Response to a request no longer awaited: id={}", JsonText{ id });
+		}
+	}
+
+	auto Server::enqueue_input(ReceivedMessage&& msg) -> void
+	{
+		if (has_method(msg.msg, notifications::CancelRequest::name))
+		{
+			process_cancellation(msg.msg);
+			return;
+		}
+
+		if (options.coalesce_document_changes && has_method(msg.msg, notifications::DidChangeTextDocument::name) && coalesce_document_change(msg))
+		{
+			return;
+		}
+
+		backlog.push_back(std::move(msg));
+	}
+
+	auto Server::coalesce_document_change(ReceivedMessage& msg) -> bool
+	{
+		// Bounds the cost of looking back through a long backlog.
+		constexpr std::ptrdiff_t max_scan_depth = 64;
+
+		auto const uri = message_document_uri(msg.msg);
+		auto const later = document_change_parts(msg.msg);
+		if (!uri || !later)
+		{
+			return false;
+		}
+
+		// Messages for other documents may be passed over; anything else relating to this document, or not associated with a document, ends the search.
+		auto const scan_end = backlog.rbegin() + std::min< std::ptrdiff_t >(std::ssize(backlog), max_scan_depth);
+		auto const target = std::ranges::find_if(backlog.rbegin(), scan_end, [&](ReceivedMessage const& queued) {
+			auto const queued_uri = message_document_uri(queued.msg);
+			return !queued_uri || *queued_uri == *uri;
+			});
+		if (target == scan_end || !has_method(target->msg, notifications::DidChangeTextDocument::name) || message_document_uri(target->msg) != uri)
+		{
+			return false;
+		}
+		auto const earlier = document_change_parts(target->msg);
+		if (!earlier)
+		{
+			return false;
+		}
+
+		// Changes are applied in sequence, so those preceding a full content replacement are superseded by it.
+		auto& changes = later->content_changes;
+		auto first = std::size_t{ 0 };
+		for (auto i = changes.size(); i > 0; --i)
+		{
+			if (auto const change = changes[i - 1].if_object(); change != nullptr && !change->contains(keys::range))
 			{
-				try
-				{
-					auto const result = dispatch_message(std::move(*msg));
-					postprocess_message(result);
+				first = i - 1;
+				earlier->content_changes.clear();
+				break;
+			}
+		}
+		for (auto i = first; i < changes.size(); ++i)
+		{
+			earlier->content_changes.push_back(std::move(changes[i]));
+		}
+		if (auto const version = later->text_document.if_contains(keys::version))
+		{
+			earlier->text_document[keys::version] = *version;
+		}
+
+		target->size += msg.size;
+		target->parse_time += msg.parse_time;
+		registry.coalesced_changes().fetch_add(1, std::memory_order_relaxed);
+		log(LogLevel::trace, LogCategory::dispatch, "Coalesced didChange into queued notification: uri={}", *uri);
+		return true;
+	}
 
-					if (result.result.exit)
+	auto Server::poll_input() -> void
+	{
+		while (auto msg = in_queue.try_pop())
+		{
+			enqueue_input(std::move(*msg));
+		}
+	}
+
+	auto Server::wait_for_requests(std::optional< std::string_view > const document) -> void
+	{
+		// Cancellations received in the meantime are applied, so that we're not left waiting on work nobody wants.
+		constexpr auto poll_interval = std::chrono::milliseconds{ 5 };
+
+		auto const document_key = document.transform([](std::string_view const uri) { return std::string{ uri }; });
+		do
+		{
+			poll_input();
+		} while (document_key ? !executor->wait_document_for(*document_key, poll_interval) : !executor->wait_all_for(poll_interval));
+	}
+
+	auto Server::next_backlog_index() -> std::size_t
+	{
+		// Bounds the cost of choosing with a long backlog; messages beyond this wait their turn.
+		constexpr std::size_t max_scan_depth = 64;
+
+		if (!options.prioritize_input)
+		{
+			return 0;
+		}
+
+		auto const priority_of = [this](lsp::RawMessage const& msg) {
+			if (!msg.contains(keys::id))
+			{
+				return InputPriority::interactive;
+			}
+			auto const method = msg.if_contains(keys::method);
+			return method != nullptr && method->is_string() ? request_schedule(method->get_string()).priority : InputPriority::normal;
+			};
+
+		passed_documents.clear();
+		auto next = std::size_t{ 0 };
+		auto next_priority = InputPriority::normal;
+		auto const scan_count = std::min(backlog.size(), max_scan_depth);
+		for (std::size_t index = 0; index < scan_count; ++index)
+		{
+			auto const& msg = backlog[index].msg;
+			auto const document = message_document_uri(msg);
+			if (!document)
+			{
+				// Neither passes, nor is passed by, anything.
+				break;
+			}
+
+			// Requests may pass requests for the same document, but not notifications, which may change what the request sees.
+			auto const is_notification = !msg.contains(keys::id);
+			auto const blocked = std::ranges::any_of(passed_documents, [&](auto const& passed) {
+				return passed.first == *document && (is_notification || passed.second);
+				});
+			if (!blocked)
+			{
+				auto const priority = priority_of(msg);
+				if (index == 0 || priority < next_priority)
+				{
+					next = index;
+					next_priority = priority;
+					if (priority == InputPriority::interactive)
 					{
 						break;
 					}
 				}
-				catch (...)
+			}
+			passed_documents.emplace_back(*document, is_notification);
+		}
+		return next;
+	}
+
+	auto Server::init_request_schedules() -> void
+	{
+		auto const schedule = options.request_schedule ? options.request_schedule : default_request_schedule;
+		[&]< std::size_t... Indices >(std::index_sequence< Indices... >) {
+			((request_schedules[Indices] = schedule(std::variant_alternative_t< Indices, lsp::Request >::kind)), ...);
+			}(std::make_index_sequence< std::variant_size_v< lsp::Request > >{});
+
+		auto const caching = options.response_caching ? options.response_caching : default_response_caching;
+		[&]< std::size_t... Indices >(std::index_sequence< Indices... >) {
+			((cached_requests[Indices] = caching(std::variant_alternative_t< Indices, lsp::Request >::kind)), ...);
+			}(std::make_index_sequence< std::variant_size_v< lsp::Request > >{});
+		// Results are tied to the result ids issued by the semantic tokens cache.
+		for (auto const method : { requests::SemanticTokensFull::name, requests::SemanticTokensFullDelta::name })
+		{
+			cached_requests[*DispatchTable< lsp::Request >::find(method)] = false;
+		}
+	}
+
+	auto Server::request_schedule(std::string_view const method) const -> RequestSchedule
+	{
+		auto const index = DispatchTable< lsp::Request >::find(method);
+		return index ? request_schedules[*index] : RequestSchedule{};
+	}
+
+	auto Server::response_cache_key(std::string_view const method, lsp::RawMessage const& msg) const -> std::optional< ResponseCache::Key >
+	{
+		if (!response_cache)
+		{
+			return std::nullopt;
+		}
+		auto const index = DispatchTable< lsp::Request >::find(method);
+		if (!index || !cached_requests[*index])
+		{
+			return std::nullopt;
+		}
+		auto const document = message_document_uri(msg);
+		auto const version = document ? documents.version(*document) : std::nullopt;
+		if (!version)
+		{
+			return std::nullopt;
+		}
+		return ResponseCache::make_key(method, *document, *version, msg);
+	}
+
+	auto Server::cache_response(std::optional< ResponseCache::Key >&& key, ActiveRequest const& active, RequestResult const& result) -> void
+	{
+		// A streamed result isn't complete without the partial results that preceded it.
+		if (key && result.has_value() && !active.progress.partial_results_sent())
+		{
+			response_cache->insert(std::move(*key), result->json, result->integer_arrays);
+		}
+	}
+
+	auto Server::process_cancellation(lsp::RawMessage const& msg) -> void
+	{
+		auto const params = msg.if_contains(keys::params);
+		auto const request_id = params != nullptr && params->is_object() ? params->get_object().if_contains(keys::id) : nullptr;
+		if (request_id == nullptr)
+		{
+			return;
+		}
+
+		log(LogLevel::debug, LogCategory::dispatch, "Cancellation requested: id={}", JsonText{ *request_id });
+
+		{
+			auto lock = std::scoped_lock{ active_requests_mtx };
+			auto const it = std::ranges::find_if(active_requests, [&](auto const& active) {
+				return active->id == *request_id;
+				});
+			if (it != active_requests.end())
+			{
+				(*it)->cancellation.cancel();
+				return;
+			}
+		}
+
+		auto const is_queued = std::ranges::any_of(backlog, [&](ReceivedMessage const& queued) {
+			auto const queued_id = queued.msg.if_contains(keys::id);
+			return queued_id != nullptr && *queued_id == *request_id && queued.msg.contains(keys::method);
+			});
+		if (is_queued)
+		{
+			cancelled_queued_requests.push_back(*request_id);
+		}
+	}
+
+	auto Server::take_queued_cancellation(boost::json::value const& request_id) -> bool
+	{
+		auto const it = std::ranges::find(cancelled_queued_requests, request_id);
+		if (it == cancelled_queued_requests.end())
+		{
+			return false;
+		}
+		cancelled_queued_requests.erase(it);
+		return true;
+	}
+
+	auto Server::register_request(boost::json::value const& request_id, RequestProgress&& progress) -> std::shared_ptr< ActiveRequest >
+	{
+		// In synchronous mode the handler runs on the dispatching thread, which is then not otherwise looking at input,
+		// so we have checks of the request's cancellation token from that thread poll for newly arrived cancellations.
+		// The token may be passed to other threads, and outlive the server.
+		auto poll = executor ? std::function< void() >{} : std::function< void() >{ [server = std::weak_ptr{ self }, thread = dispatch_thread] {
+			if (std::this_thread::get_id() == thread)
+			{
+				if (auto const target = server.lock())
+				{
+					(*target)->poll_input();
+				}
+			}
+			} };
+
+		auto active = std::make_shared< ActiveRequest >(ActiveRequest{
+			.id = request_id,
+			.cancellation = CancellationSource{ std::move(poll) },
+			.progress = std::move(progress),
+			});
+		// Low priority background tasks are held back until the request completes.
+		background.enter_foreground();
+
+		auto lock = std::scoped_lock{ active_requests_mtx };
+		active_requests.push_back(active);
+		return active;
+	}
+
+	auto Server::unregister_request(std::shared_ptr< ActiveRequest > const& active) -> void
+	{
+		active->progress.close();
+		background.leave_foreground();
+
+		auto lock = std::scoped_lock{ active_requests_mtx };
+		std::erase(active_requests, active);
+	}
+
+	auto Server::run() -> void
+	{
+		dispatch_thread = std::this_thread::get_id();
+
+		while (!shutdown)
+		{
+			if (backlog.empty())
+			{
+				if (auto msg = in_queue.pop_with_abort([this] { return shutdown.load(); }); msg.has_value())
 				{
-					break;
+					enqueue_input(std::move(*msg));
 				}
 			}
+
+			if (!dispatch_next())
+			{
+				break;
+			}
+		}
+	}
+
+	auto Server::run_available() -> bool
+	{
+		dispatch_thread = std::this_thread::get_id();
+
+		do
+		{
+			if (shutdown || !dispatch_next())
+			{
+				return false;
+			}
+		} while (!backlog.empty());
+		return !shutdown;
+	}
+
+	auto Server::dispatch_next() -> bool
+	{
+		poll_input();
+		if (backlog.empty())
+		{
+			return true;
+		}
+
+		auto const next = backlog.begin() + std::ptrdiff_t(next_backlog_index());
+		auto msg = std::move(*next);
+		backlog.erase(next);
+
+		try
+		{
+			auto const result = dispatch_message(std::move(msg));
+			if (!result.result.deferred)
+			{
+				postprocess_message(result);
+			}
+			dump_metrics_if_due();
+
+			return !result.result.exit;
+		}
+		catch (...)
+		{
+			log(LogLevel::error, LogCategory::server, "Unhandled exception during dispatch, exiting");
+			return false;
 		}
 	}
 
@@ -237,24 +1000,109 @@ namespace lsp_boot
 		in_queue.notify();
 	}
 
+	auto Server::drain_requests() -> void
+	{
+		if (executor)
+		{
+			executor->wait_all();
+		}
+	}
+
 	auto Server::postprocess_message(DispatchResult const& result) const -> void
 	{
+		if (result.context.method_metrics != nullptr)
+		{
+			result.context.method_metrics->response.record(nanoseconds_between(result.context.received, result.dispatch_end));
+		}
+
 		if (metrics)
 		{
 			metrics(result.metrics());
 		}
 	}
 
+	auto Server::dump_metrics_if_due() -> void
+	{
+		if (options.metrics_dump_interval.count() <= 0)
+		{
+			return;
+		}
+
+		auto const now = std::chrono::steady_clock::now();
+		if (now - last_metrics_dump >= options.metrics_dump_interval)
+		{
+			last_metrics_dump = now;
+			log(LogLevel::info, LogCategory::metrics, [this](auto out) {
+				return std::ranges::copy(registry.format_report(), out).out;
+				});
+		}
+	}
+
 	auto Server::send_notification_impl(lsp::RawMessage&& msg) const -> void
 	{
 		out_queue.push(std::move(msg));
 	}
 
-	auto Server::log_impl(LogOutputCallbackView callback) const -> void
+	auto Server::publish_diagnostics_impl(std::string_view const uri, std::optional< std::int64_t > const version, std::vector< lsp::Diagnostic >&& diagnostics_set) const -> void
+	{
+		diagnostics.publish(uri, version, std::move(diagnostics_set));
+	}
+
+	auto Server::log_impl(LogRecord& record) const -> void
+	{
+		if (log_writer)
+		{
+			log_writer->submit(record);
+		}
+	}
+
+	auto Server::log_payload(lsp::RawMessage const& msg) const -> void
 	{
-		if (logger)
+		if (!log_writer || !log_enabled(LogLevel::trace, LogCategory::payload))
 		{
-			logger(std::move(callback));
+			return;
 		}
+
+		// Serialized on the log writer thread, from a copy made in the message's own storage: where that's an arena, copying is little more than
+		// pointer bumps, and the copy keeps the arena alive until written.
+		auto& record = log_record_buffer();
+		record.text.clear();
+		record.payload.emplace(boost::json::object(msg, msg.storage()));
+		log_writer->submit(record);
+	}
+
+	auto Server::cancellation_token_impl() const -> CancellationToken
+	{
+		return current_request != nullptr ? current_request->cancellation.token() : CancellationToken{};
+	}
+
+	auto Server::submit_background_impl(BackgroundTask&& task, BackgroundTaskOptions const& options) const -> void
+	{
+		background.submit(std::move(task), options);
+	}
+
+	auto Server::start_background_job_impl(std::string_view const title, BackgroundTaskOptions&& options) const -> BackgroundJob
+	{
+		return background.start_job(title, std::move(options));
+	}
+
+	auto Server::partial_results_impl() const -> PartialResultStream
+	{
+		return current_request != nullptr ? current_request->progress.partial_results() : PartialResultStream{};
+	}
+
+	auto Server::work_done_progress_impl() const -> WorkDoneProgress
+	{
+		return current_request != nullptr ? current_request->progress.work_done() : WorkDoneProgress{};
+	}
+
+	auto Server::document_impl(std::string_view const uri) const -> std::optional< DocumentSnapshot >
+	{
+		return documents.snapshot(uri);
+	}
+
+	auto Server::json_storage_impl() const -> boost::json::storage_ptr
+	{
+		return options.arena_pool != nullptr ? options.arena_pool->make_storage() : boost::json::storage_ptr{};
 	}
 }
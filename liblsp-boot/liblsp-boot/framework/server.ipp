@@ -4,6 +4,7 @@ module;
 #if defined(LSP_BOOT_ENABLE_IMPORT_STD)
 import std;
 #else
+#include <cstdint>
 #include <type_traits>
 #include <utility>
 #include <string>
@@ -13,6 +14,12 @@ import std;
 #include <expected>
 #include <iterator>
 #include <memory>
+#include <optional>
+#include <vector>
+#include <array>
+#include <deque>
+#include <thread>
+#include <mutex>
 #include <chrono>
 #include <atomic>
 #endif
@@ -21,6 +28,18 @@ export module lsp_boot.server;
 
 import lsp_boot.lsp;
 import lsp_boot.work_queue;
+import lsp_boot.request_executor;
+import lsp_boot.thread_pool;
+import lsp_boot.cancellation;
+import lsp_boot.document_store;
+import lsp_boot.logging;
+import lsp_boot.metrics;
+import lsp_boot.message_arena;
+import lsp_boot.semantic_tokens;
+import lsp_boot.response_cache;
+import lsp_boot.diagnostics;
+import lsp_boot.progress;
+import lsp_boot.background_tasks;
 import lsp_boot.utility;
 
 import lsp_boot.ext_mod_wrap.boost.json;
@@ -52,18 +71,169 @@ namespace lsp_boot
 	//	NotificationHandler< notifications::DidCloseTextDocument >
 	//>;
 
+	/**
+	 * Whether a request was answered from the response cache (see ServerOptions::response_cache_bytes).
+	 */
+	export enum class ResponseCacheOutcome : std::uint8_t
+	{
+		not_cacheable,
+		hit,
+		miss,
+	};
+
 	export struct MessageMetrics
 	{
 		std::string identifier;
 		std::chrono::microseconds response;
 		std::chrono::microseconds dispatch;
+		ResponseCacheOutcome response_cache = ResponseCacheOutcome::not_cacheable;
 	};
 
 	using MetricsSink = std::function< void(MessageMetrics const&) >;
 
-	using LogOutputIter = std::ostream_iterator< char >;
-	export using LogOutputCallbackView = std::function< LogOutputIter(LogOutputIter) >&&; // Ideally would be function_view
-	using LoggingSink = std::function< void(LogOutputCallbackView) >;
+	/**
+	 * Scheduling class of queued input. Lower classes are dispatched first, where ordering constraints allow (see ServerOptions::prioritize_input).
+	 */
+	export enum class InputPriority : std::uint8_t
+	{
+		interactive,
+		normal,
+		bulk,
+	};
+
+	export struct RequestSchedule
+	{
+		InputPriority priority = InputPriority::normal;
+
+		/**
+		 * If non-zero, a request which has been waiting for longer than this by the time it would be dispatched is instead answered with
+		 * a ServerCancelled error, which clients treat as the request having been dropped (and may reissue).
+		 */
+		std::chrono::milliseconds deadline{ 0 };
+	};
+
+	/**
+	 * Position based queries which the user is waiting on are interactive, and whole document queries bulk. No deadlines are set.
+	 */
+	export constexpr auto default_request_schedule(lsp::requests::Kinds const kind) -> RequestSchedule
+	{
+		using enum lsp::requests::Kinds;
+		switch (kind)
+		{
+		case hover:
+		case inlay_hint:
+		case semantic_tokens_range:
+			return { .priority = InputPriority::interactive };
+		case document_symbols:
+		case semantic_tokens_full:
+		case semantic_tokens_full_delta:
+			return { .priority = InputPriority::bulk };
+		default:
+			return {};
+		}
+	}
+
+	/**
+	 * Position and range based queries, which clients tend to repeat on focus changes and scrolling.
+	 */
+	export constexpr auto default_response_caching(lsp::requests::Kinds const kind) -> bool
+	{
+		using enum lsp::requests::Kinds;
+		switch (kind)
+		{
+		case hover:
+		case inlay_hint:
+		case document_symbols:
+		case semantic_tokens_range:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	export struct ServerOptions
+	{
+		/**
+		 * Number of worker threads on which to execute requests. With the default of 0, requests are handled synchronously on the thread calling Server::run.
+		 * When non-zero, requests pertaining to a document are executed on the workers, concurrently with requests for other documents and with the
+		 * implementation's pump(), which is still invoked on the dispatching thread. Requests for a given document are handled in order, and always after
+		 * any preceding notifications for that document. Requests and notifications not associated with a document wait for all outstanding requests.
+		 * Logging and metrics sinks may be invoked from worker threads in this mode.
+		 */
+		std::size_t request_workers = 0;
+
+		/**
+		 * If set, requests are executed as described for request_workers, but on this pool rather than on threads owned by the server.
+		 * Allows servers for several sessions (see SocketHost) to share a common set of workers. Must outlive the server.
+		 */
+		ThreadPool* worker_pool = nullptr;
+
+		/**
+		 * Minimum level and enabled categories (see log_category_mask) of records passed to the logging sink; adjustable later via Server::set_log_filter.
+		 * Records are formatted only if enabled, and are written to the sink from a background thread.
+		 */
+		LogLevel log_level = LogLevel::info;
+		std::uint32_t log_categories = all_log_categories;
+
+		/**
+		 * If non-zero, a summary of the server's metrics (see Server::metrics_registry) is logged at this interval, in the metrics category at info level.
+		 * The interval is checked following each dispatch.
+		 */
+		std::chrono::seconds metrics_dump_interval = std::chrono::seconds{ 0 };
+
+		/**
+		 * Whether a didChange notification arriving while an earlier one for the same document is still waiting in the input backlog is folded into it,
+		 * so that the implementation sees a single notification with the combined contentChanges and the latest version.
+		 * Only messages for other documents may lie in between; a request or other notification for the same document, or any message not associated
+		 * with a document, preserves the ordering. Folded notifications are counted in MetricsRegistry::coalesced_changes.
+		 */
+		bool coalesce_document_changes = false;
+
+		/**
+		 * Whether queued input is dispatched by priority class (see request_schedule), rather than strictly in order of arrival, so that eg. a hover
+		 * need not wait behind a full semantic tokens request received just before it. Notifications are interactive.
+		 * A message may only be dispatched ahead of earlier ones for other documents, and never ahead of a notification for its own document;
+		 * notifications, and messages not associated with a document, keep their position relative to everything else they relate to.
+		 */
+		bool prioritize_input = false;
+
+		/**
+		 * Priority class and deadline of each kind of request. Deadlines apply regardless of prioritize_input. Requests not known to the
+		 * framework have the default RequestSchedule.
+		 */
+		std::function< RequestSchedule(lsp::requests::Kinds) > request_schedule = default_request_schedule;
+
+		/**
+		 * Approximate memory budget in bytes for caching responses to requests on open documents; 0 (the default) disables the cache.
+		 * A request repeating the method and params of an earlier one, for an unchanged version of the document, is then answered with the earlier
+		 * result, without involving the implementation. Entries for a document are dropped on any notification for that document, and the whole
+		 * cache on any notification not associated with a document. The implementation's results must therefore depend only on the document
+		 * version and the params, and not on other documents. Full and delta semantic tokens requests are never cached.
+		 */
+		std::size_t response_cache_bytes = 0;
+
+		/**
+		 * Which kinds of requests are cached, when the cache is enabled.
+		 */
+		std::function< bool(lsp::requests::Kinds) > response_caching = default_response_caching;
+
+		/**
+		 * Number of threads on which background tasks submitted by the implementation are run (see ServerImplAPI::submit_background).
+		 * With the default of 0, tasks are run synchronously on the submitting thread.
+		 */
+		std::size_t background_workers = 0;
+
+		/**
+		 * Debouncing and pacing of diagnostics published via ServerImplAPI::publish_diagnostics.
+		 */
+		DiagnosticsOptions diagnostics = {};
+
+		/**
+		 * If set, ServerImplAPI::json_storage provides arenas from this pool for building results. Typically the same pool is given to the transport
+		 * (see InputOptions::arena_pool). Must outlive the server.
+		 */
+		MessageArenaPool* arena_pool = nullptr;
+	};
 
 	export class ServerImplAPI
 	{
@@ -77,30 +247,153 @@ namespace lsp_boot
 		}
 
 		/**
-		 * Server side logger.
+		 * Replace the diagnostics shown for a document. May be called from any thread, eg. on completion of background analysis.
+		 * Sent as a textDocument/publishDiagnostics notification once updates for the document settle (see ServerOptions::diagnostics); only the
+		 * latest set is sent, and nothing at all if it's unchanged from the set last sent. Pass an empty set to clear the document's diagnostics.
 		 */
-		template < std::invocable< LogOutputIter > Callback >
-		auto log(Callback&& callback) const -> void
+		auto publish_diagnostics(std::string_view uri, std::optional< std::int64_t > version, std::vector< lsp::Diagnostic > diagnostics) const -> void
+		{
+			publish_diagnostics_impl(uri, version, std::move(diagnostics));
+		}
+
+		/**
+		 * Whether records of the given level and category are currently being logged, allowing preparation of expensive arguments to be skipped.
+		 */
+		auto log_enabled(LogLevel const level, LogCategory const category = LogCategory::implementation) const -> bool
+		{
+			return log_filter.is_enabled(level, category);
+		}
+
+		/**
+		 * Server side logger. The callback writes the record to the iterator it's passed, and is only invoked if the level and category are enabled.
+		 */
+		template < std::invocable< LogRecordIter > Callback >
+		auto log(LogLevel const level, LogCategory const category, Callback&& callback) const -> void
 		{
-			static_assert(std::convertible_to< std::invoke_result_t< Callback, LogOutputIter >, LogOutputIter >);
-			log_impl(std::forward< Callback >(callback));
+			static_assert(std::convertible_to< std::invoke_result_t< Callback, LogRecordIter >, LogRecordIter >);
+			if (!log_filter.is_enabled(level, category))
+			{
+				return;
+			}
+
+			auto& record = log_record_buffer();
+			record.text.clear();
+			std::invoke(std::forward< Callback >(callback), std::back_inserter(record.text));
+			log_impl(record);
 		}
 
 		/**
-		 * Server side logger simplified interface taking pre-evaluated arguments.
+		 * Server side logger simplified interface. Formatting is skipped if the level and category are disabled, though note that
+		 * the arguments themselves are evaluated regardless (see JsonText for deferring JSON serialization).
 		 */
 		template < typename... Args >
-		auto log(std::basic_format_string< char, std::type_identity_t< Args >... > fmt_str, Args&&... args) const -> void
+		auto log(LogLevel const level, LogCategory const category, std::basic_format_string< char, std::type_identity_t< Args >... > fmt_str, Args&&... args) const -> void
 		{
-			// @todo: currently this is assuming the logging sink is synchronous...
-			log_impl([&](LogOutputIter out) {
+			log(level, category, [&](LogRecordIter out) {
 				return std::format_to(out, fmt_str, std::forward< Args >(args)...);
 				});
 		}
 
+		/**
+		 * Logs an implementation record at info level.
+		 */
+		template < std::invocable< LogRecordIter > Callback >
+		auto log(Callback&& callback) const -> void
+		{
+			log(LogLevel::info, LogCategory::implementation, std::forward< Callback >(callback));
+		}
+
+		template < typename... Args >
+		auto log(std::basic_format_string< char, std::type_identity_t< Args >... > fmt_str, Args&&... args) const -> void
+		{
+			log(LogLevel::info, LogCategory::implementation, fmt_str, std::forward< Args >(args)...);
+		}
+
+		/**
+		 * Cancellation token for the request being handled on the calling thread, signalled when the client sends $/cancelRequest for it.
+		 * Long running handlers can check it periodically and return early once cancelled. Outside of a request handler the token is never cancelled.
+		 */
+		auto cancellation_token() const -> CancellationToken
+		{
+			return cancellation_token_impl();
+		}
+
+		/**
+		 * Streams of partial results and work done progress for the request being handled on the calling thread, active if the client supplied
+		 * the corresponding tokens with the request. Allows results of large requests (eg. symbols or semantic tokens of a huge file) to reach
+		 * the client as they're produced, rather than only once complete. The streams may be passed on to other threads, such as those producing
+		 * a deferred result. Outside of a request handler the streams are inactive.
+		 */
+		auto partial_results() const -> PartialResultStream
+		{
+			return partial_results_impl();
+		}
+
+		auto work_done_progress() const -> WorkDoneProgress
+		{
+			return work_done_progress_impl();
+		}
+
+		/**
+		 * Runs task in the background, on the server's pool of background workers (see ServerOptions::background_workers), concurrently with
+		 * request handling. Tasks of low priority aren't started while a request is being handled, and running tasks can check whether to yield
+		 * via their context. A task tied to a document is cancelled when the document changes or is closed. Safe to call from any thread.
+		 */
+		auto submit_background(BackgroundTask task, BackgroundTaskOptions const& options = {}) const -> void
+		{
+			submit_background_impl(std::move(task), options);
+		}
+
+		/**
+		 * Group of background tasks reported to the client as work done progress with the given title, as they complete (if the client supports
+		 * server initiated progress). Tasks submitted through the job run as if submitted via submit_background with the given options.
+		 */
+		auto start_background_job(std::string_view title, BackgroundTaskOptions options = {}) const -> BackgroundJob
+		{
+			return start_background_job_impl(title, std::move(options));
+		}
+
+		/**
+		 * Snapshot of the current content of an open document, maintained by the server from the client's text synchronization notifications.
+		 * Positions are interpreted according to the positionEncoding returned in the implementation's initialize result (UTF-16 if unspecified).
+		 */
+		auto document(std::string_view uri) const -> std::optional< DocumentSnapshot >
+		{
+			return document_impl(uri);
+		}
+
+		/**
+		 * Storage in which to build a result, or a notification. If the server was given an arena pool, this is a fresh arena, freed as a whole
+		 * once the message has been written out; otherwise the default heap storage. All values making up the message should use the same storage,
+		 * as moving a value into a container with different storage copies it.
+		 */
+		auto json_storage() const -> boost::json::storage_ptr
+		{
+			return json_storage_impl();
+		}
+
+	protected:
+		static auto log_record_buffer() -> LogRecord&
+		{
+			thread_local auto buffer = LogRecord{};
+			return buffer;
+		}
+
+		LogFilter log_filter;
+
 	private:
+
 		virtual auto send_notification_impl(lsp::RawMessage&&) const -> void = 0;
-		virtual auto log_impl(LogOutputCallbackView) const -> void = 0;
+		virtual auto publish_diagnostics_impl(std::string_view uri, std::optional< std::int64_t > version, std::vector< lsp::Diagnostic >&& diagnostics) const -> void = 0;
+		// Takes the formatted record, leaving record with a buffer to be reused.
+		virtual auto log_impl(LogRecord& record) const -> void = 0;
+		virtual auto cancellation_token_impl() const -> CancellationToken = 0;
+		virtual auto partial_results_impl() const -> PartialResultStream = 0;
+		virtual auto work_done_progress_impl() const -> WorkDoneProgress = 0;
+		virtual auto submit_background_impl(BackgroundTask&& task, BackgroundTaskOptions const& options) const -> void = 0;
+		virtual auto start_background_job_impl(std::string_view title, BackgroundTaskOptions&& options) const -> BackgroundJob = 0;
+		virtual auto document_impl(std::string_view uri) const -> std::optional< DocumentSnapshot > = 0;
+		virtual auto json_storage_impl() const -> boost::json::storage_ptr = 0;
 	};
 
 	export class Server : private ServerImplAPI
@@ -109,6 +402,11 @@ namespace lsp_boot
 		struct RequestSuccessResult
 		{
 			boost::json::value json;
+			/**
+			 * Large integer arrays (semantic token data, for example) to be added to the result without going through the JSON DOM.
+			 * These are formatted directly into the output buffer by the transport. json must then be an object, or null (treated as an empty object).
+			 */
+			std::vector< IntegerArrayField > integer_arrays = {};
 		};
 		struct NotificationSuccessResult
 		{
@@ -117,15 +415,65 @@ namespace lsp_boot
 
 		using RequestResult = std::expected< RequestSuccessResult, ResponseError >;
 		using NotificationResult = std::expected< NotificationSuccessResult, ResponseError >;
+
+		class RequestCompletion;
+
+		/**
+		 * Request handlers may alternatively return a deferred result (see defer_result), completed later from any thread, eg. by a background task.
+		 * Neither the dispatch of further input nor a request worker is held up meanwhile. Notifications following the request aren't held back
+		 * for it either, so the handler should capture whatever state it needs (such as a document snapshot) before returning.
+		 * The response is queued, and the metrics sink invoked, on the completing thread. Deferred results aren't cached (see ServerOptions::response_cache_bytes).
+		 */
+		class DeferredRequestResult
+		{
+		private:
+			friend class Server;
+			friend class RequestCompletion;
+
+			struct State;
+
+			explicit DeferredRequestResult(std::shared_ptr< State > result_state) : state{ std::move(result_state) }
+			{
+			}
+
+			std::shared_ptr< State > state;
+		};
+
+		/**
+		 * Completes a deferred result. May be copied, and invoked from any thread; only the first completion has any effect.
+		 * If every copy is destroyed without one, the request fails with an internal error.
+		 */
+		class RequestCompletion
+		{
+		public:
+			auto operator() (RequestResult result) const -> void;
+
+		private:
+			friend class Server;
+
+			struct Owner;
+
+			explicit RequestCompletion(std::shared_ptr< Owner > completion_owner) : owner{ std::move(completion_owner) }
+			{
+			}
+
+			std::shared_ptr< Owner > owner;
+		};
+
+		static auto defer_result() -> std::pair< DeferredRequestResult, RequestCompletion >;
+
+		using PendingRequestResult = std::variant< RequestResult, DeferredRequestResult >;
 		
 		using ServerPump = std::function< void() >;
 
 		struct ServerImplementation
 		{
 			std::shared_ptr< void const > type_erased;
-			std::function< RequestResult(lsp::Request&&) > handle_request;
+			std::function< PendingRequestResult(lsp::Request&&) > handle_request;
 			std::function< NotificationResult(lsp::Notification&&) > handle_notification;
 			std::function< void() > pump;
+			// Implementation handles full semantic tokens requests only, with delta requests answered by the framework from the full result.
+			bool semantic_tokens_delta_from_full = false;
 		};
 
 		// @todo: concept for the type returned by the Init.
@@ -136,24 +484,100 @@ namespace lsp_boot
 			OutputQueue& output_queue,
 			ImplementationInit&& implementation_init,
 			LoggingSink logging_sink = {},
-			MetricsSink metrics_sink = {})
-			: in_queue{ pending_input_queue }, out_queue{ output_queue }, logger{ logging_sink }, metrics{ std::move(metrics_sink) }
+			MetricsSink metrics_sink = {},
+			ServerOptions server_options = {})
+			: in_queue{ pending_input_queue }, out_queue{ output_queue }, metrics{ std::move(metrics_sink) }, options{ server_options }
 		{
+			if (logging_sink)
+			{
+				log_filter.set(options.log_level, options.log_categories);
+				log_writer = std::make_unique< AsyncLogWriter >(std::move(logging_sink));
+			}
+			else
+			{
+				log_filter.set(LogLevel::off);
+			}
+
 			impl = wrap_implementation(std::forward< ImplementationInit >(implementation_init));
+			init_request_schedules();
+			if (options.response_cache_bytes > 0)
+			{
+				response_cache.emplace(options.response_cache_bytes);
+			}
+			if (options.worker_pool != nullptr)
+			{
+				executor = std::make_unique< RequestExecutor >(*options.worker_pool);
+			}
+			else if (options.request_workers > 0)
+			{
+				executor = std::make_unique< RequestExecutor >(options.request_workers);
+			}
 		}
 
+		/**
+		 * Deferred results completed from here on are discarded.
+		 */
+		~Server();
+
 		auto run() -> void;
+
+		/**
+		 * Non-blocking alternative to run, for hosts serving many sessions from shared threads: dispatches the input queued so far, along with
+		 * any arriving meanwhile, and returns once there's none left. Returns false once the server has exited (or been asked to shut down),
+		 * after which it shouldn't be called again. Calls mustn't overlap, but may be made from different threads.
+		 * Note dispatch still blocks while a synchronous handler runs, and for notifications waiting on outstanding requests.
+		 */
+		auto run_available() -> bool;
+
+		/**
+		 * Makes run return once any message being dispatched has been handled. Input still queued is not dispatched.
+		 */
 		auto request_shutdown() -> void;
 
+		/**
+		 * Blocks until requests executing on worker threads have completed, so that their responses are queued. Deferred results excepted.
+		 */
+		auto drain_requests() -> void;
+
+		/**
+		 * Has no effect if the server was constructed without a logging sink.
+		 */
+		auto set_log_filter(LogLevel const level, std::uint32_t const categories = all_log_categories) -> void
+		{
+			if (log_writer)
+			{
+				log_filter.set(level, categories);
+			}
+		}
+
+		/**
+		 * Per method latency and size histograms, and transport statistics; also available to clients via the $/lsp-boot/metrics request.
+		 * To include output serialization statistics, pass &metrics_registry().output() in the connection's OutputBatchOptions.
+		 */
+		auto metrics_registry() -> MetricsRegistry&
+		{
+			return registry;
+		}
+
 	private:
-		static auto make_not_implemented_result()
+		static auto make_error_result(int const code, std::string_view const message)
 		{
 			return std::unexpected(ResponseError{
-				{ "code", -32803 }, // request failed. @todo: make error codes enum.
-				{ "message", "Not implemented" },
+				{ "code", code },
+				{ "message", message },
 			});
 		}
 
+		static auto make_not_implemented_result()
+		{
+			return make_error_result(lsp::error_codes::request_failed, "Not implemented");
+		}
+
+		static auto make_cancelled_result()
+		{
+			return make_error_result(lsp::error_codes::request_cancelled, "Request cancelled");
+		}
+
 		template < auto kind, FixedString name >
 		static auto make_default_result(lsp::JsonMessage< kind, name > const&)
 		{
@@ -192,6 +616,11 @@ namespace lsp_boot
 						{
 							return (*impl_ptr)(std::move(msg));
 						}
+						else if constexpr (std::same_as< Msg, lsp::requests::SemanticTokensFullDelta > && requires { (*impl_ptr)(std::declval< lsp::requests::SemanticTokensFull >()); })
+						{
+							// Edits are computed from the full result, see SemanticTokensCache.
+							return (*impl_ptr)(lsp::requests::SemanticTokensFull(*std::move(msg)));
+						}
 						else
 						{
 							/* @todo: log unsupported/maybe check against our published capabilities. */
@@ -203,23 +632,37 @@ namespace lsp_boot
 
 			return ServerImplementation{
 				std::move(typed_impl),
-				make_message_handler(std::in_place_type< RequestResult >),
+				make_message_handler(std::in_place_type< PendingRequestResult >),
 				make_message_handler(std::in_place_type< NotificationResult >),
 				[impl_ptr] { impl_ptr->pump(); },
+				requires { (*impl_ptr)(std::declval< lsp::requests::SemanticTokensFull >()); }
+					&& !requires { (*impl_ptr)(std::declval< lsp::requests::SemanticTokensFullDelta >()); },
 			};
 		}
 
 		struct InternalMessageResult
 		{
 			bool exit = false;
+			// Postprocessed on completion of the request, which may be on another thread (see respond).
+			bool deferred = false;
+			ResponseCacheOutcome response_cache = ResponseCacheOutcome::not_cacheable;
 		};
 
-		struct DispatchResult
+		struct MessageContext
 		{
+			// Empty unless there's a metrics sink to report it to.
 			std::string identifier;
 
 			std::chrono::system_clock::time_point received;
 			std::chrono::system_clock::time_point dispatch_start;
+
+			// Null for messages without a method (responses to requests made by the server), which aren't recorded per method.
+			MethodMetrics* method_metrics;
+		};
+
+		struct DispatchResult
+		{
+			MessageContext context;
 			std::chrono::system_clock::time_point dispatch_end;
 
 			InternalMessageResult result;
@@ -227,18 +670,87 @@ namespace lsp_boot
 			auto metrics() const -> MessageMetrics
 			{
 				return {
-					.identifier = identifier,
-					.response = std::chrono::duration_cast< std::chrono::microseconds >(dispatch_end - received),
-					.dispatch = std::chrono::duration_cast< std::chrono::microseconds >(dispatch_end - dispatch_start),
+					.identifier = context.identifier,
+					.response = std::chrono::duration_cast< std::chrono::microseconds >(dispatch_end - context.received),
+					.dispatch = std::chrono::duration_cast< std::chrono::microseconds >(dispatch_end - context.dispatch_start),
+					.response_cache = result.response_cache,
 				};
 			}
 		};
 
-		auto dispatch_request(std::string_view method, lsp::RawMessage&& msg) -> InternalMessageResult;
-		auto dispatch_notification(std::string_view method, lsp::RawMessage&& msg) -> InternalMessageResult;
-		auto dispatch_message(ReceivedMessage&& msg) -> DispatchResult;
+		// A request that has been dispatched and not yet completed.
+		struct ActiveRequest
+		{
+			boost::json::value id;
+			CancellationSource cancellation;
+			RequestProgress progress;
+			// Set under active_requests_mtx once the handler has returned a deferred result.
+			std::shared_ptr< DeferredRequestResult::State > deferred = nullptr;
+		};
+
+		// Full and delta semantic tokens requests, whose results are cached to allow subsequent delta requests to be answered with edits.
+		struct SemanticTokensRequest
+		{
+			std::string document;
+			std::optional< std::string > previous_result_id;
+		};
+
+		// What's needed to respond to a dispatched request, which may happen on a worker, or on whichever thread completes a deferred result.
+		struct DispatchedRequest
+		{
+			boost::json::value id;
+			std::shared_ptr< ActiveRequest > active;
+			MessageContext context;
+			std::optional< SemanticTokensRequest > tokens_request;
+			std::optional< ResponseCache::Key > cache_key;
+			ResponseCacheOutcome cache_outcome;
+			bool is_initialize;
+			std::chrono::steady_clock::time_point handler_start = {};
+		};
 
-		auto handle_request(lsp::Request request) -> RequestResult
+		auto dispatch_request(std::string_view method, lsp::RawMessage&& msg, MessageContext const& context) -> InternalMessageResult;
+		auto dispatch_notification(std::string_view method, lsp::RawMessage&& msg, MessageContext const& context) -> InternalMessageResult;
+		auto dispatch_response(lsp::RawMessage const& msg) -> void;
+		auto dispatch_message(ReceivedMessage&& msg) -> DispatchResult;
+		// Dispatches the next message of the backlog, if any, following a poll for further input. Returns false if the server has exited.
+		auto dispatch_next() -> bool;
+		// Logs msg in full at trace level, leaving its serialization to the log writer thread.
+		auto log_payload(lsp::RawMessage const& msg) const -> void;
+
+		auto execute_request(std::optional< lsp::Request >&& request, DispatchedRequest& dispatched) -> PendingRequestResult;
+		// Responds once the result is available: immediately, or on completion of a deferred result.
+		auto respond(PendingRequestResult&& result, DispatchedRequest&& dispatched) -> void;
+		auto finish_request(DispatchedRequest&& dispatched, RequestResult&& result, bool deferred) -> void;
+		// Queues the response, its serialization time to be recorded against method_metrics (if non-null).
+		auto complete_request(boost::json::value&& request_id, RequestResult&& result, MethodMetrics* method_metrics) const -> void;
+		auto apply_negotiated_capabilities(RequestResult& initialize_result) -> void;
+
+		static auto make_semantic_tokens_request(std::string_view method, lsp::RawMessage const& msg) -> std::optional< SemanticTokensRequest >;
+		auto process_semantic_tokens_result(std::optional< SemanticTokensRequest > const& request, ActiveRequest const& active, RequestResult& result) -> void;
+
+		// Input is moved from the queue into the backlog ahead of dispatch, so that cancellations can be applied to requests that are still queued.
+		auto enqueue_input(ReceivedMessage&& msg) -> void;
+		// Folds a didChange into an earlier one for the same document still in the backlog, if ordering allows.
+		auto coalesce_document_change(ReceivedMessage& msg) -> bool;
+		auto poll_input() -> void;
+		// Waits for the document's outstanding requests (all requests, if none is given) to complete, meanwhile polling for input.
+		auto wait_for_requests(std::optional< std::string_view > document) -> void;
+		// Index within the backlog of the message to dispatch next (see ServerOptions::prioritize_input).
+		auto next_backlog_index() -> std::size_t;
+		// Also determines which kinds of requests have their responses cached.
+		auto init_request_schedules() -> void;
+		auto request_schedule(std::string_view method) const -> RequestSchedule;
+		// Key under which the response to the request is cached, if it's cacheable.
+		auto response_cache_key(std::string_view method, lsp::RawMessage const& msg) const -> std::optional< ResponseCache::Key >;
+		auto cache_response(std::optional< ResponseCache::Key >&& key, ActiveRequest const& active, RequestResult const& result) -> void;
+		auto process_cancellation(lsp::RawMessage const& msg) -> void;
+		auto take_queued_cancellation(boost::json::value const& request_id) -> bool;
+
+		auto register_request(boost::json::value const& request_id, RequestProgress&& progress) -> std::shared_ptr< ActiveRequest >;
+		// Also ends the request's progress streams, ahead of its response.
+		auto unregister_request(std::shared_ptr< ActiveRequest > const& active) -> void;
+
+		auto handle_request(lsp::Request request) -> PendingRequestResult
 		{
 			return impl.handle_request(std::move(request));
 		}
@@ -249,17 +761,56 @@ namespace lsp_boot
 		}
 
 		auto postprocess_message(DispatchResult const&) const -> void;
+		auto dump_metrics_if_due() -> void;
 
 	private:
 		auto send_notification_impl(lsp::RawMessage&&) const -> void override;
-		auto log_impl(LogOutputCallbackView) const -> void override;
+		auto publish_diagnostics_impl(std::string_view uri, std::optional< std::int64_t > version, std::vector< lsp::Diagnostic >&& diagnostics) const -> void override;
+		auto log_impl(LogRecord& record) const -> void override;
+		auto cancellation_token_impl() const -> CancellationToken override;
+		auto partial_results_impl() const -> PartialResultStream override;
+		auto work_done_progress_impl() const -> WorkDoneProgress override;
+		auto submit_background_impl(BackgroundTask&& task, BackgroundTaskOptions const& options) const -> void override;
+		auto start_background_job_impl(std::string_view title, BackgroundTaskOptions&& options) const -> BackgroundJob override;
+		auto document_impl(std::string_view uri) const -> std::optional< DocumentSnapshot > override;
+		auto json_storage_impl() const -> boost::json::storage_ptr override;
 
 	private:
 		PendingInputQueue& in_queue;
 		OutputQueue& out_queue;
+		// Outlives the implementation and executor, which may log on destruction.
+		std::unique_ptr< AsyncLogWriter > log_writer;
 		ServerImplementation impl;
-		LoggingSink logger;
 		MetricsSink metrics;
+		ServerOptions options;
 		std::atomic< bool > shutdown;
+		DocumentStore documents;
+		SemanticTokensCache semantic_tokens;
+		MetricsRegistry registry;
+		mutable DiagnosticsPublisher diagnostics{ out_queue, options.diagnostics };
+		// Destroyed ahead of the diagnostics publisher and the implementation, which tasks may use.
+		mutable BackgroundScheduler background{ options.background_workers, out_queue, [this](std::string_view const message) {
+			log(LogLevel::error, LogCategory::server, "{}", message);
+			} };
+		std::chrono::steady_clock::time_point last_metrics_dump = std::chrono::steady_clock::now();
+
+		std::thread::id dispatch_thread;
+		// Referenced weakly by the polls of cancellation tokens (see register_request), which may outlive the server.
+		std::shared_ptr< Server* const > self = std::make_shared< Server* const >(this);
+		std::deque< ReceivedMessage > backlog;
+		// Indexed as lsp::Request.
+		std::array< RequestSchedule, std::variant_size_v< lsp::Request > > request_schedules;
+		std::array< bool, std::variant_size_v< lsp::Request > > cached_requests = {};
+		std::optional< ResponseCache > response_cache;
+		// Documents of the messages passed over while choosing the next to dispatch, and whether any of those was a notification.
+		std::vector< std::pair< std::string_view, bool > > passed_documents;
+		std::vector< boost::json::value > cancelled_queued_requests;
+
+		std::vector< std::shared_ptr< ActiveRequest > > active_requests;
+		std::mutex active_requests_mtx;
+		static thread_local ActiveRequest const* current_request;
+
+		// Declared last so that outstanding requests complete before anything they may use is destroyed.
+		std::unique_ptr< RequestExecutor > executor;
 	};
 }
@@ -0,0 +1,485 @@
+
+module;
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <errno.h>
+#endif
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <span>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include <format>
+#include <mutex>
+#include <atomic>
+#endif
+
+module lsp_boot.socket_host;
+
+import lsp_boot.utility;
+
+using namespace std::string_view_literals;
+
+#if defined(__linux__)
+namespace lsp_boot
+{
+	namespace
+	{
+		constexpr auto listener_key = std::numeric_limits< std::uint64_t >::max();
+		constexpr auto wake_key = listener_key - 1;
+
+		auto add_to_epoll(int const epoll_fd, int const fd, std::uint64_t const key) -> bool
+		{
+			auto event = ::epoll_event{};
+			event.events = EPOLLIN;
+			event.data.u64 = key;
+			return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+		}
+
+		// Gathered write as done by FdConnection, but with MSG_NOSIGNAL, so that a client disconnecting doesn't raise SIGPIPE.
+		auto send_segments(int const fd, std::span< std::string_view const > const segments) -> bool
+		{
+			constexpr std::size_t max_iovecs = 64;
+
+			for (std::size_t first = 0; first < segments.size(); )
+			{
+				::iovec iovecs[max_iovecs];
+				auto const count = std::min(max_iovecs, segments.size() - first);
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					iovecs[i] = ::iovec{ const_cast< char* >(segments[first + i].data()), segments[first + i].size() };
+				}
+				first += count;
+
+				auto remaining = std::span(iovecs, count);
+				while (!remaining.empty())
+				{
+					auto message = ::msghdr{};
+					message.msg_iov = remaining.data();
+					message.msg_iovlen = remaining.size();
+					auto written = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+					if (written < 0)
+					{
+						if (errno == EINTR)
+						{
+							continue;
+						}
+						return false;
+					}
+
+					while (!remaining.empty() && std::size_t(written) >= remaining.front().iov_len)
+					{
+						written -= remaining.front().iov_len;
+						remaining = remaining.subspan(1);
+					}
+					if (written > 0)
+					{
+						remaining.front().iov_base = static_cast< char* >(remaining.front().iov_base) + written;
+						remaining.front().iov_len -= std::size_t(written);
+					}
+				}
+			}
+			return true;
+		}
+	}
+
+	struct SocketHost::Session
+	{
+		Session(std::uint64_t const session_id, int const socket_fd, std::size_t const read_buffer_size, MessageArenaPool* const arena_pool)
+			: id{ session_id }, fd{ socket_fd }, reader{ read_buffer_size, arena_pool }
+		{
+		}
+
+		std::uint64_t id;
+		int fd;
+		PendingInputQueue input_queue;
+		OutputQueue output_queue;
+		MessageReader reader;
+		std::unique_ptr< Server > server;
+		std::optional< BatchedOutputWriter > writer;
+		// Dispatch runs are requested by the event loop, and served by a single task at a time.
+		std::atomic< std::size_t > dispatch_requests = 0;
+		// Set by the dispatch task once the server has exited.
+		std::atomic< bool > finished = false;
+		// Set by the event loop, which no longer touches the server once set. The dispatch task then ends the session.
+		std::atomic< bool > closing = false;
+		// Set once the server's requests have completed, for the output task to write out the last of their responses.
+		std::atomic< bool > output_closing = false;
+		// The dispatch and output tasks each let go of a closing session; whichever does so last finishes it.
+		std::atomic< int > tasks_done = 0;
+		// Set as the last touch of the session, after which the event loop may destroy it.
+		std::atomic< bool > ended = false;
+		// Event loop only.
+		bool reading = true;
+	};
+
+	SocketHost::SocketHost(std::string socket_path, SessionFactory session_factory, std::ostream& error, SocketHostOptions host_options)
+		: path{ std::move(socket_path) }, factory{ std::move(session_factory) }, err{ error }, options{ host_options }
+		, wake_fd{ ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK) }
+	{
+		if (options.request_workers > 0)
+		{
+			worker_pool = std::make_unique< ThreadPool >(options.request_workers);
+		}
+		session_pool = std::make_unique< ThreadPool >(std::max< std::size_t >(options.session_workers, 1));
+	}
+
+	SocketHost::~SocketHost()
+	{
+		reap_sessions(true);
+		// Lets sessions' final tasks, which may still signal the event loop, return.
+		session_pool.reset();
+		if (wake_fd >= 0)
+		{
+			::close(wake_fd);
+		}
+	}
+
+	auto SocketHost::run() -> int
+	{
+		auto address = ::sockaddr_un{};
+		address.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof(address.sun_path))
+		{
+			report(std::format("SocketHost: invalid socket path '{}'", path));
+			return -1;
+		}
+		std::memcpy(address.sun_path, path.data(), path.size());
+
+		listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+		::unlink(path.c_str());
+		if (listen_fd < 0 || epoll_fd < 0 || wake_fd < 0
+			|| ::bind(listen_fd, reinterpret_cast< ::sockaddr const* >(&address), sizeof(address)) != 0
+			|| ::listen(listen_fd, options.listen_backlog) != 0
+			|| !add_to_epoll(epoll_fd, listen_fd, listener_key)
+			|| !add_to_epoll(epoll_fd, wake_fd, wake_key))
+		{
+			report(std::format("SocketHost: failed to listen on '{}' ({})", path, std::strerror(errno)));
+			stopping = true;
+		}
+		else
+		{
+			report(std::format("SocketHost listening on '{}'", path));
+		}
+
+		auto result = stopping ? -1 : 0;
+		constexpr int max_events = 64;
+		::epoll_event events[max_events];
+		while (!stopping)
+		{
+			auto const count = ::epoll_wait(epoll_fd, events, max_events, -1);
+			if (count < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				report(std::format("SocketHost: event loop failure ({})", std::strerror(errno)));
+				result = -1;
+				break;
+			}
+
+			for (auto const& event : std::span(events, std::size_t(count)))
+			{
+				if (event.data.u64 == listener_key)
+				{
+					accept_session();
+				}
+				else if (event.data.u64 == wake_key)
+				{
+					std::uint64_t signalled;
+					[[maybe_unused]] auto const _ = ::read(wake_fd, &signalled, sizeof(signalled));
+					reap_sessions(false);
+				}
+				else if (auto const it = sessions.find(event.data.u64); it != sessions.end() && it->second->reading)
+				{
+					if (!read_session(*it->second))
+					{
+						end_input(*it->second);
+					}
+				}
+			}
+		}
+
+		report("SocketHost shutting down...");
+		reap_sessions(true);
+		for (auto const fd : { listen_fd, epoll_fd })
+		{
+			if (fd >= 0)
+			{
+				::close(fd);
+			}
+		}
+		listen_fd = epoll_fd = -1;
+		::unlink(path.c_str());
+		return result;
+	}
+
+	auto SocketHost::stop() -> void
+	{
+		stopping = true;
+		wake();
+	}
+
+	auto SocketHost::accept_session() -> void
+	{
+		auto const fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0)
+		{
+			if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED)
+			{
+				report(std::format("SocketHost: accept failed ({})", std::strerror(errno)));
+			}
+			return;
+		}
+
+		auto session = std::make_unique< Session >(next_session_id++, fd, options.read_buffer_size, options.arena_pool);
+
+		auto server_options = options.server_options;
+		server_options.worker_pool = worker_pool.get();
+		server_options.arena_pool = options.arena_pool;
+		session->server = factory(SessionInit{
+			.id = session->id,
+			.input_queue = session->input_queue,
+			.output_queue = session->output_queue,
+			.server_options = server_options,
+			});
+		if (!session->server || !add_to_epoll(epoll_fd, fd, session->id))
+		{
+			report(std::format("SocketHost: session {} rejected", session->id));
+			::close(fd);
+			return;
+		}
+
+		auto output_options = options.output_options;
+		output_options.metrics = &session->server->metrics_registry().output();
+		session->writer.emplace(output_options, [this](std::string_view const message) {
+			report(message);
+			});
+
+		auto& ref = *session;
+		ref.output_queue.set_waker([this, &ref] {
+			session_pool->submit([this, &ref] { write_output(ref); });
+			});
+
+		sessions.emplace(ref.id, std::move(session));
+		active_sessions.fetch_add(1, std::memory_order_relaxed);
+		report(std::format("SocketHost: session {} started", ref.id));
+	}
+
+	auto SocketHost::read_session(Session& session) -> bool
+	{
+		auto const buffer = session.reader.prepare();
+		auto count = ::read(session.fd, buffer.data(), buffer.size());
+		while (count < 0 && errno == EINTR)
+		{
+			count = ::read(session.fd, buffer.data(), buffer.size());
+		}
+		if (count <= 0)
+		{
+			report(std::format("SocketHost: session {} {}", session.id, count == 0 ? "disconnected"sv : "input read error"sv));
+			return false;
+		}
+
+		session.reader.commit(std::size_t(count));
+		auto received = false;
+		auto result = true;
+		while (true)
+		{
+			auto msg = session.reader.next_message();
+			if (!msg.has_value())
+			{
+				report(std::format("SocketHost: session {} message read error ({})", session.id,
+					msg.error() == MessageReadError::invalid_json ? "Failure parsing received JSON"sv : "Invalid message header"sv));
+				result = false;
+				break;
+			}
+			if (!msg->has_value())
+			{
+				break;
+			}
+			session.input_queue.push(std::move(**msg));
+			received = true;
+		}
+
+		if (received)
+		{
+			schedule_dispatch(session);
+		}
+		return result;
+	}
+
+	auto SocketHost::end_input(Session& session) -> void
+	{
+		// The server exits without dispatching input still queued, whose responses could no longer be delivered.
+		if (session.reading)
+		{
+			::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, session.fd, nullptr);
+			session.reading = false;
+		}
+		session.server->request_shutdown();
+		session.closing.store(true, std::memory_order_release);
+		schedule_dispatch(session);
+	}
+
+	auto SocketHost::reap_sessions(bool const all) -> void
+	{
+		if (all)
+		{
+			for (auto& [id, session] : sessions)
+			{
+				if (!session->closing.load(std::memory_order_relaxed))
+				{
+					end_input(*session);
+				}
+			}
+			for (auto& [id, session] : sessions)
+			{
+				while (!session->ended.load(std::memory_order_acquire))
+				{
+					auto const epoch = sessions_ended.load(std::memory_order_acquire);
+					if (session->ended.load(std::memory_order_acquire))
+					{
+						break;
+					}
+					sessions_ended.wait(epoch, std::memory_order_acquire);
+				}
+			}
+		}
+
+		for (auto it = sessions.begin(); it != sessions.end(); )
+		{
+			auto& session = *it->second;
+			if (session.ended.load(std::memory_order_acquire))
+			{
+				it = sessions.erase(it);
+				active_sessions.fetch_sub(1, std::memory_order_relaxed);
+				continue;
+			}
+			if (session.finished.load(std::memory_order_acquire) && !session.closing.load(std::memory_order_relaxed))
+			{
+				end_input(session);
+			}
+			++it;
+		}
+	}
+
+	auto SocketHost::schedule_dispatch(Session& session) -> void
+	{
+		if (session.dispatch_requests.fetch_add(1, std::memory_order_acq_rel) == 0)
+		{
+			session_pool->submit([this, &session] { dispatch_session(session); });
+		}
+	}
+
+	auto SocketHost::dispatch_session(Session& session) -> void
+	{
+		auto requests = session.dispatch_requests.load(std::memory_order_acquire);
+		while (true)
+		{
+			if (session.closing.load(std::memory_order_acquire))
+			{
+				// Further requests are left outstanding, so no more tasks are submitted.
+				end_session(session);
+				return;
+			}
+			if (!session.finished.load(std::memory_order_relaxed) && !session.server->run_available())
+			{
+				session.finished.store(true, std::memory_order_release);
+				wake();
+			}
+
+			if (session.dispatch_requests.fetch_sub(requests, std::memory_order_acq_rel) == requests)
+			{
+				return;
+			}
+			requests = session.dispatch_requests.load(std::memory_order_acquire);
+		}
+	}
+
+	auto SocketHost::end_session(Session& session) -> void
+	{
+		// Blocks only this session's dispatch, leaving the event loop and other sessions unaffected.
+		session.server->drain_requests();
+
+		// Runs the output task again, if idle, to see the flag.
+		session.output_closing.store(true, std::memory_order_release);
+		session.output_queue.notify();
+		if (session.tasks_done.fetch_add(1, std::memory_order_acq_rel) == 1)
+		{
+			finish_session(session);
+		}
+	}
+
+	auto SocketHost::write_output(Session& session) -> void
+	{
+		auto const send = [&](std::span< std::string_view const > const batch) {
+			if (!send_segments(session.fd, batch))
+			{
+				report(std::format("SocketHost: session {} output write error", session.id));
+			}
+			};
+
+		auto wakeups = session.output_queue.wakeups();
+		do
+		{
+			session.writer->write_available(session.output_queue, send);
+			if (session.output_closing.load(std::memory_order_acquire))
+			{
+				// Not released, so the queue doesn't run us again.
+				if (session.tasks_done.fetch_add(1, std::memory_order_acq_rel) == 1)
+				{
+					finish_session(session);
+				}
+				return;
+			}
+		} while (!session.output_queue.release(wakeups));
+	}
+
+	auto SocketHost::finish_session(Session& session) -> void
+	{
+		// Responses queued ahead of output_closing being set, but after the last write.
+		session.writer->write_available(session.output_queue, [&](std::span< std::string_view const > const batch) {
+			send_segments(session.fd, batch);
+			});
+		// Anything output by the server's destruction is dropped, along with the queue.
+		session.server.reset();
+		::close(session.fd);
+		report(std::format("SocketHost: session {} ended", session.id));
+
+		session.ended.store(true, std::memory_order_release);
+		sessions_ended.fetch_add(1, std::memory_order_release);
+		sessions_ended.notify_all();
+		wake();
+	}
+
+	auto SocketHost::wake() const -> void
+	{
+		std::uint64_t const signal = 1;
+		[[maybe_unused]] auto const _ = ::write(wake_fd, &signal, sizeof(signal));
+	}
+
+	auto SocketHost::report(std::string_view const message) const -> void
+	{
+		auto lock = std::scoped_lock{ report_mtx };
+		err << message << std::endl;
+	}
+}
+#endif
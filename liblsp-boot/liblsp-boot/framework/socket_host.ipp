@@ -0,0 +1,158 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <map>
+#include <ostream>
+#include <mutex>
+#include <atomic>
+#endif
+
+export module lsp_boot.socket_host;
+
+import lsp_boot.server;
+import lsp_boot.transport;
+import lsp_boot.work_queue;
+import lsp_boot.message_arena;
+import lsp_boot.thread_pool;
+
+#if defined(__linux__)
+namespace lsp_boot
+{
+	export struct SocketHostOptions
+	{
+		/**
+		 * Worker threads shared by all sessions for executing requests (see ServerOptions::worker_pool).
+		 * With 0, sessions handle their requests as they dispatch them, on the session workers.
+		 */
+		std::size_t request_workers = 4;
+
+		/**
+		 * Threads shared by all sessions for dispatching their input (see Server::run_available) and writing their output. A session occupies
+		 * one only while it has input to dispatch or output to write, though dispatch may block, on synchronous handlers or outstanding requests.
+		 * At least one is used.
+		 */
+		std::size_t session_workers = 4;
+
+		/**
+		 * Options for each session's server. The worker pool and arena pool are filled in by the host.
+		 */
+		ServerOptions server_options = {};
+
+		/**
+		 * If set, shared by all sessions, both for parsing input and for building results. Must outlive the host.
+		 */
+		MessageArenaPool* arena_pool = nullptr;
+
+		std::size_t read_buffer_size = MessageReader::default_buffer_size;
+
+		/**
+		 * Output batching for each session. The metrics member is ignored, each session recording to its own server's registry.
+		 */
+		OutputBatchOptions output_options = {};
+
+		int listen_backlog = 64;
+	};
+
+	export struct SessionInit
+	{
+		/**
+		 * Identifies the session for the lifetime of the host.
+		 */
+		std::uint64_t id;
+		PendingInputQueue& input_queue;
+		OutputQueue& output_queue;
+		ServerOptions server_options;
+	};
+
+	/**
+	 * Creates the server for a newly accepted connection, constructed over the given queues and with the given options. Returning null rejects
+	 * the connection. This is the hook for state shared between sessions (caches, indexes): it's owned by the caller and passed on by the factory
+	 * to each implementation, and must be safe for concurrent use, as sessions dispatch concurrently.
+	 * Invoked on the host's event loop thread.
+	 */
+	export using SessionFactory = std::function< std::unique_ptr< Server >(SessionInit const&) >;
+
+	/**
+	 * Accepts any number of connections on a Unix domain socket, serving each with its own Server session, so that a single long lived process
+	 * can serve every editor on a machine.
+	 * Input for all sessions is read and decoded on one epoll driven event loop, and requests are executed on a worker pool common to all sessions.
+	 * Sessions' input is dispatched, and their responses written in batches, by a second pool of session workers, so that threads don't scale
+	 * with the number of sessions.
+	 * A session ends when its server exits (following an exit notification), or when its client disconnects. It's then torn down on the session
+	 * workers, which wait for its outstanding requests, leaving the event loop free to serve other sessions.
+	 */
+	export class SocketHost
+	{
+	public:
+		SocketHost(std::string socket_path, SessionFactory session_factory, std::ostream& error, SocketHostOptions host_options = {});
+		~SocketHost();
+
+		SocketHost(SocketHost const&) = delete;
+		auto operator= (SocketHost const&) -> SocketHost& = delete;
+
+		/**
+		 * Listens on the socket, replacing any stale socket file at the path, and runs the event loop until stop() is called.
+		 * Sessions still open at that point are shut down. The socket file is removed on return.
+		 * @return 0 on stopping, or -1 if the socket could not be set up or the event loop failed.
+		 */
+		auto run() -> int;
+
+		/**
+		 * May be called from any thread, including before run().
+		 */
+		auto stop() -> void;
+
+		auto session_count() const -> std::size_t
+		{
+			return active_sessions.load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct Session;
+
+		auto accept_session() -> void;
+		auto read_session(Session& session) -> bool;
+		auto end_input(Session& session) -> void;
+		auto reap_sessions(bool all) -> void;
+
+		// Run on the session workers, one at a time for a given session.
+		auto schedule_dispatch(Session& session) -> void;
+		auto dispatch_session(Session& session) -> void;
+		auto end_session(Session& session) -> void;
+		// Run on the session workers, one at a time for a given session, and concurrently with its dispatch.
+		auto write_output(Session& session) -> void;
+		auto finish_session(Session& session) -> void;
+
+		auto wake() const -> void;
+		auto report(std::string_view message) const -> void;
+
+	private:
+		std::string path;
+		SessionFactory factory;
+		std::ostream& err;
+		SocketHostOptions options;
+		int listen_fd = -1;
+		int epoll_fd = -1;
+		int wake_fd = -1;
+		std::atomic< bool > stopping = false;
+		std::atomic< std::size_t > active_sessions = 0;
+		// Raised as each session finishes tearing down.
+		std::atomic< std::uint32_t > sessions_ended = 0;
+		std::uint64_t next_session_id = 0;
+		mutable std::mutex report_mtx;
+		std::unique_ptr< ThreadPool > worker_pool;
+		std::unique_ptr< ThreadPool > session_pool;
+		// Declared after the pools, to which sessions submit tasks until torn down.
+		std::map< std::uint64_t, std::unique_ptr< Session > > sessions;
+	};
+}
+#endif
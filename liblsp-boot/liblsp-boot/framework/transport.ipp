@@ -3,3 +3,7 @@ export module lsp_boot.transport;
 
 export import :core;
 export import :iostream;
+export import :reader;
+export import :writer;
+export import :fd;
+export import :trace;
@@ -0,0 +1,188 @@
+
+module;
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+#include <errno.h>
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <utility>
+#include <string_view>
+#include <string>
+#include <span>
+#include <algorithm>
+#include <ostream>
+#include <format>
+#include <thread>
+#endif
+
+module lsp_boot.transport;
+
+import lsp_boot.work_queue;
+import lsp_boot.ext_mod_wrap.boost.json;
+import lsp_boot.utility;
+
+using namespace std::string_view_literals;
+
+namespace lsp_boot
+{
+	namespace
+	{
+		auto native_read(FileDescriptor const fd, char* const buffer, std::size_t const count) -> std::ptrdiff_t
+		{
+#if defined(_WIN32)
+			return ::_read(fd, buffer, static_cast< unsigned int >(std::min< std::size_t >(count, 0x7fffffff)));
+#else
+			return ::read(fd, buffer, count);
+#endif
+		}
+
+#if defined(_WIN32)
+		auto native_write(FileDescriptor const fd, char const* const buffer, std::size_t const count) -> std::ptrdiff_t
+		{
+			return ::_write(fd, buffer, static_cast< unsigned int >(std::min< std::size_t >(count, 0x7fffffff)));
+		}
+#endif
+	}
+
+	auto FdConnection::read_input(std::span< char > const buffer) -> std::ptrdiff_t
+	{
+		while (true)
+		{
+			auto const result = native_read(in_fd, buffer.data(), buffer.size());
+			if (result >= 0 || errno != EINTR)
+			{
+				return result;
+			}
+		}
+	}
+
+	auto FdConnection::write_output(std::span< std::string_view const > const segments) -> bool
+	{
+#if defined(_WIN32)
+		for (auto segment : segments)
+		{
+			while (!segment.empty())
+			{
+				auto const result = native_write(out_fd, segment.data(), segment.size());
+				if (result < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					return false;
+				}
+				segment.remove_prefix(std::size_t(result));
+			}
+		}
+#else
+		constexpr std::size_t max_iovecs = 64;
+
+		for (std::size_t first = 0; first < segments.size(); )
+		{
+			::iovec iovecs[max_iovecs];
+			auto const count = std::min(max_iovecs, segments.size() - first);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				iovecs[i] = ::iovec{ const_cast< char* >(segments[first + i].data()), segments[first + i].size() };
+			}
+			first += count;
+
+			auto remaining = std::span(iovecs, count);
+			while (!remaining.empty())
+			{
+				auto written = ::writev(out_fd, remaining.data(), int(remaining.size()));
+				if (written < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					return false;
+				}
+
+				// Advance past whatever was written, which may end partway through a segment.
+				while (!remaining.empty() && std::size_t(written) >= remaining.front().iov_len)
+				{
+					written -= remaining.front().iov_len;
+					remaining = remaining.subspan(1);
+				}
+				if (written > 0)
+				{
+					remaining.front().iov_base = static_cast< char* >(remaining.front().iov_base) + written;
+					remaining.front().iov_len -= std::size_t(written);
+				}
+			}
+		}
+#endif
+		return true;
+	}
+
+	auto FdConnection::process_output() -> void
+	{
+		writer.run(out_queue, shutdown, [this](std::span< std::string_view const > const batch) {
+			if (!write_output(batch))
+			{
+				err << "FdConnection output write error" << std::endl;
+			}
+			});
+	}
+
+	auto FdConnection::listen() -> int
+	{
+		Thread out_thread([this] {
+			process_output();
+
+			err << "FdConnection output processor shutting down..." << std::endl;
+			});
+
+		auto const result = [&] {
+			while (true)
+			{
+				auto const count = read_input(reader.prepare());
+				if (count < 0)
+				{
+					err << "FdConnection input read error. Exiting..." << std::endl;
+					return -1;
+				}
+				if (count == 0)
+				{
+					err << std::format("FdConnection reached end of input{}. Exiting...",
+						reader.has_partial_message() ? " (discarding incomplete message)"sv : ""sv) << std::endl;
+					return 0;
+				}
+
+				reader.commit(std::size_t(count));
+
+				while (true)
+				{
+					auto msg = reader.next_message();
+					if (!msg.has_value())
+					{
+						err << std::format("FdConnection message read error ({}). Exiting...",
+							msg.error() == MessageReadError::invalid_json ? "Failure parsing received JSON"sv : "Invalid message header"sv) << std::endl;
+						return -1;
+					}
+					if (!msg->has_value())
+					{
+						break;
+					}
+					in_queue.push(std::move(**msg));
+				}
+			}
+			}();
+
+		err << "FdConnection shutting down..." << std::endl;
+		shutdown = true;
+		out_queue.notify();
+		return result;
+	}
+}
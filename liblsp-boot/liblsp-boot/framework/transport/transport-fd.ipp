@@ -0,0 +1,67 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <ostream>
+#include <atomic>
+#endif
+
+export module lsp_boot.transport:fd;
+
+import :core;
+import :reader;
+import :writer;
+
+import lsp_boot.work_queue;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	export using FileDescriptor = int;
+
+	/**
+	 * Connection over raw file descriptors (eg. 0 and 1 for stdin/stdout), bypassing iostreams.
+	 * Input is read in large chunks and decoded incrementally by a MessageReader.
+	 */
+	export class FdConnection
+	{
+	public:
+		FdConnection(
+			PendingInputQueue& pending_input_queue,
+			OutputQueue& output_queue,
+			FileDescriptor input,
+			FileDescriptor output,
+			std::ostream& error,
+			std::size_t read_buffer_size = MessageReader::default_buffer_size,
+			OutputBatchOptions output_options = {},
+			InputOptions input_options = {})
+			: in_queue{ pending_input_queue }, out_queue{ output_queue }, in_fd{ input }, out_fd{ output }, err{ error }
+			, reader{ read_buffer_size, input_options.arena_pool }
+			, writer{ output_options, [this](std::string_view const message) { err << message << std::endl; } }
+		{
+		}
+
+		auto listen() -> int;
+
+	private:
+		auto read_input(std::span< char > buffer) -> std::ptrdiff_t;
+		auto write_output(std::span< std::string_view const > segments) -> bool;
+
+		auto process_output() -> void;
+
+	private:
+		PendingInputQueue& in_queue;
+		OutputQueue& out_queue;
+		FileDescriptor in_fd;
+		FileDescriptor out_fd;
+		std::ostream& err;
+		MessageReader reader;
+		BatchedOutputWriter writer;
+		std::atomic< bool > shutdown = false;
+	};
+}
@@ -7,6 +7,7 @@ import std;
 #include <utility>
 #include <optional>
 #include <string_view>
+#include <span>
 #include <ostream>
 #include <istream>
 #include <memory>
@@ -19,6 +20,7 @@ import std;
 module lsp_boot.transport;
 
 import lsp_boot.work_queue; // really clang?
+import lsp_boot.message_arena;
 import lsp_boot.ext_mod_wrap.boost.json;
 import lsp_boot.utility;
 
@@ -26,17 +28,6 @@ using namespace std::string_view_literals;
 
 namespace lsp_boot
 {
-	auto StreamConnection::send_message(MessageContent&& message) -> void
-	{
-		auto content = boost::json::serialize(message);
-		out
-			<< "Content-Length: "
-			<< content.length()
-			<< "\r\n\r\n"
-			<< content
-			<< std::flush;
-	}
-
 	auto StreamConnection::read_message_header() -> std::optional< MessageHeader >
 	{
 		auto const compare = [](char const* const buffer, std::string_view const sv) {
@@ -127,12 +118,23 @@ namespace lsp_boot
 			auto content = std::make_unique< char[] >(hdr.content_length);
 			in.read(content.get(), hdr.content_length);
 			auto timestamp = std::chrono::system_clock::now();
+			if (recorder != nullptr)
+			{
+				recorder->record(TraceDirection::input,
+					std::format("Content-Length: {}\r\n\r\n{}", hdr.content_length, std::string_view{ content.get(), hdr.content_length }));
+			}
 			try
 			{
-				auto value = boost::json::parse(std::string_view{ content.get(), hdr.content_length });
+				auto const parse_start = std::chrono::steady_clock::now();
+				auto value = boost::json::parse(
+					std::string_view{ content.get(), hdr.content_length },
+					arena_pool != nullptr ? arena_pool->make_storage() : boost::json::storage_ptr{});
+				auto const parse_time = std::chrono::steady_clock::now() - parse_start;
 				return ReceivedMessage{
-					.msg{ value.as_object() },
+					.msg{ std::move(value.as_object()) },
 					.received_time = timestamp,
+					.parse_time = std::chrono::duration_cast< std::chrono::nanoseconds >(parse_time),
+					.size = hdr.content_length,
 				};
 			}
 			catch (...)
@@ -145,13 +147,17 @@ namespace lsp_boot
 
 	auto StreamConnection::process_output() -> void
 	{
-		while (!shutdown)
-		{
-			if (auto msg = out_queue.pop_with_abort([this] { return shutdown.load(); }); msg.has_value())
+		writer.run(out_queue, shutdown, [this](std::span< std::string_view const > const batch) {
+			for (auto const segment : batch)
 			{
-				send_message(std::move(*msg));
+				out.write(segment.data(), segment.size());
+				if (recorder != nullptr)
+				{
+					recorder->record(TraceDirection::output, segment);
+				}
 			}
-		}
+			out.flush();
+			});
 	}
 
 	auto StreamConnection::listen() -> int
@@ -5,6 +5,7 @@ module;
 import std;
 #else
 #include <optional>
+#include <string_view>
 #include <ostream>
 #include <istream>
 #include <atomic>
@@ -13,8 +14,12 @@ import std;
 export module lsp_boot.transport:iostream;
 
 import :core;
+import :reader;
+import :writer;
+import :trace;
 
 import lsp_boot.work_queue;
+import lsp_boot.message_arena;
 import lsp_boot.ext_mod_wrap.boost.json;
 
 namespace lsp_boot
@@ -27,17 +32,29 @@ namespace lsp_boot
 			OutputQueue& output_queue,
 			std::istream& input,
 			std::ostream& output,
-			std::ostream& error)
+			std::ostream& error,
+			OutputBatchOptions output_options = {},
+			InputOptions input_options = {})
 			: in_queue{ pending_input_queue }, out_queue{ output_queue }, in{ input }, out{ output }, err{ error }
+			, writer{ output_options, [this](std::string_view const message) { err << message << std::endl; } }
+			, arena_pool{ input_options.arena_pool }
 		{
 		}
 
+		/**
+		 * Enables recording of the raw traffic in both directions to trace, which must outlive the connection. Call before listen().
+		 * Input is recorded at the time of receipt, with its header normalized to just the Content-Length field.
+		 */
+		auto record_to(SessionTraceWriter& trace) -> void
+		{
+			recorder = &trace;
+		}
+
 		auto listen() -> int;
 
 	private:
 		auto read_message_header() -> std::optional< MessageHeader >;
 		auto read_message() -> std::optional< ReceivedMessage >;
-		auto send_message(MessageContent&& message) -> void;
 
 		auto process_output() -> void;
 
@@ -47,6 +64,9 @@ namespace lsp_boot
 		std::istream& in;
 		std::ostream& out;
 		std::ostream& err;
+		BatchedOutputWriter writer;
+		MessageArenaPool* arena_pool;
+		SessionTraceWriter* recorder = nullptr;
 		std::atomic< bool > shutdown = false;
 	};
 }
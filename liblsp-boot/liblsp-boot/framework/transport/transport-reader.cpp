@@ -0,0 +1,200 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <optional>
+#include <expected>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <chrono>
+#endif
+
+module lsp_boot.transport;
+
+import lsp_boot.work_queue;
+import lsp_boot.message_arena;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+using namespace std::string_view_literals;
+
+namespace lsp_boot
+{
+	MessageReader::MessageReader(std::size_t const buffer_size, MessageArenaPool* const arena_pool)
+		: buffer{ std::make_unique< char[] >(buffer_size) }, capacity{ buffer_size }, pool{ arena_pool }
+	{
+	}
+
+	auto MessageReader::prepare() -> std::span< char >
+	{
+		if (read_pos == write_pos)
+		{
+			read_pos = write_pos = 0;
+		}
+		else if (read_pos > 0 && capacity - write_pos < capacity / 4)
+		{
+			// Content is consumed as it arrives, so what remains here is in practice just the start of a header block.
+			std::memmove(buffer.get(), buffer.get() + read_pos, write_pos - read_pos);
+			write_pos -= read_pos;
+			read_pos = 0;
+		}
+		return { buffer.get() + write_pos, capacity - write_pos };
+	}
+
+	auto MessageReader::commit(std::size_t const count) -> void
+	{
+		write_pos += count;
+	}
+
+	auto MessageReader::parse_header() -> std::expected< std::optional< MessageHeader >, MessageReadError >
+	{
+		constexpr auto header_terminator = "\r\n\r\n"sv;
+		constexpr auto field_terminator = "\r\n"sv;
+
+		auto const data = buffer.get();
+
+		auto header_end = std::optional< std::size_t >{};
+		for (auto pos = read_pos; pos < write_pos; )
+		{
+			auto const cr = static_cast< char const* >(std::memchr(data + pos, '\r', write_pos - pos));
+			if (cr == nullptr || std::size_t(data + write_pos - cr) < header_terminator.size())
+			{
+				break;
+			}
+			if (std::string_view(cr, header_terminator.size()) == header_terminator)
+			{
+				header_end = std::size_t(cr - data);
+				break;
+			}
+			pos = std::size_t(cr - data) + 1;
+		}
+
+		if (!header_end)
+		{
+			if (read_pos == 0 && write_pos == capacity)
+			{
+				return std::unexpected(MessageReadError::header_too_large);
+			}
+			return std::nullopt;
+		}
+
+		auto fields = std::string_view(data + read_pos, *header_end - read_pos);
+		read_pos = *header_end + header_terminator.size();
+
+		MessageHeader header{};
+		bool has_content_length = false;
+		while (!fields.empty())
+		{
+			auto const eol = std::min(fields.find(field_terminator), fields.size());
+			auto const field = fields.substr(0, eol);
+			fields.remove_prefix(std::min(eol + field_terminator.size(), fields.size()));
+
+			auto const separator = field.find(':');
+			if (separator == std::string_view::npos)
+			{
+				return std::unexpected(MessageReadError::malformed_header);
+			}
+			auto const name = field.substr(0, separator);
+			auto value = field.substr(separator + 1);
+			value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+
+			if (name == "Content-Length"sv)
+			{
+				auto const value_end = value.data() + value.size();
+				auto const [ptr, ec] = std::from_chars(value.data(), value_end, header.content_length);
+				if (ec != std::errc{} || ptr != value_end)
+				{
+					return std::unexpected(MessageReadError::malformed_header);
+				}
+				has_content_length = true;
+			}
+			else if (name == "Content-Type"sv)
+			{
+				header.content_type = value;
+			}
+			else
+			{
+				return std::unexpected(MessageReadError::malformed_header);
+			}
+		}
+
+		if (!has_content_length)
+		{
+			return std::unexpected(MessageReadError::malformed_header);
+		}
+		return header;
+	}
+
+	auto MessageReader::next_message() -> std::expected< std::optional< ReceivedMessage >, MessageReadError >
+	{
+		if (!content_remaining)
+		{
+			auto header = parse_header();
+			if (!header.has_value())
+			{
+				return std::unexpected(header.error());
+			}
+			if (!header->has_value())
+			{
+				return std::nullopt;
+			}
+
+			content_remaining = (*header)->content_length;
+			content_length = (*header)->content_length;
+			parse_time = {};
+			parser.reset(pool != nullptr ? pool->make_storage() : boost::json::storage_ptr{});
+		}
+
+		auto const available = std::min(*content_remaining, write_pos - read_pos);
+		if (available > 0)
+		{
+			boost::system::error_code ec;
+			auto const parse_start = std::chrono::steady_clock::now();
+			parser.write(buffer.get() + read_pos, available, ec);
+			parse_time += std::chrono::steady_clock::now() - parse_start;
+			read_pos += available;
+			*content_remaining -= available;
+			if (ec)
+			{
+				return std::unexpected(MessageReadError::invalid_json);
+			}
+		}
+
+		if (*content_remaining > 0)
+		{
+			return std::nullopt;
+		}
+
+		auto const timestamp = std::chrono::system_clock::now();
+		content_remaining.reset();
+
+		boost::system::error_code ec;
+		auto const finish_start = std::chrono::steady_clock::now();
+		parser.finish(ec);
+		if (ec)
+		{
+			return std::unexpected(MessageReadError::invalid_json);
+		}
+
+		auto value = parser.release();
+		parse_time += std::chrono::steady_clock::now() - finish_start;
+		if (!value.is_object())
+		{
+			return std::unexpected(MessageReadError::invalid_json);
+		}
+
+		return ReceivedMessage{
+			.msg{ std::move(value.as_object()) },
+			.received_time = timestamp,
+			.parse_time = std::chrono::duration_cast< std::chrono::nanoseconds >(parse_time),
+			.size = content_length,
+		};
+	}
+}
@@ -0,0 +1,93 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <optional>
+#include <expected>
+#include <memory>
+#include <span>
+#include <chrono>
+#endif
+
+export module lsp_boot.transport:reader;
+
+import :core;
+
+import lsp_boot.work_queue;
+import lsp_boot.message_arena;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	export enum class MessageReadError
+	{
+		malformed_header,
+		header_too_large,
+		invalid_json,
+	};
+
+	export struct InputOptions
+	{
+		/**
+		 * If set, each received message is parsed into an arena from this pool, which must outlive the connection.
+		 * Typically the same pool is given to the server (see ServerOptions::arena_pool), so buffers circulate between the two.
+		 */
+		MessageArenaPool* arena_pool = nullptr;
+	};
+
+	/**
+	 * Incremental decoder for framed LSP messages.
+	 * Raw bytes are read by the caller directly into a single reusable buffer (see prepare/commit). Headers are located with memchr scans
+	 * over the buffered bytes, and message content is fed to a persistent boost::json::stream_parser as it arrives, so content bytes are
+	 * consumed as soon as they are read and the buffer only ever needs to accommodate a single header block.
+	 */
+	export class MessageReader
+	{
+	public:
+		static constexpr std::size_t default_buffer_size = 64 * 1024;
+
+		explicit MessageReader(std::size_t buffer_size = default_buffer_size, MessageArenaPool* arena_pool = nullptr);
+
+		/**
+		 * Returns the writable region of the buffer into which the next read from the underlying source should be made.
+		 */
+		auto prepare() -> std::span< char >;
+
+		/**
+		 * Marks count bytes of the region returned by the preceding call to prepare() as filled.
+		 */
+		auto commit(std::size_t count) -> void;
+
+		/**
+		 * Attempts to decode the next message from the bytes committed so far.
+		 * @return The decoded message, std::nullopt if more input is needed, or an error. After an error the reader is unusable.
+		 */
+		auto next_message() -> std::expected< std::optional< ReceivedMessage >, MessageReadError >;
+
+		/**
+		 * True if there is a partially received message.
+		 */
+		auto has_partial_message() const -> bool
+		{
+			return content_remaining.has_value() || read_pos != write_pos;
+		}
+
+	private:
+		auto parse_header() -> std::expected< std::optional< MessageHeader >, MessageReadError >;
+
+	private:
+		std::unique_ptr< char[] > buffer;
+		std::size_t capacity;
+		MessageArenaPool* pool;
+		std::size_t read_pos = 0;
+		std::size_t write_pos = 0;
+
+		boost::json::stream_parser parser;
+		std::optional< std::size_t > content_remaining;
+		std::size_t content_length = 0;
+		std::chrono::steady_clock::duration parse_time{};
+	};
+}
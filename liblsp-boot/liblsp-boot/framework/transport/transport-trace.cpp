@@ -0,0 +1,84 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <ostream>
+#include <istream>
+#include <mutex>
+#include <chrono>
+#include <format>
+#endif
+
+module lsp_boot.transport;
+
+using namespace std::string_view_literals;
+
+namespace lsp_boot
+{
+	namespace
+	{
+		constexpr auto trace_signature = "lsp-boot-trace 1"sv;
+	}
+
+	SessionTraceWriter::SessionTraceWriter(std::ostream& output) : out{ output }, start{ std::chrono::steady_clock::now() }
+	{
+		out << trace_signature << '\n';
+	}
+
+	auto SessionTraceWriter::record(TraceDirection const direction, std::string_view const framed) -> void
+	{
+		record(direction, std::chrono::duration_cast< std::chrono::microseconds >(std::chrono::steady_clock::now() - start), framed);
+	}
+
+	auto SessionTraceWriter::record(TraceDirection const direction, std::chrono::microseconds const offset, std::string_view const framed) -> void
+	{
+		auto lock = std::lock_guard{ mtx };
+		out << std::format("{} {} {}\n", char(direction), offset.count(), framed.size());
+		out.write(framed.data(), framed.size());
+		out << '\n';
+	}
+
+	auto read_session_trace(std::istream& input) -> std::optional< std::vector< TraceRecord > >
+	{
+		auto line = std::string{};
+		if (!std::getline(input, line) || line != trace_signature)
+		{
+			return std::nullopt;
+		}
+
+		auto records = std::vector< TraceRecord >{};
+		char direction;
+		while (input >> direction)
+		{
+			long long offset_us = 0;
+			std::size_t byte_count = 0;
+			if (!(input >> offset_us >> byte_count)
+				|| (direction != char(TraceDirection::input) && direction != char(TraceDirection::output))
+				|| input.get() != '\n')
+			{
+				return std::nullopt;
+			}
+
+			auto framed = std::string(byte_count, '\0');
+			input.read(framed.data(), byte_count);
+			if (input.fail() || input.get() != '\n')
+			{
+				return std::nullopt;
+			}
+			records.push_back(TraceRecord{
+				.direction = TraceDirection(direction),
+				.offset = std::chrono::microseconds{ offset_us },
+				.framed = std::move(framed),
+				});
+		}
+		return input.eof() ? std::optional{ std::move(records) } : std::nullopt;
+	}
+}
@@ -0,0 +1,72 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <ostream>
+#include <istream>
+#include <mutex>
+#include <chrono>
+#endif
+
+export module lsp_boot.transport:trace;
+
+namespace lsp_boot
+{
+	export enum class TraceDirection : char
+	{
+		input = 'I',
+		output = 'O',
+	};
+
+	export struct TraceRecord
+	{
+		TraceDirection direction;
+		/**
+		 * Time of receipt (or of writing, for output) relative to the start of the session.
+		 */
+		std::chrono::microseconds offset;
+		/**
+		 * The complete framed message, header included.
+		 */
+		std::string framed;
+	};
+
+	/**
+	 * Writes raw framed traffic, with timestamps, to a session trace which can later be replayed (see read_session_trace).
+	 * Records from a connection's input and output threads may be interleaved, so writes are serialized.
+	 *
+	 * The format is a "lsp-boot-trace 1" line, followed by records of the form "<I|O> <offset-us> <byte-count>\n<framed-bytes>\n".
+	 */
+	export class SessionTraceWriter
+	{
+	public:
+		explicit SessionTraceWriter(std::ostream& output);
+
+		/**
+		 * Records a message with the current time.
+		 */
+		auto record(TraceDirection direction, std::string_view framed) -> void;
+
+		/**
+		 * Records a message with an explicit offset, for synthesized traces.
+		 */
+		auto record(TraceDirection direction, std::chrono::microseconds offset, std::string_view framed) -> void;
+
+	private:
+		std::mutex mtx;
+		std::ostream& out;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	/**
+	 * Reads a trace written by SessionTraceWriter.
+	 * @return The records in the order written, or std::nullopt if the trace is malformed.
+	 */
+	export auto read_session_trace(std::istream& input) -> std::optional< std::vector< TraceRecord > >;
+}
@@ -0,0 +1,156 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <string_view>
+#include <span>
+#include <algorithm>
+#include <limits>
+#include <format>
+#include <chrono>
+#endif
+
+module lsp_boot.transport;
+
+import lsp_boot.work_queue;
+import lsp_boot.metrics;
+import lsp_boot.integer_text;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+using namespace std::string_view_literals;
+
+namespace lsp_boot
+{
+	namespace
+	{
+		// Whether integer array fields can be spliced in after serialization, the content then ending with the closing braces
+		// of the result object and of the message itself.
+		auto has_trailing_result(boost::json::object const& content) -> bool
+		{
+			if (content.empty())
+			{
+				return false;
+			}
+			auto const& last = *(content.end() - 1);
+			return last.key() == "result" && last.value().is_object();
+		}
+	}
+
+	auto BatchedOutputWriter::append(OutputMessage const& message) -> void
+	{
+		constexpr auto header_prefix = "Content-Length: "sv;
+		constexpr auto header_suffix = "\r\n\r\n"sv;
+		constexpr auto max_header_size = header_prefix.size() + std::numeric_limits< std::size_t >::digits10 + 1 + header_suffix.size();
+		constexpr std::size_t min_chunk_size = 4096;
+
+		// The content length is not known until serialization completes, so space for the header is reserved up front
+		// and the header then written immediately preceding the content. Any gap left before it is simply skipped by the segment.
+		auto const content_start = used + max_header_size;
+		auto content_end = content_start;
+
+		auto const record_metrics = options.metrics != nullptr || message.serialize_metric != nullptr;
+		auto const serialize_start = record_metrics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+		auto content = &message.content;
+		auto expanded = boost::json::object{};
+		auto splice_fields = !message.result_fields.empty();
+		if (splice_fields && !has_trailing_result(message.content))
+		{
+			splice_fields = false;
+			if (auto const result = message.content.find("result"); result != message.content.end() && result->value().is_object())
+			{
+				// Added to a copy of the result as regular arrays instead, which is slower but produces equivalent output.
+				expanded = message.content;
+				auto& result_object = expanded.at("result").as_object();
+				for (auto const& field : message.result_fields)
+				{
+					result_object[field.key] = boost::json::array(field.values.begin(), field.values.end());
+				}
+				content = &expanded;
+			}
+			else if (report_error)
+			{
+				report_error(std::format("BatchedOutputWriter: integer array fields dropped from a message without a result object ({})",
+					boost::json::serialize(message.content)));
+			}
+		}
+
+		serializer.reset(content);
+		do
+		{
+			if (buffer.size() < content_end + min_chunk_size)
+			{
+				buffer.resize(std::max(buffer.size() * 2, content_end + min_chunk_size));
+			}
+			content_end += serializer.read(buffer.data() + content_end, buffer.size() - content_end).size();
+		} while (!serializer.done());
+
+		if (splice_fields)
+		{
+			content_end = append_result_fields(message.result_fields, content_end);
+		}
+
+		if (record_metrics)
+		{
+			auto const serialize_time = std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now() - serialize_start).count();
+			if (options.metrics)
+			{
+				options.metrics->serialize.record(serialize_time);
+				options.metrics->message_size.record(content_end - content_start);
+			}
+			if (message.serialize_metric != nullptr)
+			{
+				message.serialize_metric->record(serialize_time);
+			}
+		}
+
+		char header[max_header_size];
+		auto const header_size = std::size_t(std::format_to(header, "{}{}{}", header_prefix, content_end - content_start, header_suffix) - header);
+		auto const segment_start = content_start - header_size;
+		std::memcpy(buffer.data() + segment_start, header, header_size);
+
+		segments.emplace_back(segment_start, content_end);
+		used = content_end;
+	}
+
+	auto BatchedOutputWriter::append_result_fields(std::span< IntegerArrayField const > const fields, std::size_t content_end) -> std::size_t
+	{
+		// Serialized content ends with the closing braces of the result object and of the message itself (see has_trailing_result).
+		// These are backed over, the fields appended to the result, and both objects then closed again.
+		content_end -= 2;
+
+		std::size_t max_size = 2;
+		for (auto const& field : fields)
+		{
+			max_size += field.key.size() + 4 + max_integer_array_chars(field.values.size());
+		}
+		if (buffer.size() < content_end + max_size)
+		{
+			buffer.resize(std::max(buffer.size() * 2, content_end + max_size));
+		}
+
+		auto const begin = buffer.data();
+		auto out = begin + content_end;
+		auto is_first = *(out - 1) == '{';
+		for (auto const& field : fields)
+		{
+			if (!std::exchange(is_first, false))
+			{
+				*out++ = ',';
+			}
+			*out++ = '"';
+			out = std::ranges::copy(field.key, out).out;
+			*out++ = '"';
+			*out++ = ':';
+			out = write_integer_array(field.values, out);
+		}
+		*out++ = '}';
+		*out++ = '}';
+		return std::size_t(out - begin);
+	}
+}
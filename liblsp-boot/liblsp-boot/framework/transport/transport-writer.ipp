@@ -0,0 +1,159 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#endif
+
+export module lsp_boot.transport:writer;
+
+import :core;
+
+import lsp_boot.work_queue;
+import lsp_boot.metrics;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	export struct OutputBatchOptions
+	{
+		/**
+		 * Upper bound on how long messages may accumulate in a batch before it is written out, so that small interactive
+		 * responses are not held back behind a large burst of output.
+		 */
+		std::chrono::microseconds max_latency = std::chrono::microseconds{ 500 };
+
+		/**
+		 * A batch is written out once its serialized size reaches this many bytes.
+		 */
+		std::size_t max_bytes = 1024 * 1024;
+
+		/**
+		 * If set, serialization time, message sizes and batch sizes are recorded here (typically Server::metrics_registry().output()).
+		 */
+		OutputMetrics* metrics = nullptr;
+	};
+
+	/**
+	 * Drains the output queue in batches, serializing framed messages into a single reused buffer.
+	 * Integer array fields held outside of the JSON DOM are formatted straight into the same buffer.
+	 * Each batch is handed to the transport as a list of segments, suitable for emitting with a single gathered write.
+	 */
+	export class BatchedOutputWriter
+	{
+	public:
+		using ErrorHandler = std::function< void(std::string_view) >;
+
+		/**
+		 * on_error is invoked, on the thread running the writer, with a description of any message that could not be written as given.
+		 */
+		explicit BatchedOutputWriter(OutputBatchOptions batch_options = {}, ErrorHandler on_error = {})
+			: options{ batch_options }, report_error{ std::move(on_error) }
+		{
+		}
+
+		/**
+		 * Processes output until shutdown is set, then writes out whatever remains queued.
+		 * write_batch is invoked with a std::span< std::string_view const > of the framed messages forming each batch.
+		 */
+		template < typename WriteBatch >
+		auto run(OutputQueue& queue, std::atomic< bool > const& shutdown, WriteBatch&& write_batch) -> void
+		{
+			while (!shutdown)
+			{
+				auto msg = queue.pop_with_abort([&] { return shutdown.load(); });
+				if (!msg.has_value())
+				{
+					continue;
+				}
+
+				batch_start = std::chrono::steady_clock::now();
+				append(*msg);
+				append_queued(queue, write_batch);
+				flush(write_batch);
+			}
+
+			// Messages queued ahead of shutdown, such as the response to a shutdown request, are still written out.
+			batch_start = std::chrono::steady_clock::now();
+			append_queued(queue, write_batch);
+			flush(write_batch);
+		}
+
+		/**
+		 * Non-blocking alternative to run, for hosts serving many connections from shared threads: writes out whatever is currently queued.
+		 */
+		template < typename WriteBatch >
+		auto write_available(OutputQueue& queue, WriteBatch&& write_batch) -> void
+		{
+			batch_start = std::chrono::steady_clock::now();
+			append_queued(queue, write_batch);
+			flush(write_batch);
+		}
+
+	private:
+		auto append(OutputMessage const& message) -> void;
+		auto append_result_fields(std::span< IntegerArrayField const > fields, std::size_t content_end) -> std::size_t;
+
+		// Appends all messages currently queued, flushing along the way whenever the batch is full or has been held for max_latency.
+		auto append_queued(OutputQueue& queue, auto& write_batch) -> void
+		{
+			while (queue.drain(pending) > 0)
+			{
+				for (auto const& pending_msg : pending)
+				{
+					append(pending_msg);
+					if (used >= options.max_bytes || std::chrono::steady_clock::now() - batch_start >= options.max_latency)
+					{
+						flush(write_batch);
+					}
+				}
+				pending.clear();
+			}
+		}
+
+		auto flush(auto& write_batch) -> void
+		{
+			if (segments.empty())
+			{
+				return;
+			}
+
+			segment_views.clear();
+			for (auto const [begin, end] : segments)
+			{
+				segment_views.emplace_back(buffer.data() + begin, end - begin);
+			}
+			write_batch(std::span< std::string_view const >(segment_views));
+			if (options.metrics)
+			{
+				options.metrics->batch_messages.record(segments.size());
+			}
+
+			segments.clear();
+			used = 0;
+			batch_start = std::chrono::steady_clock::now();
+		}
+
+	private:
+		OutputBatchOptions options;
+		ErrorHandler report_error;
+		boost::json::serializer serializer;
+		std::vector< OutputMessage > pending;
+		std::string buffer;
+		std::size_t used = 0;
+		// When the first message of the current batch was appended.
+		std::chrono::steady_clock::time_point batch_start;
+		std::vector< std::pair< std::size_t, std::size_t > > segments;
+		std::vector< std::string_view > segment_views;
+	};
+}
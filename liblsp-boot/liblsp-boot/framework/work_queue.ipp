@@ -4,12 +4,18 @@ module;
 #if defined(LSP_BOOT_ENABLE_IMPORT_STD)
 import std;
 #else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string>
+#include <vector>
 #include <chrono>
 #endif
 
 export module lsp_boot.work_queue;
 
-import lsp_boot.synced_queue;
+import lsp_boot.mpsc_queue;
+import lsp_boot.histogram;
 import lsp_boot.lsp;
 
 namespace lsp_boot
@@ -18,8 +24,41 @@ namespace lsp_boot
 	{
 		lsp::RawMessage msg;
 		std::chrono::system_clock::time_point received_time;
+		// Time spent by the transport parsing the JSON content, and the content's size in bytes.
+		std::chrono::nanoseconds parse_time{};
+		std::size_t size = 0;
 	};
 
-	export using PendingInputQueue = SyncedQueue< ReceivedMessage >;
-	export using OutputQueue = SyncedQueue< lsp::RawMessage >;
+	/**
+	 * Integer array member held outside of the JSON DOM, and written directly into the output buffer by the transport.
+	 * Avoids building a boost::json::array (16+ bytes per element) for large numeric payloads such as semantic tokens.
+	 * The key is written verbatim, so must not require escaping.
+	 */
+	export struct IntegerArrayField
+	{
+		std::string key;
+		std::vector< std::uint32_t > values;
+	};
+
+	export struct OutputMessage
+	{
+		OutputMessage(lsp::RawMessage&& msg) : content{ std::move(msg) }
+		{
+		}
+
+		OutputMessage(lsp::RawMessage&& msg, std::vector< IntegerArrayField >&& fields) : content{ std::move(msg) }, result_fields{ std::move(fields) }
+		{
+		}
+
+		lsp::RawMessage content;
+		// Appended to the object under content's "result" key, which must be content's last member.
+		std::vector< IntegerArrayField > result_fields;
+		// If set, the transport also records the time taken to serialize the message here (eg. the histogram of the method being responded to).
+		Histogram* serialize_metric = nullptr;
+	};
+
+	// Input has a single producer (the transport) and a single consumer (the server).
+	// Output may be pushed to from any thread, and is consumed by the transport.
+	export using PendingInputQueue = MpscQueue< ReceivedMessage >;
+	export using OutputQueue = MpscQueue< OutputMessage >;
 }
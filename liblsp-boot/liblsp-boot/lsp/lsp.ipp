@@ -10,6 +10,7 @@ module;
 import std;
 #else
 #include <cstdint>
+#include <limits>
 #include <utility>
 #include <optional>
 #include <variant>
@@ -40,9 +41,15 @@ namespace lsp_boot::lsp
 		constexpr auto content_changes = "contentChanges"sv;
 		constexpr auto contents = "contents"sv;
 		constexpr auto data = "data"sv;
+		constexpr auto delete_count = "deleteCount"sv;
+		constexpr auto delta = "delta"sv;
 		constexpr auto diagnostics = "diagnostics"sv;
+		constexpr auto edits = "edits"sv;
 		constexpr auto end = "end"sv;
+		constexpr auto error = "error"sv;
+		constexpr auto full = "full"sv;
 		constexpr auto href = "href"sv;
+		constexpr auto language_id = "languageId"sv;
 		constexpr auto id = "id"sv;
 		constexpr auto kind = "kind"sv;
 		constexpr auto label = "label"sv;
@@ -52,26 +59,136 @@ namespace lsp_boot::lsp
 		constexpr auto method = "method"sv;
 		constexpr auto name = "name"sv;
 		constexpr auto params = "params"sv;
+		constexpr auto partial_result_token = "partialResultToken"sv;
+		constexpr auto percentage = "percentage"sv;
 		constexpr auto position = "position"sv;
+		constexpr auto position_encoding = "positionEncoding"sv;
+		constexpr auto previous_result_id = "previousResultId"sv;
 		constexpr auto range = "range"sv;
 		constexpr auto related_information = "relatedInformation"sv;
 		constexpr auto result = "result"sv;
+		constexpr auto result_id = "resultId"sv;
 		constexpr auto selection_range = "selectionRange"sv;
+		constexpr auto semantic_tokens_provider = "semanticTokensProvider"sv;
 		constexpr auto severity = "severity"sv;
 		constexpr auto source = "source"sv;
 		constexpr auto start = "start"sv;
 		constexpr auto tags = "tags"sv;
 		constexpr auto text = "text"sv;
 		constexpr auto text_document = "textDocument"sv;
+		constexpr auto title = "title"sv;
+		constexpr auto token = "token"sv;
 		constexpr auto token_modifiers = "tokenModifiers"sv;
 		constexpr auto token_types = "tokenTypes"sv;
 		constexpr auto uri = "uri"sv;
 		constexpr auto value = "value"sv;
+		constexpr auto version = "version"sv;
+		constexpr auto window = "window"sv;
+		constexpr auto work_done_progress = "workDoneProgress"sv;
+		constexpr auto work_done_token = "workDoneToken"sv;
+	}
+
+	export namespace error_codes
+	{
+		constexpr auto internal_error = -32603;
+		constexpr auto request_cancelled = -32800;
+		constexpr auto server_cancelled = -32802;
+		constexpr auto request_failed = -32803;
 	}
 
 	export using DocumentURI = std::string;
 	export using DocumentContent = std::string;
 
+	namespace detail
+	{
+		// Non-throwing accessors used in decoding typed params.
+
+		inline auto as_uint32(json::value const& js) -> std::optional< std::uint32_t >
+		{
+			constexpr auto max = std::numeric_limits< std::uint32_t >::max();
+			if (auto const value = js.if_int64(); value && *value >= 0 && std::uint64_t(*value) <= max)
+			{
+				return std::uint32_t(*value);
+			}
+			if (auto const value = js.if_uint64(); value && *value <= max)
+			{
+				return std::uint32_t(*value);
+			}
+			return std::nullopt;
+		}
+
+		inline auto as_int64(json::value const& js) -> std::optional< std::int64_t >
+		{
+			if (auto const value = js.if_int64())
+			{
+				return *value;
+			}
+			if (auto const value = js.if_uint64(); value && *value <= std::uint64_t(std::numeric_limits< std::int64_t >::max()))
+			{
+				return std::int64_t(*value);
+			}
+			return std::nullopt;
+		}
+
+		inline auto as_string_view(json::value const& js) -> std::optional< std::string_view >
+		{
+			if (auto const value = js.if_string())
+			{
+				return std::string_view{ *value };
+			}
+			return std::nullopt;
+		}
+
+		// Decodes the members of a TextDocumentIdentifier/VersionedTextDocumentIdentifier/TextDocumentItem.
+		inline auto decode_text_document(
+			json::value const& js,
+			std::string_view& uri,
+			std::int64_t* const version = nullptr,
+			std::string_view* const language_id = nullptr,
+			std::string_view* const text = nullptr) -> bool
+		{
+			auto const obj = js.if_object();
+			if (obj == nullptr)
+			{
+				return false;
+			}
+
+			bool valid = true;
+			bool has_uri = false;
+			for (auto const& member : *obj)
+			{
+				auto const key = member.key();
+				if (key == keys::uri)
+				{
+					auto const value = as_string_view(member.value());
+					valid = valid && value.has_value();
+					uri = value.value_or(std::string_view{});
+					has_uri = true;
+				}
+				else if (key == keys::version && version != nullptr)
+				{
+					// Null for an unversioned identifier.
+					auto const value = as_int64(member.value());
+					valid = valid && (value.has_value() || member.value().is_null());
+					*version = value.value_or(0);
+				}
+				else if (key == keys::language_id && language_id != nullptr)
+				{
+					auto const value = as_string_view(member.value());
+					valid = valid && value.has_value();
+					*language_id = value.value_or(std::string_view{});
+				}
+				else if (key == keys::text && text != nullptr)
+				{
+					auto const value = as_string_view(member.value());
+					valid = valid && value.has_value();
+					*text = value.value_or(std::string_view{});
+				}
+			}
+			return valid && has_uri;
+		}
+	}
+
 	export struct Location
 	{
 		std::uint32_t line = 0;
@@ -90,6 +207,40 @@ namespace lsp_boot::lsp
 			};
 		}
 
+		/**
+		 * As from_json, decoding in a single pass over the members, and returning std::nullopt rather than throwing if js is not a valid position.
+		 */
+		static auto try_from_json(json::value const& js) -> std::optional< Location >
+		{
+			auto const obj = js.if_object();
+			if (obj == nullptr)
+			{
+				return std::nullopt;
+			}
+
+			auto line = std::optional< std::uint32_t >{};
+			auto character = std::optional< std::uint32_t >{};
+			for (auto const& member : *obj)
+			{
+				if (member.key() == keys::line)
+				{
+					line = detail::as_uint32(member.value());
+				}
+				else if (member.key() == keys::character)
+				{
+					character = detail::as_uint32(member.value());
+				}
+			}
+			if (!line || !character)
+			{
+				return std::nullopt;
+			}
+			return Location{
+				.line = *line,
+				.character = *character,
+			};
+		}
+
 		explicit operator json::value() const
 		{
 			return {
@@ -104,6 +255,8 @@ namespace lsp_boot::lsp
 		Location start;
 		Location end;
 
+		auto operator== (Range const& rhs) const -> bool = default;
+
 		static auto from_json(json::value const& js) -> Range
 		{
 			auto const& obj = js.as_object();
@@ -113,6 +266,34 @@ namespace lsp_boot::lsp
 			};
 		}
 
+		static auto try_from_json(json::value const& js) -> std::optional< Range >
+		{
+			auto const obj = js.if_object();
+			if (obj == nullptr)
+			{
+				return std::nullopt;
+			}
+
+			auto start = std::optional< Location >{};
+			auto end = std::optional< Location >{};
+			for (auto const& member : *obj)
+			{
+				if (member.key() == keys::start)
+				{
+					start = Location::try_from_json(member.value());
+				}
+				else if (member.key() == keys::end)
+				{
+					end = Location::try_from_json(member.value());
+				}
+			}
+			if (!start || !end)
+			{
+				return std::nullopt;
+			}
+			return Range{ *start, *end };
+		}
+
 		explicit operator json::value() const
 		{
 			return {
@@ -122,12 +303,312 @@ namespace lsp_boot::lsp
 		}
 	};
 
-	export struct DiagnosticSeverity
+	// Typed forms of the params of frequently handled messages (see JsonMessage::typed_params).
+	// These are decoded in a single pass over the JSON members, without throwing lookups, and strings are held as views into the message they were
+	// decoded from rather than copied (in particular, document text is only copied once applied). They must therefore not outlive the message.
+
+	export struct TextDocumentParams
+	{
+		std::string_view uri;
+
+		static auto try_from_json(json::value const& js) -> std::optional< TextDocumentParams >
+		{
+			auto const text_document = js.is_object() ? js.get_object().if_contains(keys::text_document) : nullptr;
+			auto params = TextDocumentParams{};
+			if (text_document == nullptr || !detail::decode_text_document(*text_document, params.uri))
+			{
+				return std::nullopt;
+			}
+			return params;
+		}
+	};
+
+	export struct TextDocumentPositionParams
+	{
+		std::string_view uri;
+		Location position;
+
+		static auto try_from_json(json::value const& js) -> std::optional< TextDocumentPositionParams >
+		{
+			auto const obj = js.if_object();
+			if (obj == nullptr)
+			{
+				return std::nullopt;
+			}
+
+			auto params = TextDocumentPositionParams{};
+			bool has_text_document = false;
+			auto position = std::optional< Location >{};
+			for (auto const& member : *obj)
+			{
+				if (member.key() == keys::text_document)
+				{
+					has_text_document = detail::decode_text_document(member.value(), params.uri);
+				}
+				else if (member.key() == keys::position)
+				{
+					position = Location::try_from_json(member.value());
+				}
+			}
+			if (!has_text_document || !position)
+			{
+				return std::nullopt;
+			}
+			params.position = *position;
+			return params;
+		}
+	};
+
+	export struct TextDocumentRangeParams
+	{
+		std::string_view uri;
+		Range range;
+
+		static auto try_from_json(json::value const& js) -> std::optional< TextDocumentRangeParams >
+		{
+			auto const obj = js.if_object();
+			if (obj == nullptr)
+			{
+				return std::nullopt;
+			}
+
+			auto params = TextDocumentRangeParams{};
+			bool has_text_document = false;
+			auto range = std::optional< Range >{};
+			for (auto const& member : *obj)
+			{
+				if (member.key() == keys::text_document)
+				{
+					has_text_document = detail::decode_text_document(member.value(), params.uri);
+				}
+				else if (member.key() == keys::range)
+				{
+					range = Range::try_from_json(member.value());
+				}
+			}
+			if (!has_text_document || !range)
+			{
+				return std::nullopt;
+			}
+			params.range = *range;
+			return params;
+		}
+	};
+
+	export struct DidOpenTextDocumentParams
+	{
+		std::string_view uri;
+		std::string_view language_id;
+		std::int64_t version = 0;
+		std::string_view text;
+
+		static auto try_from_json(json::value const& js) -> std::optional< DidOpenTextDocumentParams >
+		{
+			auto const text_document = js.is_object() ? js.get_object().if_contains(keys::text_document) : nullptr;
+			auto params = DidOpenTextDocumentParams{};
+			if (text_document == nullptr || !detail::decode_text_document(*text_document, params.uri, &params.version, &params.language_id, &params.text))
+			{
+				return std::nullopt;
+			}
+			return params;
+		}
+	};
+
+	export struct TextDocumentContentChange
+	{
+		// Absent for a change replacing the full content.
+		std::optional< Range > range;
+		std::string_view text;
+	};
+
+	export struct DidChangeTextDocumentParams
+	{
+		std::string_view uri;
+		std::int64_t version = 0;
+		std::vector< TextDocumentContentChange > content_changes;
+
+		static auto try_from_json(json::value const& js) -> std::optional< DidChangeTextDocumentParams >
+		{
+			auto const obj = js.if_object();
+			if (obj == nullptr)
+			{
+				return std::nullopt;
+			}
+
+			auto params = DidChangeTextDocumentParams{};
+			bool has_text_document = false;
+			bool has_changes = false;
+			for (auto const& member : *obj)
+			{
+				if (member.key() == keys::text_document)
+				{
+					has_text_document = detail::decode_text_document(member.value(), params.uri, &params.version);
+				}
+				else if (member.key() == keys::content_changes)
+				{
+					auto const changes = member.value().if_array();
+					if (changes == nullptr)
+					{
+						return std::nullopt;
+					}
+
+					params.content_changes.reserve(changes->size());
+					for (auto const& change_js : *changes)
+					{
+						auto const change_obj = change_js.if_object();
+						if (change_obj == nullptr)
+						{
+							return std::nullopt;
+						}
+
+						auto& change = params.content_changes.emplace_back();
+						bool has_text = false;
+						for (auto const& change_member : *change_obj)
+						{
+							if (change_member.key() == keys::text)
+							{
+								auto const text = detail::as_string_view(change_member.value());
+								if (!text)
+								{
+									return std::nullopt;
+								}
+								change.text = *text;
+								has_text = true;
+							}
+							else if (change_member.key() == keys::range)
+							{
+								change.range = Range::try_from_json(change_member.value());
+								if (!change.range)
+								{
+									return std::nullopt;
+								}
+							}
+						}
+						if (!has_text)
+						{
+							return std::nullopt;
+						}
+					}
+					has_changes = true;
+				}
+			}
+			if (!has_text_document || !has_changes)
+			{
+				return std::nullopt;
+			}
+			return params;
+		}
+	};
+
+	/**
+	 * Specialized for message types having a typed form of their params, with member type alias type naming it.
+	 */
+	export template < typename Message >
+	struct TypedParams
+	{
+	};
+
+	export enum DiagnosticSeverity
+	{
+		ds_error = 1,
+		ds_warning = 2,
+		ds_information = 3,
+		ds_hint = 4,
+	};
+
+	export enum DiagnosticTag
+	{
+		dt_unnecessary = 1,
+		dt_deprecated = 2,
+	};
+
+	/**
+	 * Related location of a diagnostic, eg. a previous declaration conflicting with the one diagnosed.
+	 */
+	export struct DiagnosticRelatedInformation
+	{
+		DocumentURI uri;
+		Range range;
+		std::string message;
+
+		auto operator== (DiagnosticRelatedInformation const& rhs) const -> bool = default;
+
+		explicit operator json::value() const
+		{
+			return {
+				{ keys::location, json::object{
+					{ keys::uri, uri },
+					{ keys::range, json::value(range) },
+					} },
+				{ keys::message, message },
+			};
+		}
+	};
+
+	export struct Diagnostic
 	{
-		static constexpr auto error = 1;
-		static constexpr auto warning = 2;
-		static constexpr auto information = 3;
-		static constexpr auto hint = 4;
+		using Code = std::variant< std::monostate, std::int32_t, std::string >;
+
+		Range range;
+		DiagnosticSeverity severity = ds_error;
+		std::string message;
+		// Omitted if empty (or for code, std::monostate).
+		std::string source;
+		Code code;
+		// URI of documentation of the code.
+		std::string code_description;
+		std::vector< DiagnosticTag > tags;
+		std::vector< DiagnosticRelatedInformation > related_information;
+		// Returned by the client in the context of subsequent code action requests. Omitted if null.
+		json::value data;
+
+		auto operator== (Diagnostic const& rhs) const -> bool = default;
+
+		explicit operator json::value() const
+		{
+			auto js = json::object{
+				{ keys::range, json::value(range) },
+				{ keys::severity, std::to_underlying(severity) },
+				{ keys::message, message },
+			};
+			if (!source.empty())
+			{
+				js[keys::source] = source;
+			}
+			if (auto const integer_code = std::get_if< std::int32_t >(&code))
+			{
+				js[keys::code] = *integer_code;
+			}
+			else if (auto const string_code = std::get_if< std::string >(&code))
+			{
+				js[keys::code] = *string_code;
+			}
+			if (!code_description.empty())
+			{
+				js[keys::code_description] = json::object{ { keys::href, code_description } };
+			}
+			if (!tags.empty())
+			{
+				auto& tags_js = js[keys::tags].emplace_array();
+				for (auto const tag : tags)
+				{
+					tags_js.push_back(std::to_underlying(tag));
+				}
+			}
+			if (!related_information.empty())
+			{
+				auto& related_js = js[keys::related_information].emplace_array();
+				for (auto const& related : related_information)
+				{
+					related_js.push_back(json::value(related));
+				}
+			}
+			if (!data.is_null())
+			{
+				js[keys::data] = data;
+			}
+			return js;
+		}
 	};
 
 	export enum SymbolKind
@@ -273,6 +754,21 @@ namespace lsp_boot::lsp
 		return msg.at(keys::params);
 	}
 
+	/**
+	 * URI of the document the message pertains to (params.textDocument.uri), if any.
+	 */
+	export auto message_document_uri(RawMessage const& msg) -> std::optional< std::string_view >
+	{
+		auto const params = msg.if_contains(keys::params);
+		auto const text_document = params && params->is_object() ? params->get_object().if_contains(keys::text_document) : nullptr;
+		auto const uri = text_document && text_document->is_object() ? text_document->get_object().if_contains(keys::uri) : nullptr;
+		if (uri && uri->is_string())
+		{
+			return std::string_view{ uri->get_string() };
+		}
+		return std::nullopt;
+	}
+
 	// @note: short term approach is to just use the boost.json types directly, but adding wrapper to allow for static type differentiation.
 	// code gen of proper types from the LSP is probably the way to go.
 
@@ -312,6 +808,19 @@ namespace lsp_boot::lsp
 			return message_params(js);
 		}
 
+		/**
+		 * Params decoded into their typed form, for message types having one (see TypedParams); std::nullopt if they don't fit the expected schema.
+		 * The result refers into this message.
+		 */
+		auto typed_params() const& requires requires { typename TypedParams< JsonMessage >::type; }
+		{
+			using Params = typename TypedParams< JsonMessage >::type;
+			auto const params_js = js.if_contains(keys::params);
+			return params_js != nullptr ? Params::try_from_json(*params_js) : std::optional< Params >{};
+		}
+
+		auto typed_params() const&& = delete;
+
 	private:
 		RawMessage js;
 	};
@@ -327,9 +836,11 @@ namespace lsp_boot::lsp
 			inlay_hint,
 			hover,
 			semantic_tokens_full,
+			semantic_tokens_full_delta,
 			semantic_tokens_range,
 
 			semantic_tokens_refresh,
+			work_done_progress_create,
 		};
 
 		// Client to Server
@@ -339,10 +850,12 @@ namespace lsp_boot::lsp
 		using InlayHint = JsonMessage< Kinds::inlay_hint, "textDocument/inlayHint" >;
 		using Hover = JsonMessage< Kinds::hover, "textDocument/hover" >;
 		using SemanticTokensFull = JsonMessage< Kinds::semantic_tokens_full, "textDocument/semanticTokens/full" >;
+		using SemanticTokensFullDelta = JsonMessage< Kinds::semantic_tokens_full_delta, "textDocument/semanticTokens/full/delta" >;
 		using SemanticTokensRange = JsonMessage< Kinds::semantic_tokens_range, "textDocument/semanticTokens/range" >;
 
 		// Server to Client
 		using SemanticTokensRefresh = JsonMessage< Kinds::semantic_tokens_range, "workspace/semanticTokens/refresh" >;		
+		using WorkDoneProgressCreate = JsonMessage< Kinds::work_done_progress_create, "window/workDoneProgress/create" >;
 	}
 
 	export namespace notifications
@@ -356,9 +869,11 @@ namespace lsp_boot::lsp
 			did_change_text_document,
 			did_close_text_document,
 			did_change_configuration,
+			cancel_request,
 
 			// From server
 			publish_diagnostics,
+			progress,
 		};
 
 		// From client
@@ -368,11 +883,23 @@ namespace lsp_boot::lsp
 		using DidChangeTextDocument = JsonMessage< Kinds::did_change_text_document, "textDocument/didChange" >;
 		using DidCloseTextDocument = JsonMessage< Kinds::did_close_text_document, "textDocument/didClose" >;
 		using DidChangeConfiguration = JsonMessage< Kinds::did_change_configuration, "workspace/didChangeConfiguration" >;
+		using CancelRequest = JsonMessage< Kinds::cancel_request, "$/cancelRequest" >; // Handled by the framework
 
 		// From server
 		using PublishDiagnostics = JsonMessage< Kinds::publish_diagnostics, "textDocument/publishDiagnostics" >;
+		using Progress = JsonMessage< Kinds::progress, "$/progress" >;
 	}
 
+	template <> struct TypedParams< requests::DocumentSymbols > { using type = TextDocumentParams; };
+	template <> struct TypedParams< requests::InlayHint > { using type = TextDocumentRangeParams; };
+	template <> struct TypedParams< requests::Hover > { using type = TextDocumentPositionParams; };
+	template <> struct TypedParams< requests::SemanticTokensFull > { using type = TextDocumentParams; };
+	template <> struct TypedParams< requests::SemanticTokensFullDelta > { using type = TextDocumentParams; };
+	template <> struct TypedParams< requests::SemanticTokensRange > { using type = TextDocumentRangeParams; };
+	template <> struct TypedParams< notifications::DidOpenTextDocument > { using type = DidOpenTextDocumentParams; };
+	template <> struct TypedParams< notifications::DidChangeTextDocument > { using type = DidChangeTextDocumentParams; };
+	template <> struct TypedParams< notifications::DidCloseTextDocument > { using type = TextDocumentParams; };
+
 	export using Request = std::variant<
 		requests::Initialize,
 		requests::Shutdown,
@@ -380,6 +907,7 @@ namespace lsp_boot::lsp
 		requests::InlayHint,
 		requests::Hover,
 		requests::SemanticTokensFull,
+		requests::SemanticTokensFullDelta,
 		requests::SemanticTokensRange
 	>;
 
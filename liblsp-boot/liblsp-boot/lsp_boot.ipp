@@ -3,5 +3,14 @@ export module lsp_boot;
 
 export import lsp_boot.lsp;
 export import lsp_boot.server;
+export import lsp_boot.cancellation;
+export import lsp_boot.document_store;
+export import lsp_boot.logging;
+export import lsp_boot.metrics;
+export import lsp_boot.diagnostics;
+export import lsp_boot.progress;
+export import lsp_boot.background_tasks;
+export import lsp_boot.message_arena;
 export import lsp_boot.work_queue;
 export import lsp_boot.transport;
+export import lsp_boot.socket_host;
@@ -0,0 +1,84 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <utility>
+#include <memory>
+#include <functional>
+#include <atomic>
+#endif
+
+export module lsp_boot.cancellation;
+
+namespace lsp_boot
+{
+	export class CancellationSource;
+
+	/**
+	 * Observer side of a cancellation request, along the lines of std::stop_token (which is not yet generally available without experimental library flags).
+	 * A default constructed token is never cancelled.
+	 */
+	export class CancellationToken
+	{
+	public:
+		CancellationToken() = default;
+
+		auto is_cancelled() const -> bool
+		{
+			if (!state)
+			{
+				return false;
+			}
+			if (!state->cancelled.load(std::memory_order_acquire) && state->poll)
+			{
+				state->poll();
+			}
+			return state->cancelled.load(std::memory_order_acquire);
+		}
+
+	private:
+		friend class CancellationSource;
+
+		struct State
+		{
+			std::atomic< bool > cancelled = false;
+			// Optionally invoked on checking a not yet cancelled token, giving the owner of the source a chance to look for a cancellation.
+			std::function< void() > poll;
+		};
+
+		explicit CancellationToken(std::shared_ptr< State > token_state) : state{ std::move(token_state) }
+		{
+		}
+
+		std::shared_ptr< State > state;
+	};
+
+	export class CancellationSource
+	{
+	public:
+		explicit CancellationSource(std::function< void() > poll = {}) : state{ std::make_shared< CancellationToken::State >() }
+		{
+			state->poll = std::move(poll);
+		}
+
+		auto token() const -> CancellationToken
+		{
+			return CancellationToken{ state };
+		}
+
+		auto cancel() const -> void
+		{
+			state->cancelled.store(true, std::memory_order_release);
+		}
+
+		auto is_cancelled() const -> bool
+		{
+			return state->cancelled.load(std::memory_order_acquire);
+		}
+
+	private:
+		std::shared_ptr< CancellationToken::State > state;
+	};
+}
@@ -0,0 +1,119 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#endif
+
+export module lsp_boot.histogram;
+
+namespace lsp_boot
+{
+	/**
+	 * Concurrent log-linear histogram of non-negative integer values, along the lines of HdrHistogram.
+	 * Each power of 2 range is split into 16 linear sub-buckets, bounding the error of reported quantiles to ~6%. Values below 16 are exact;
+	 * values of 2^40 and above (~18 minutes, if recording nanoseconds) are clamped.
+	 * Recording is wait-free, a handful of relaxed atomic operations. Queries may run concurrently with recording, giving an approximate snapshot.
+	 */
+	export class Histogram
+	{
+	public:
+		static constexpr unsigned sub_bucket_bits = 4;
+		static constexpr unsigned max_value_bits = 40;
+		static constexpr std::uint64_t max_trackable_value = (std::uint64_t{ 1 } << max_value_bits) - 1;
+
+		auto record(std::uint64_t value) -> void
+		{
+			value = std::min(value, max_trackable_value);
+			buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+			total_count.fetch_add(1, std::memory_order_relaxed);
+			total_sum.fetch_add(value, std::memory_order_relaxed);
+
+			auto current_max = max_value.load(std::memory_order_relaxed);
+			while (value > current_max && !max_value.compare_exchange_weak(current_max, value, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		auto count() const -> std::uint64_t
+		{
+			return total_count.load(std::memory_order_relaxed);
+		}
+
+		auto max() const -> std::uint64_t
+		{
+			return max_value.load(std::memory_order_relaxed);
+		}
+
+		auto mean() const -> double
+		{
+			auto const n = count();
+			return n > 0 ? double(total_sum.load(std::memory_order_relaxed)) / n : 0.0;
+		}
+
+		/**
+		 * Value at or below which the given fraction (0 to 1) of recorded values lie, to within the bucket resolution.
+		 */
+		auto quantile(double const fraction) const -> std::uint64_t
+		{
+			std::uint64_t bucket_total = 0;
+			for (auto const& bucket : buckets)
+			{
+				bucket_total += bucket.load(std::memory_order_relaxed);
+			}
+			if (bucket_total == 0)
+			{
+				return 0;
+			}
+
+			auto const target = std::max< std::uint64_t >(1, std::uint64_t(fraction * bucket_total + 0.5));
+			std::uint64_t cumulative = 0;
+			for (std::size_t index = 0; index < bucket_count; ++index)
+			{
+				cumulative += buckets[index].load(std::memory_order_relaxed);
+				if (cumulative >= target)
+				{
+					return std::min(bucket_upper_bound(index), max());
+				}
+			}
+			return max();
+		}
+
+	private:
+		static constexpr std::size_t sub_bucket_count = std::size_t{ 1 } << sub_bucket_bits;
+		static constexpr std::size_t bucket_count = sub_bucket_count + (max_value_bits - sub_bucket_bits) * sub_bucket_count;
+
+		static constexpr auto bucket_index(std::uint64_t const value) -> std::size_t
+		{
+			if (value < sub_bucket_count)
+			{
+				return std::size_t(value);
+			}
+			auto const shift = unsigned(std::bit_width(value)) - 1 - sub_bucket_bits;
+			return sub_bucket_count + shift * sub_bucket_count + std::size_t((value >> shift) - sub_bucket_count);
+		}
+
+		static constexpr auto bucket_upper_bound(std::size_t const index) -> std::uint64_t
+		{
+			if (index < sub_bucket_count)
+			{
+				return index;
+			}
+			auto const shift = unsigned((index - sub_bucket_count) / sub_bucket_count);
+			auto const sub_bucket = (index - sub_bucket_count) % sub_bucket_count;
+			return ((std::uint64_t(sub_bucket_count + sub_bucket) + 1) << shift) - 1;
+		}
+
+		std::array< std::atomic< std::uint64_t >, bucket_count > buckets{};
+		std::atomic< std::uint64_t > total_count = 0;
+		std::atomic< std::uint64_t > total_sum = 0;
+		std::atomic< std::uint64_t > max_value = 0;
+	};
+}
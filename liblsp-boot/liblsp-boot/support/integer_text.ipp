@@ -0,0 +1,108 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <span>
+#include <bit>
+#endif
+
+export module lsp_boot.integer_text;
+
+namespace lsp_boot
+{
+	namespace detail
+	{
+		constexpr auto make_digit_pairs()
+		{
+			auto pairs = std::array< char, 200 >{};
+			for (std::size_t i = 0; i < 100; ++i)
+			{
+				pairs[i * 2] = char('0' + i / 10);
+				pairs[i * 2 + 1] = char('0' + i % 10);
+			}
+			return pairs;
+		}
+
+		inline constexpr auto digit_pairs = make_digit_pairs();
+
+		inline constexpr std::uint32_t powers_of_10[] = {
+			1, 10, 100, 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 100'000'000, 1'000'000'000,
+		};
+
+		constexpr auto decimal_digit_count(std::uint32_t const value) -> unsigned
+		{
+			// Approximate log10 from the bit width (1233/4096 ~= log10(2)), then correct by at most one.
+			// Setting the low bit doesn't change the digit count, and has 0 counted as a single digit.
+			auto const odd_value = value | 1;
+			auto const approx = (unsigned(std::bit_width(odd_value)) * 1233) >> 12;
+			return approx + 1 - unsigned(odd_value < powers_of_10[approx]);
+		}
+	}
+
+	/**
+	 * Maximum number of characters written by format_decimal.
+	 */
+	export constexpr std::size_t max_decimal_chars = 10;
+
+	/**
+	 * Writes the decimal representation of value to out, returning the end of the written characters.
+	 * Digits are produced two at a time from a lookup table, with the length known up front, so there's no reversal pass and few branches.
+	 */
+	export constexpr auto format_decimal(std::uint32_t value, char* const out) -> char*
+	{
+		auto const end = out + detail::decimal_digit_count(value);
+		auto pos = end;
+		while (value >= 100)
+		{
+			auto const pair = (value % 100) * 2;
+			value /= 100;
+			pos -= 2;
+			pos[0] = detail::digit_pairs[pair];
+			pos[1] = detail::digit_pairs[pair + 1];
+		}
+		if (value >= 10)
+		{
+			pos -= 2;
+			pos[0] = detail::digit_pairs[value * 2];
+			pos[1] = detail::digit_pairs[value * 2 + 1];
+		}
+		else
+		{
+			*--pos = char('0' + value);
+		}
+		return end;
+	}
+
+	/**
+	 * Upper bound on the number of characters written by write_integer_array for count values.
+	 */
+	export constexpr auto max_integer_array_chars(std::size_t const count) -> std::size_t
+	{
+		return 2 + count * (max_decimal_chars + 1);
+	}
+
+	/**
+	 * Writes values as a JSON array to out, which must have room for max_integer_array_chars(values.size()) characters.
+	 * @return The end of the written characters.
+	 */
+	export constexpr auto write_integer_array(std::span< std::uint32_t const > const values, char* out) -> char*
+	{
+		*out++ = '[';
+		if (!values.empty())
+		{
+			out = format_decimal(values.front(), out);
+			for (auto const value : values.subspan(1))
+			{
+				*out++ = ',';
+				out = format_decimal(value, out);
+			}
+		}
+		*out++ = ']';
+		return out;
+	}
+}
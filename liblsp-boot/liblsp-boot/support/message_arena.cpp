@@ -0,0 +1,96 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#endif
+
+module lsp_boot.message_arena;
+
+namespace lsp_boot
+{
+	class MessageArenaPool::Arena : public boost::json::memory_resource
+	{
+	public:
+		Arena(std::shared_ptr< Shared > pool, std::unique_ptr< unsigned char[] > arena_buffer)
+			: shared{ std::move(pool) }, buffer{ std::move(arena_buffer) }, resource{ buffer.get(), shared->arena_size }
+		{
+		}
+
+		~Arena()
+		{
+			// Free any overflow blocks before handing back the buffer, which may then be immediately reused by another thread.
+			resource.release();
+			shared->recycle(std::move(buffer));
+		}
+
+	private:
+		auto do_allocate(std::size_t const bytes, std::size_t const alignment) -> void* override
+		{
+			return resource.allocate(bytes, alignment);
+		}
+
+		auto do_deallocate(void*, std::size_t, std::size_t) -> void override
+		{
+		}
+
+		auto do_is_equal(memory_resource const& other) const noexcept -> bool override
+		{
+			return this == &other;
+		}
+
+	private:
+		std::shared_ptr< Shared > shared;
+		std::unique_ptr< unsigned char[] > buffer;
+		boost::json::monotonic_resource resource;
+	};
+
+	MessageArenaPool::MessageArenaPool(std::size_t const arena_size, std::size_t const max_pooled)
+		: shared{ std::make_shared< Shared >() }
+	{
+		shared->arena_size = arena_size;
+		shared->max_pooled = max_pooled;
+	}
+
+	auto MessageArenaPool::make_storage() -> boost::json::storage_ptr
+	{
+		auto buffer = [&] {
+			auto lock = std::scoped_lock{ shared->mtx };
+			if (shared->free_buffers.empty())
+			{
+				return std::unique_ptr< unsigned char[] >{};
+			}
+			auto reused = std::move(shared->free_buffers.back());
+			shared->free_buffers.pop_back();
+			return reused;
+			}();
+
+		if (buffer)
+		{
+			shared->reused.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			buffer = std::make_unique_for_overwrite< unsigned char[] >(shared->arena_size);
+			shared->created.fetch_add(1, std::memory_order_relaxed);
+		}
+		return boost::json::make_shared_resource< Arena >(shared, std::move(buffer));
+	}
+
+	auto MessageArenaPool::Shared::recycle(std::unique_ptr< unsigned char[] > buffer) -> void
+	{
+		auto lock = std::scoped_lock{ mtx };
+		if (free_buffers.size() < max_pooled)
+		{
+			free_buffers.push_back(std::move(buffer));
+		}
+	}
+}
@@ -0,0 +1,72 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#endif
+
+export module lsp_boot.message_arena;
+
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace lsp_boot
+{
+	/**
+	 * Pool of monotonic arenas for the JSON of individual messages, replacing the many small heap allocations made in parsing or building a message
+	 * with pointer bumps. Buffers are recycled between messages, so in the steady state a message costs a single allocation (of the shared resource).
+	 * Typically shared between the transport, which parses incoming messages into arenas, and the server, which builds responses in them; buffers
+	 * then circulate between the two.
+	 */
+	export class MessageArenaPool
+	{
+	public:
+		static constexpr std::size_t default_arena_size = 32 * 1024;
+		static constexpr std::size_t default_max_pooled = 64;
+
+		/**
+		 * @param arena_size Size of the buffer backing each arena. Allocations beyond this are made from the heap, and freed along with the arena.
+		 * @param max_pooled Maximum number of idle buffers retained.
+		 */
+		explicit MessageArenaPool(std::size_t arena_size = default_arena_size, std::size_t max_pooled = default_max_pooled);
+
+		/**
+		 * Storage for the JSON of a single message. Deallocation is a no-op; the arena returns to the pool once the last value using it is destroyed.
+		 * May be called from any thread, and values may be destroyed on any thread. Values may outlive the pool.
+		 */
+		auto make_storage() -> boost::json::storage_ptr;
+
+		auto arenas_created() const -> std::uint64_t
+		{
+			return shared->created.load(std::memory_order_relaxed);
+		}
+
+		auto arenas_reused() const -> std::uint64_t
+		{
+			return shared->reused.load(std::memory_order_relaxed);
+		}
+
+	private:
+		class Arena;
+
+		struct Shared
+		{
+			std::size_t arena_size;
+			std::size_t max_pooled;
+			std::mutex mtx;
+			std::vector< std::unique_ptr< unsigned char[] > > free_buffers;
+			std::atomic< std::uint64_t > created = 0;
+			std::atomic< std::uint64_t > reused = 0;
+
+			auto recycle(std::unique_ptr< unsigned char[] > buffer) -> void;
+		};
+
+		std::shared_ptr< Shared > shared;
+	};
+}
@@ -0,0 +1,235 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <vector>
+#include <functional>
+#include <atomic>
+#endif
+
+export module lsp_boot.mpsc_queue;
+
+namespace lsp_boot
+{
+	/**
+	 * Unbounded lock-free multiple producer, single consumer queue (intrusive node based, after Vyukov).
+	 * Drop-in replacement for SyncedQueue where only a single thread ever pops; also serves the single producer case.
+	 * Producers never block; the consumer blocks only when the queue is empty, and producers only issue a wake up if the consumer is actually waiting.
+	 * Alternatively the consumer may be scheduled rather than blocking (see set_waker), so that many queues can be served by a few threads.
+	 */
+	export template < typename T >
+	class MpscQueue
+	{
+	public:
+		MpscQueue() : tail{ new Node{} }
+		{
+			head.store(tail, std::memory_order_relaxed);
+		}
+
+		MpscQueue(MpscQueue const&) = delete;
+		auto operator= (MpscQueue const&) -> MpscQueue& = delete;
+
+		~MpscQueue()
+		{
+			while (tail != nullptr)
+			{
+				delete std::exchange(tail, tail->next.load(std::memory_order_relaxed));
+			}
+		}
+
+		/**
+		 * May be called concurrently from any number of threads.
+		 */
+		auto push(T&& value) -> void
+		{
+			auto const node = new Node{};
+			node->value.emplace(std::move(value));
+
+			auto const prev = head.exchange(node, std::memory_order_acq_rel);
+			prev->next.store(node, std::memory_order_seq_cst);
+
+			if (waker)
+			{
+				schedule();
+			}
+			else if (consumer_waiting.load(std::memory_order_seq_cst) && consumer_waiting.exchange(false, std::memory_order_seq_cst))
+			{
+				wake(false);
+			}
+		}
+
+		/**
+		 * Has the consumer scheduled rather than blocking: a push or notify finding it idle invokes waker on the calling thread, which should
+		 * arrange for the queue to be consumed (eg. by submitting a task to a pool), after which the consumer is active until it's released
+		 * (see release). Must be set before the queue is used.
+		 */
+		auto set_waker(std::function< void() > consumer_waker) -> void
+		{
+			waker = std::move(consumer_waker);
+		}
+
+		// Consumer side. All of the below must only be called from a single thread at a time.
+
+		auto pop() -> T
+		{
+			return *pop_with_abort([] { return false; });
+		}
+
+		auto pop_with_abort(auto should_abort) -> std::optional< T >
+		{
+			while (true)
+			{
+				auto const epoch = signal.load(std::memory_order_seq_cst);
+
+				for (int spin = 0; spin < spin_count; ++spin)
+				{
+					if (auto value = try_pop(); value.has_value())
+					{
+						return value;
+					}
+				}
+				if (should_abort())
+				{
+					return std::nullopt;
+				}
+
+				consumer_waiting.store(true, std::memory_order_seq_cst);
+				if (tail->next.load(std::memory_order_seq_cst) == nullptr)
+				{
+					signal.wait(epoch, std::memory_order_seq_cst);
+				}
+				consumer_waiting.store(false, std::memory_order_relaxed);
+			}
+		}
+
+		auto try_pop() -> std::optional< T >
+		{
+			auto const next = tail->next.load(std::memory_order_acquire);
+			if (next == nullptr)
+			{
+				// Either empty, or a producer is part way through a push; either way there is nothing available yet.
+				return std::nullopt;
+			}
+
+			auto value = std::move(next->value);
+			next->value.reset();
+			delete std::exchange(tail, next);
+			return value;
+		}
+
+		/**
+		 * Moves all currently available values onto the end of out, without blocking.
+		 * @return The number of values moved.
+		 */
+		auto drain(std::vector< T >& out) -> std::size_t
+		{
+			std::size_t count = 0;
+			while (auto value = try_pop())
+			{
+				out.push_back(std::move(*value));
+				++count;
+			}
+			return count;
+		}
+
+		/**
+		 * Blocks until at least one value is available (or should_abort returns true), then moves all available values onto the end of out.
+		 * @return The number of values moved.
+		 */
+		auto pop_batch_with_abort(std::vector< T >& out, auto should_abort) -> std::size_t
+		{
+			if (auto value = pop_with_abort(std::move(should_abort)); value.has_value())
+			{
+				out.push_back(std::move(*value));
+				return 1 + drain(out);
+			}
+			return 0;
+		}
+
+		/**
+		 * For a scheduled consumer, the number of pushes and notifications it's been woken for. To be taken as it starts consuming.
+		 */
+		auto wakeups() const -> std::size_t
+		{
+			return scheduled.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * For a scheduled consumer, once it has consumed what's available: accounts for count wake ups, leaving the consumer idle unless there
+		 * were more meanwhile, in which case count is updated to include them and the consumer should carry on.
+		 * @return true if the consumer is now idle, after which it must no longer touch the queue (which the next waker may have destroyed).
+		 */
+		auto release(std::size_t& count) -> bool
+		{
+			if (scheduled.fetch_sub(count, std::memory_order_acq_rel) == count)
+			{
+				return true;
+			}
+			count = scheduled.load(std::memory_order_acquire);
+			return false;
+		}
+
+		/**
+		 * Wakes the consumer, if blocked, to re-evaluate its abort condition. A scheduled consumer is run again, if idle.
+		 */
+		auto notify() -> void
+		{
+			if (waker)
+			{
+				schedule();
+			}
+			else
+			{
+				wake(true);
+			}
+		}
+
+	private:
+		struct Node
+		{
+			std::atomic< Node* > next = nullptr;
+			std::optional< T > value;
+		};
+
+		auto schedule() -> void
+		{
+			if (scheduled.fetch_add(1, std::memory_order_acq_rel) == 0)
+			{
+				waker();
+			}
+		}
+
+		auto wake(bool const all) -> void
+		{
+			signal.fetch_add(1, std::memory_order_seq_cst);
+			if (all)
+			{
+				signal.notify_all();
+			}
+			else
+			{
+				signal.notify_one();
+			}
+		}
+
+		static constexpr int spin_count = 64;
+		static constexpr std::size_t cache_line_size = 64;
+
+		// Producer side
+		alignas(cache_line_size) std::atomic< Node* > head;
+		// Consumer side
+		alignas(cache_line_size) Node* tail;
+		// Wake up signalling
+		alignas(cache_line_size) std::atomic< bool > consumer_waiting = false;
+		std::atomic< std::uint32_t > signal = 0;
+		// Scheduled consumer
+		std::function< void() > waker;
+		std::atomic< std::size_t > scheduled = 0;
+	};
+}
@@ -0,0 +1,122 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <memory>
+#include <atomic>
+#include <bit>
+#endif
+
+export module lsp_boot.ring_buffer;
+
+namespace lsp_boot
+{
+	/**
+	 * Bounded lock-free multiple producer, single consumer ring buffer (sequenced slots, after Vyukov).
+	 * Values are exchanged with the slots by swapping rather than moving, so that the slot storage is recycled: a producer pushing a string gets back
+	 * the buffer of a string previously popped, and no allocation occurs in the steady state.
+	 * Neither side ever blocks; a push to a full ring fails.
+	 */
+	export template < typename T >
+	class MpscRingBuffer
+	{
+	public:
+		/**
+		 * Capacity is rounded up to a power of 2.
+		 */
+		explicit MpscRingBuffer(std::size_t const min_capacity)
+			: capacity{ std::bit_ceil(std::max< std::size_t >(min_capacity, 2)) }, slots{ std::make_unique< Slot[] >(capacity) }
+		{
+			for (std::size_t i = 0; i < capacity; ++i)
+			{
+				slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		MpscRingBuffer(MpscRingBuffer const&) = delete;
+		auto operator= (MpscRingBuffer const&) -> MpscRingBuffer& = delete;
+
+		/**
+		 * May be called concurrently from any number of threads.
+		 * On success, value is swapped into the ring and receives the (moved from) content of a previously popped slot.
+		 * @return false if the ring is full, in which case value is unchanged.
+		 */
+		auto try_push(T& value) -> bool
+		{
+			auto pos = enqueue_pos.load(std::memory_order_relaxed);
+			while (true)
+			{
+				auto& slot = slots[pos & (capacity - 1)];
+				auto const sequence = slot.sequence.load(std::memory_order_acquire);
+				auto const diff = static_cast< std::intptr_t >(sequence) - static_cast< std::intptr_t >(pos);
+				if (diff == 0)
+				{
+					if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						using std::swap;
+						swap(slot.value, value);
+						slot.sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Consumer side. Must only be called from a single thread at a time.
+
+		/**
+		 * Whether a value is available to pop.
+		 */
+		auto ready() const -> bool
+		{
+			return slots[dequeue_pos & (capacity - 1)].sequence.load(std::memory_order_acquire) == dequeue_pos + 1;
+		}
+
+		/**
+		 * On success, swaps the oldest value with value, so that the ring takes ownership of value's storage for reuse.
+		 */
+		auto try_pop(T& value) -> bool
+		{
+			auto& slot = slots[dequeue_pos & (capacity - 1)];
+			if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1)
+			{
+				return false;
+			}
+
+			using std::swap;
+			swap(slot.value, value);
+			slot.sequence.store(dequeue_pos + capacity, std::memory_order_release);
+			++dequeue_pos;
+			return true;
+		}
+
+	private:
+		static constexpr std::size_t cache_line_size = 64;
+
+		struct alignas(cache_line_size) Slot
+		{
+			std::atomic< std::size_t > sequence;
+			T value;
+		};
+
+		std::size_t const capacity;
+		std::unique_ptr< Slot[] > const slots;
+		// Producer side
+		alignas(cache_line_size) std::atomic< std::size_t > enqueue_pos = 0;
+		// Consumer side
+		alignas(cache_line_size) std::size_t dequeue_pos = 0;
+	};
+}
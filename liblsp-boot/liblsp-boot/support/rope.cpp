@@ -0,0 +1,237 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <algorithm>
+#endif
+
+module lsp_boot.rope;
+
+namespace lsp_boot
+{
+	namespace
+	{
+		constexpr std::size_t max_chunk_size = 1024;
+
+		auto next_priority() -> std::uint32_t
+		{
+			// xorshift32
+			thread_local std::uint32_t state = 0x9e3779b9u;
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+	}
+
+	TextRope::TextRope(std::string_view const text) : root{ build(text) }
+	{
+	}
+
+	auto TextRope::make_chunk(std::string text) -> ChunkPtr
+	{
+		auto const chunk_newlines = std::size_t(std::ranges::count(text, '\n'));
+		return std::make_shared< Chunk const >(Chunk{ std::move(text), chunk_newlines });
+	}
+
+	auto TextRope::make_node(NodePtr left, ChunkPtr chunk, NodePtr right, std::uint32_t const priority) -> NodePtr
+	{
+		auto const total_bytes = bytes(left.get()) + chunk->text.size() + bytes(right.get());
+		auto const total_newlines = newlines(left.get()) + chunk->newlines + newlines(right.get());
+		return std::make_shared< Node const >(Node{
+			.left = std::move(left),
+			.right = std::move(right),
+			.chunk = std::move(chunk),
+			.bytes = total_bytes,
+			.newlines = total_newlines,
+			.priority = priority,
+			});
+	}
+
+	auto TextRope::build(std::string_view text) -> NodePtr
+	{
+		NodePtr result;
+		while (!text.empty())
+		{
+			auto const piece = text.substr(0, max_chunk_size);
+			text.remove_prefix(piece.size());
+			result = merge(result, make_node(nullptr, make_chunk(std::string{ piece }), nullptr, next_priority()));
+		}
+		return result;
+	}
+
+	auto TextRope::split(NodePtr const& node, std::size_t offset) -> std::pair< NodePtr, NodePtr >
+	{
+		if (node == nullptr || offset == 0)
+		{
+			return { nullptr, node };
+		}
+		if (offset >= node->bytes)
+		{
+			return { node, nullptr };
+		}
+
+		auto const left_bytes = bytes(node->left.get());
+		if (offset <= left_bytes)
+		{
+			auto [first, second] = split(node->left, offset);
+			return { std::move(first), make_node(std::move(second), node->chunk, node->right, node->priority) };
+		}
+
+		offset -= left_bytes;
+		auto const& text = node->chunk->text;
+		if (offset >= text.size())
+		{
+			auto [first, second] = split(node->right, offset - text.size());
+			return { make_node(node->left, node->chunk, std::move(first), node->priority), std::move(second) };
+		}
+
+		// Split point lies within this node's chunk. Both halves retain the node's priority, preserving the heap ordering.
+		return {
+			make_node(node->left, make_chunk(text.substr(0, offset)), nullptr, node->priority),
+			make_node(nullptr, make_chunk(text.substr(offset)), node->right, node->priority),
+		};
+	}
+
+	auto TextRope::merge(NodePtr const& left, NodePtr const& right) -> NodePtr
+	{
+		if (left == nullptr)
+		{
+			return right;
+		}
+		if (right == nullptr)
+		{
+			return left;
+		}
+
+		if (left->priority > right->priority)
+		{
+			return make_node(left->left, left->chunk, merge(left->right, right), left->priority);
+		}
+		else
+		{
+			return make_node(merge(left, right->left), right->chunk, right->right, right->priority);
+		}
+	}
+
+	auto TextRope::pop_front(NodePtr const& node) -> std::pair< std::string, NodePtr >
+	{
+		if (node->left == nullptr)
+		{
+			return { node->chunk->text, node->right };
+		}
+		auto [text, rest] = pop_front(node->left);
+		return { std::move(text), make_node(std::move(rest), node->chunk, node->right, node->priority) };
+	}
+
+	auto TextRope::pop_back(NodePtr const& node) -> std::pair< NodePtr, std::string >
+	{
+		if (node->right == nullptr)
+		{
+			return { node->left, node->chunk->text };
+		}
+		auto [rest, text] = pop_back(node->right);
+		return { make_node(node->left, node->chunk, std::move(rest), node->priority), std::move(text) };
+	}
+
+	auto TextRope::line_start(std::size_t const line) const -> std::size_t
+	{
+		if (line == 0)
+		{
+			return 0;
+		}
+		if (line > newlines(root.get()))
+		{
+			return size();
+		}
+
+		// Find the offset following the line'th newline.
+		auto remaining = line;
+		std::size_t offset = 0;
+		auto node = root.get();
+		while (node != nullptr)
+		{
+			auto const left_newlines = newlines(node->left.get());
+			if (remaining <= left_newlines)
+			{
+				node = node->left.get();
+				continue;
+			}
+
+			remaining -= left_newlines;
+			offset += bytes(node->left.get());
+
+			auto const& chunk = *node->chunk;
+			if (remaining <= chunk.newlines)
+			{
+				for (std::size_t pos = 0; ; ++pos)
+				{
+					pos = chunk.text.find('\n', pos);
+					if (--remaining == 0)
+					{
+						return offset + pos + 1;
+					}
+				}
+			}
+
+			remaining -= chunk.newlines;
+			offset += chunk.text.size();
+			node = node->right.get();
+		}
+		return size();
+	}
+
+	auto TextRope::replace(std::size_t const offset, std::size_t const count, std::string_view const text) const -> TextRope
+	{
+		auto const start = std::min(offset, size());
+		auto const end = start + std::min(count, size() - start);
+
+		auto [left, rest] = split(root, start);
+		auto right = split(rest, end - start).second;
+
+		// Fold small neighbouring chunks into the inserted text, so that a sequence of small edits does not fragment the rope.
+		auto const edge_chunk_size = [](Node const* node, bool const rightmost) -> std::size_t {
+			while (node != nullptr && (rightmost ? node->right : node->left) != nullptr)
+			{
+				node = (rightmost ? node->right : node->left).get();
+			}
+			return node != nullptr ? node->chunk->text.size() : 0;
+			};
+
+		auto middle = std::string{};
+		if (left != nullptr && edge_chunk_size(left.get(), true) + text.size() <= max_chunk_size)
+		{
+			auto [remaining_left, back] = pop_back(left);
+			left = std::move(remaining_left);
+			middle = std::move(back);
+		}
+		middle += text;
+		if (right != nullptr && middle.size() + edge_chunk_size(right.get(), false) <= max_chunk_size)
+		{
+			auto [front, remaining_right] = pop_front(right);
+			middle += front;
+			right = std::move(remaining_right);
+		}
+
+		return TextRope{ merge(merge(left, build(middle)), right) };
+	}
+
+	auto TextRope::substr(std::size_t const offset, std::size_t const count) const -> std::string
+	{
+		auto result = std::string{};
+		result.reserve(std::min(count, size()));
+		for_each_chunk(offset, count, [&](std::string_view const piece) {
+			result += piece;
+			return true;
+			});
+		return result;
+	}
+}
@@ -0,0 +1,155 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <algorithm>
+#endif
+
+export module lsp_boot.rope;
+
+namespace lsp_boot
+{
+	/**
+	 * Immutable text rope, implemented as a persistent treap of text chunks.
+	 * Nodes maintain subtree byte and newline counts, giving O(log n) lookup of line starts. Edits produce a new rope in O(edit size + log n),
+	 * sharing all untouched structure with the original, so copies are cheap and can be freely handed out as snapshots.
+	 */
+	export class TextRope
+	{
+	public:
+		TextRope() = default;
+		explicit TextRope(std::string_view text);
+
+		/**
+		 * Total size in bytes.
+		 */
+		auto size() const -> std::size_t
+		{
+			return bytes(root.get());
+		}
+
+		auto empty() const -> bool
+		{
+			return size() == 0;
+		}
+
+		/**
+		 * Number of lines, being one more than the number of '\n' characters.
+		 */
+		auto line_count() const -> std::size_t
+		{
+			return newlines(root.get()) + 1;
+		}
+
+		/**
+		 * Byte offset of the first character of the given (0-based) line, or size() if line >= line_count().
+		 */
+		auto line_start(std::size_t line) const -> std::size_t;
+
+		/**
+		 * Returns a new rope with count bytes at offset replaced by text. Offsets beyond the end are clamped.
+		 */
+		auto replace(std::size_t offset, std::size_t count, std::string_view text) const -> TextRope;
+
+		auto substr(std::size_t offset, std::size_t count) const -> std::string;
+
+		auto str() const -> std::string
+		{
+			return substr(0, size());
+		}
+
+		/**
+		 * Invokes f with consecutive std::string_view pieces making up the byte range [offset, offset + count).
+		 * Iteration stops early if f returns false.
+		 */
+		template < typename F >
+		auto for_each_chunk(std::size_t const offset, std::size_t const count, F&& f) const -> void
+		{
+			auto const begin = std::min(offset, size());
+			auto const end = begin + std::min(count, size() - begin);
+			visit_chunks(root.get(), 0, begin, end, f);
+		}
+
+	private:
+		// Chunks are shared between the path copies made on edits.
+		struct Chunk
+		{
+			std::string text;
+			std::size_t newlines;
+		};
+		using ChunkPtr = std::shared_ptr< Chunk const >;
+
+		struct Node;
+		using NodePtr = std::shared_ptr< Node const >;
+
+		struct Node
+		{
+			NodePtr left;
+			NodePtr right;
+			ChunkPtr chunk;
+			// Subtree totals
+			std::size_t bytes;
+			std::size_t newlines;
+			std::uint32_t priority;
+		};
+
+		static auto bytes(Node const* node) -> std::size_t
+		{
+			return node ? node->bytes : 0;
+		}
+
+		static auto newlines(Node const* node) -> std::size_t
+		{
+			return node ? node->newlines : 0;
+		}
+
+		// Returns false if iteration was stopped.
+		template < typename F >
+		static auto visit_chunks(Node const* node, std::size_t const base, std::size_t const begin, std::size_t const end, F& f) -> bool
+		{
+			if (node == nullptr || begin >= end || base >= end || base + node->bytes <= begin)
+			{
+				return true;
+			}
+
+			if (!visit_chunks(node->left.get(), base, begin, end, f))
+			{
+				return false;
+			}
+
+			auto const chunk_start = base + bytes(node->left.get());
+			auto const chunk_end = chunk_start + node->chunk->text.size();
+			auto const from = std::max(begin, chunk_start);
+			auto const to = std::min(end, chunk_end);
+			if (from < to && !f(std::string_view(node->chunk->text).substr(from - chunk_start, to - from)))
+			{
+				return false;
+			}
+
+			return visit_chunks(node->right.get(), chunk_end, begin, end, f);
+		}
+
+		static auto make_chunk(std::string text) -> ChunkPtr;
+		static auto make_node(NodePtr left, ChunkPtr chunk, NodePtr right, std::uint32_t priority) -> NodePtr;
+		static auto build(std::string_view text) -> NodePtr;
+		static auto split(NodePtr const& node, std::size_t offset) -> std::pair< NodePtr, NodePtr >;
+		static auto merge(NodePtr const& left, NodePtr const& right) -> NodePtr;
+		static auto pop_front(NodePtr const& node) -> std::pair< std::string, NodePtr >;
+		static auto pop_back(NodePtr const& node) -> std::pair< NodePtr, std::string >;
+
+		explicit TextRope(NodePtr root_node) : root{ std::move(root_node) }
+		{
+		}
+
+	private:
+		NodePtr root;
+	};
+}
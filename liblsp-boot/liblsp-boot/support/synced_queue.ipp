@@ -5,6 +5,7 @@ module;
 import std;
 #else
 #include <queue>
+#include <vector>
 #include <optional>
 #include <mutex>
 #include <condition_variable>
@@ -68,6 +69,22 @@ namespace lsp_boot
 			return std::nullopt;
 		}
 
+		/**
+		 * Moves all currently queued values onto the end of out, without blocking.
+		 * @return The number of values moved.
+		 */
+		auto drain(std::vector< T >& out) -> std::size_t
+		{
+			auto lock = std::scoped_lock{ mtx };
+			auto const count = queue.size();
+			while (!queue.empty())
+			{
+				out.push_back(std::move(queue.front()));
+				queue.pop();
+			}
+			return count;
+		}
+
 		auto notify() -> void
 		{
 			cvar.notify_all();
@@ -0,0 +1,98 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+export module lsp_boot.thread_pool;
+
+namespace lsp_boot
+{
+	/**
+	 * Fixed size pool of worker threads servicing a shared FIFO of tasks.
+	 * Destruction completes all queued tasks before joining the workers.
+	 */
+	export class ThreadPool
+	{
+	public:
+		using Task = std::function< void() >;
+
+		explicit ThreadPool(std::size_t const thread_count)
+		{
+			workers.reserve(thread_count);
+			for (std::size_t i = 0; i < thread_count; ++i)
+			{
+				workers.emplace_back([this] { worker_loop(); });
+			}
+		}
+
+		ThreadPool(ThreadPool const&) = delete;
+		auto operator= (ThreadPool const&) -> ThreadPool& = delete;
+
+		~ThreadPool()
+		{
+			{
+				auto lock = std::scoped_lock{ mtx };
+				stopping = true;
+			}
+			cvar.notify_all();
+			for (auto& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		auto submit(Task task) -> void
+		{
+			{
+				auto lock = std::scoped_lock{ mtx };
+				tasks.push_back(std::move(task));
+			}
+			cvar.notify_one();
+		}
+
+		auto thread_count() const -> std::size_t
+		{
+			return workers.size();
+		}
+
+	private:
+		auto worker_loop() -> void
+		{
+			while (true)
+			{
+				Task task;
+				{
+					auto lock = std::unique_lock{ mtx };
+					cvar.wait(lock, [this] {
+						return !tasks.empty() || stopping;
+						});
+					if (tasks.empty())
+					{
+						return;
+					}
+					task = std::move(tasks.front());
+					tasks.pop_front();
+				}
+				task();
+			}
+		}
+
+	private:
+		std::deque< Task > tasks;
+		std::mutex mtx;
+		std::condition_variable cvar;
+		bool stopping = false;
+		std::vector< std::thread > workers;
+	};
+}
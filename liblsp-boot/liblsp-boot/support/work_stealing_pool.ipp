@@ -0,0 +1,245 @@
+
+module;
+
+#if defined(LSP_BOOT_ENABLE_IMPORT_STD)
+import std;
+#else
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <array>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#endif
+
+export module lsp_boot.work_stealing_pool;
+
+namespace lsp_boot
+{
+	export enum class TaskPriority : std::uint8_t
+	{
+		high,
+		normal,
+		// Not started while the pool is marked as busy in the foreground (see WorkStealingPool::enter_foreground).
+		low,
+	};
+
+	/**
+	 * Pool of worker threads, each with its own queues of tasks, one per priority. Tasks submitted from a worker go to its own queues
+	 * and are taken most recent first, keeping related work on the thread that spawned it; idle workers steal the oldest tasks from others.
+	 * Higher priority tasks are always started ahead of lower priority ones, wherever they're queued.
+	 * Submitting and claiming tasks touch only the worker queues and per priority atomic counts; the pool wide lock is taken only to put idle
+	 * workers to sleep, and to wake them.
+	 * Destruction discards tasks not yet started, and waits for those running.
+	 */
+	export class WorkStealingPool
+	{
+	public:
+		using Task = std::function< void() >;
+
+		explicit WorkStealingPool(std::size_t const thread_count) : queues(std::max< std::size_t >(thread_count, 1))
+		{
+			workers.reserve(queues.size());
+			for (std::size_t i = 0; i < queues.size(); ++i)
+			{
+				workers.emplace_back([this, i] { worker_loop(i); });
+			}
+		}
+
+		WorkStealingPool(WorkStealingPool const&) = delete;
+		auto operator= (WorkStealingPool const&) -> WorkStealingPool& = delete;
+
+		~WorkStealingPool()
+		{
+			{
+				auto lock = std::scoped_lock{ mtx };
+				stopping.store(true, std::memory_order_release);
+			}
+			cvar.notify_all();
+			for (auto& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		auto submit(Task task, TaskPriority const priority = TaskPriority::normal) -> void
+		{
+			auto const target = current_pool == this ? current_worker : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+			{
+				auto& queue = queues[target];
+				auto lock = std::scoped_lock{ queue.mtx };
+				queue.tasks[std::size_t(priority)].push_back(std::move(task));
+			}
+			queued[std::size_t(priority)].fetch_add(1, std::memory_order_seq_cst);
+			wake(false);
+		}
+
+		/**
+		 * Foreground work (eg. a request being handled) holds back the starting of low priority tasks until the matching leave_foreground.
+		 * Calls may be nested, and made from any thread.
+		 */
+		auto enter_foreground() -> void
+		{
+			foreground.fetch_add(1, std::memory_order_seq_cst);
+		}
+
+		auto leave_foreground() -> void
+		{
+			if (foreground.fetch_sub(1, std::memory_order_seq_cst) == 1)
+			{
+				wake(true);
+			}
+		}
+
+		/**
+		 * Whether any foreground work is in progress, in which case long running tasks should yield where they can, by resubmitting their remaining work.
+		 */
+		auto foreground_busy() const -> bool
+		{
+			return foreground.load(std::memory_order_relaxed) > 0;
+		}
+
+		auto thread_count() const -> std::size_t
+		{
+			return workers.size();
+		}
+
+	private:
+		static constexpr std::size_t priority_count = 3;
+
+		struct WorkerQueues
+		{
+			std::mutex mtx;
+			std::array< std::deque< Task >, priority_count > tasks;
+		};
+
+		// Priorities below the limit are allowed to start.
+		auto priority_limit() const -> std::size_t
+		{
+			return foreground.load(std::memory_order_seq_cst) > 0 ? std::size_t(TaskPriority::low) : priority_count;
+		}
+
+		auto any_claimable() const -> bool
+		{
+			auto const limit = priority_limit();
+			for (std::size_t priority = 0; priority < limit; ++priority)
+			{
+				if (queued[priority].load(std::memory_order_seq_cst) > 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Claims one of the queued tasks of the highest priority allowed to start, returning its priority (priority_count if there are none).
+		auto claim() -> std::size_t
+		{
+			auto const limit = priority_limit();
+			for (std::size_t priority = 0; priority < limit; ++priority)
+			{
+				auto count = queued[priority].load(std::memory_order_relaxed);
+				while (count > 0)
+				{
+					if (queued[priority].compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+					{
+						return priority;
+					}
+				}
+			}
+			return priority_count;
+		}
+
+		// A claim is only made for a task already queued, so one of the given priority is always found.
+		auto take(std::size_t const worker, std::size_t const priority) -> Task
+		{
+			{
+				auto& own = queues[worker];
+				auto lock = std::scoped_lock{ own.mtx };
+				if (auto& tasks = own.tasks[priority]; !tasks.empty())
+				{
+					auto task = std::move(tasks.back());
+					tasks.pop_back();
+					return task;
+				}
+			}
+			for (std::size_t offset = 1; ; ++offset)
+			{
+				auto& victim = queues[(worker + offset) % queues.size()];
+				auto lock = std::scoped_lock{ victim.mtx };
+				if (auto& tasks = victim.tasks[priority]; !tasks.empty())
+				{
+					auto task = std::move(tasks.front());
+					tasks.pop_front();
+					return task;
+				}
+			}
+		}
+
+		// Wakes a sleeping worker to claim a newly queued task, or all of them once low priority tasks may start. The pool's lock is only
+		// taken when there are sleepers: a worker going to sleep raises the count before rechecking what's claimable, so either it sees
+		// the caller's change, or the caller sees it (all being sequentially consistent) and the lock orders the notification after its wait.
+		auto wake(bool const all) -> void
+		{
+			if (sleepers.load(std::memory_order_seq_cst) == 0)
+			{
+				return;
+			}
+			{
+				auto lock = std::scoped_lock{ mtx };
+			}
+			if (all)
+			{
+				cvar.notify_all();
+			}
+			else
+			{
+				cvar.notify_one();
+			}
+		}
+
+		auto worker_loop(std::size_t const index) -> void
+		{
+			current_pool = this;
+			current_worker = index;
+
+			while (!stopping.load(std::memory_order_acquire))
+			{
+				if (auto const priority = claim(); priority < priority_count)
+				{
+					take(index, priority)();
+					continue;
+				}
+
+				auto lock = std::unique_lock{ mtx };
+				sleepers.fetch_add(1, std::memory_order_seq_cst);
+				cvar.wait(lock, [&] {
+					return stopping.load(std::memory_order_relaxed) || any_claimable();
+					});
+				sleepers.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		std::vector< WorkerQueues > queues;
+		std::atomic< std::size_t > next_queue = 0;
+		// Per priority count of queued tasks not yet claimed by a worker.
+		std::array< std::atomic< std::size_t >, priority_count > queued = {};
+		std::atomic< std::size_t > foreground = 0;
+		std::atomic< bool > stopping = false;
+		// Used only by workers going to sleep, and to wake them.
+		std::mutex mtx;
+		std::condition_variable cvar;
+		std::atomic< std::size_t > sleepers = 0;
+		std::vector< std::thread > workers;
+
+		static inline thread_local WorkStealingPool const* current_pool = nullptr;
+		static inline thread_local std::size_t current_worker = 0;
+	};
+}
@@ -0,0 +1,198 @@
+// Allocation count and memory footprint of replaying a session through FdConnection, with messages parsed using the default heap storage
+// against pooled message arenas (MessageArenaPool). Messages are consumed and released on a separate thread, as they would be by the server.
+// Usage: driver [message-count] [large-content-bytes]
+
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <chrono>
+
+#undef NDEBUG
+#include <cassert>
+
+import lsp_boot;
+import lsp_boot.ext_mod_wrap.boost.json;
+import lsp_boot.utility;
+import bench_support;
+
+namespace
+{
+	// Typical editing session: didChange notifications interleaved with position based requests, with an occasional full content sync.
+	auto generate_session(std::size_t const message_count, std::size_t const large_content_bytes)
+	{
+		auto text = std::string{};
+		while (text.size() < large_content_bytes)
+		{
+			text += "\tauto value = compute(\"input\", 42);\n";
+		}
+
+		auto session = std::string{};
+		for (std::size_t i = 0; i < message_count; ++i)
+		{
+			auto const position = boost::json::object{ { "line", i % 1000 }, { "character", 4 } };
+			if (i % 50 == 0)
+			{
+				session += format_message(boost::json::object{
+					{ "jsonrpc", "2.0" },
+					{ "method", "textDocument/didChange" },
+					{ "params", boost::json::object{
+						{ "textDocument", boost::json::object{ { "uri", "file:///bench.cpp" }, { "version", i } } },
+						{ "contentChanges", boost::json::array{ boost::json::object{ { "text", text } } } },
+						} },
+					});
+			}
+			else if (i % 2 == 0)
+			{
+				session += format_message(boost::json::object{
+					{ "jsonrpc", "2.0" },
+					{ "method", "textDocument/didChange" },
+					{ "params", boost::json::object{
+						{ "textDocument", boost::json::object{ { "uri", "file:///bench.cpp" }, { "version", i } } },
+						{ "contentChanges", boost::json::array{ boost::json::object{
+							{ "range", boost::json::object{ { "start", position }, { "end", position } } },
+							{ "rangeLength", 0 },
+							{ "text", "x" },
+							} } },
+						} },
+					});
+			}
+			else
+			{
+				session += format_message(boost::json::object{
+					{ "jsonrpc", "2.0" },
+					{ "id", i },
+					{ "method", "textDocument/inlayHint" },
+					{ "params", boost::json::object{
+						{ "textDocument", boost::json::object{ { "uri", "file:///bench.cpp" } } },
+						{ "range", boost::json::object{ { "start", position }, { "end", position } } },
+						} },
+					});
+			}
+		}
+		return session;
+	}
+
+	// Resident set size in bytes, where available.
+	auto resident_set_size() -> std::size_t
+	{
+#if defined(__linux__)
+		auto statm = std::ifstream("/proc/self/statm");
+		std::size_t total_pages = 0;
+		std::size_t resident_pages = 0;
+		statm >> total_pages >> resident_pages;
+		return resident_pages * std::size_t(::sysconf(_SC_PAGESIZE));
+#else
+		return 0;
+#endif
+	}
+
+	struct BenchResult
+	{
+		std::chrono::duration< double > elapsed;
+		std::uint64_t allocations;
+		std::uint64_t bytes;
+		std::size_t rss;
+	};
+
+	auto run_bench(std::filesystem::path const& session_path, std::size_t const message_count, lsp_boot::MessageArenaPool* const arena_pool) -> BenchResult
+	{
+		auto input_queue = lsp_boot::PendingInputQueue{};
+		auto output_queue = lsp_boot::OutputQueue{};
+		auto error = std::ostringstream{};
+
+#if defined(_WIN32)
+		auto const fd = ::_open(session_path.string().c_str(), _O_RDONLY | _O_BINARY);
+#else
+		auto const fd = ::open(session_path.c_str(), O_RDONLY);
+#endif
+		assert(fd >= 0);
+
+		auto const start_allocations = allocation_count();
+		auto const start_bytes = allocated_bytes();
+		auto const start = std::chrono::steady_clock::now();
+		{
+			auto consumer = lsp_boot::Thread([&] {
+				for (std::size_t received = 0; received < message_count; ++received)
+				{
+					auto msg = input_queue.pop();
+					assert(msg.msg.contains("method"));
+				}
+				});
+
+			auto const result = lsp_boot::FdConnection(input_queue, output_queue, fd, -1, error, lsp_boot::MessageReader::default_buffer_size, {}, {
+				.arena_pool = arena_pool,
+				}).listen();
+			assert(result == 0);
+		}
+		auto const elapsed = std::chrono::steady_clock::now() - start;
+
+#if defined(_WIN32)
+		::_close(fd);
+#else
+		::close(fd);
+#endif
+		return {
+			elapsed,
+			allocation_count() - start_allocations,
+			allocated_bytes() - start_bytes,
+			resident_set_size(),
+		};
+	}
+
+	auto report(std::string_view const name, BenchResult const& result, std::size_t const message_count)
+	{
+		std::cout << std::format("{:>14}: {:8.1f} ms, {:8.1f} allocations/msg, {:10.0f} bytes/msg, RSS after {:8.1f} MB",
+			name,
+			result.elapsed.count() * 1000.0,
+			double(result.allocations) / message_count,
+			double(result.bytes) / message_count,
+			result.rss / (1024.0 * 1024.0)) << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto const message_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000ull;
+	auto const large_content_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 16ull * 1024;
+
+	auto const session_path = std::filesystem::temp_directory_path() / "lsp-boot-arena-bench.bin";
+	auto session_bytes = std::size_t{ 0 };
+	{
+		auto const session = generate_session(message_count, large_content_bytes);
+		session_bytes = session.size();
+		auto file = std::ofstream(session_path, std::ios::binary);
+		file.write(session.data(), session.size());
+	}
+
+	auto const rss_before = resident_set_size();
+	auto const heap_result = run_bench(session_path, message_count, nullptr);
+
+	auto arena_pool = lsp_boot::MessageArenaPool{};
+	auto const arena_result = run_bench(session_path, message_count, &arena_pool);
+
+	std::filesystem::remove(session_path);
+
+	std::cout << std::format("{} messages, {:.1f} MB, RSS before {:.1f} MB", message_count, session_bytes / (1024.0 * 1024.0), rss_before / (1024.0 * 1024.0)) << std::endl;
+	report("heap storage", heap_result, message_count);
+	report("arena pool", arena_result, message_count);
+	std::cout << std::format("{:>14}: {} created, {} reused", "arenas", arena_pool.arenas_created(), arena_pool.arenas_reused()) << std::endl;
+
+	assert(arena_result.allocations < heap_result.allocations);
+
+	return 0;
+}
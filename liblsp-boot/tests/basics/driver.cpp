@@ -1,6 +1,13 @@
 
 #include <liblsp-boot/version.hpp>
 
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include <cstdint>
 #include <string_view>
 #include <sstream>
 #include <format>
@@ -8,7 +15,17 @@
 #include <memory>
 #include <future>
 #include <thread>
+#include <mutex>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <span>
+#include <random>
 
 #undef NDEBUG
 #include <cassert>
@@ -16,6 +33,7 @@
 import lsp_boot;
 import lsp_boot.ext_mod_wrap.boost.json;
 import lsp_boot.utility;
+import lsp_boot.response_cache;
 import example_impl;
 
 using namespace std::string_view_literals;
@@ -29,37 +47,201 @@ auto format_message(boost::json::value const& js)
 	return std::format("Content-Length: {}\r\n\r\n{}", content.length(), content);
 }
 
-auto format_request(std::string_view const method, std::optional< boost::json::value > const& params = std::nullopt)
+auto make_request(std::string_view const method, std::optional< boost::json::value > const& params = std::nullopt)
 {
-	return format_message(boost::json::object{
+	return boost::json::object{
 		{ "jsonrpc", "2.0" },
 		{ "id", message_counter++ },
 		{ "method", method },
 		{ "params", params.value_or(boost::json::object{}) },
-		});
+		};
 }
 
-auto format_notification(std::string_view const method, std::optional< boost::json::value > const& params = std::nullopt)
+auto make_notification(std::string_view const method, std::optional< boost::json::value > const& params = std::nullopt)
 {
-	return format_message(boost::json::object{
+	return boost::json::object{
 		{ "jsonrpc", "2.0" },
 		{ "method", method },
 		{ "params", params.value_or(boost::json::object{}) },
+		};
+}
+
+auto format_request(std::string_view const method, std::optional< boost::json::value > const& params = std::nullopt)
+{
+	return format_message(make_request(method, params));
+}
+
+auto format_notification(std::string_view const method, std::optional< boost::json::value > const& params = std::nullopt)
+{
+	return format_message(make_notification(method, params));
+}
+
+auto make_did_open(std::string_view const uri, std::string_view const text)
+{
+	return make_notification("textDocument/didOpen", boost::json::object{
+		{ "textDocument", boost::json::object{
+			{ "uri", uri },
+			{ "languageId", "plaintext" },
+			{ "version", 1 },
+			{ "text", text },
+			} },
 		});
 }
 
-int main ()
+/**
+ * Runs a server on the calling thread over input queued in full ahead of it starting, so that all of it is in the server's backlog
+ * when it makes its scheduling decisions. Input is stamped as received input_age ago.
+ * Returns the messages output, in order (without integer array fields). inspect is called with the server once it has exited.
+ */
+template < typename Impl = ExampleImpl >
+auto run_queued_session(
+	std::vector< boost::json::object > input,
+	lsp_boot::ServerOptions const& options = {},
+	std::function< void(lsp_boot::Server&) > const& inspect = {},
+	std::chrono::milliseconds const input_age = 0ms) -> std::vector< boost::json::object >
+{
+	auto input_queue = lsp_boot::PendingInputQueue{};
+	auto output_queue = lsp_boot::OutputQueue{};
+
+	auto const received = std::chrono::system_clock::now() - input_age;
+	for (auto& msg : input)
+	{
+		input_queue.push(lsp_boot::ReceivedMessage{ .msg = std::move(msg), .received_time = received });
+	}
+
+	{
+		auto server = lsp_boot::Server(input_queue, output_queue, [](auto&& api) {
+			return std::make_unique< Impl >(api);
+			}, {}, {}, options);
+		server.run();
+		if (inspect)
+		{
+			inspect(server);
+		}
+	}
+
+	auto output = std::vector< boost::json::object >{};
+	while (auto msg = output_queue.try_pop())
+	{
+		output.push_back(std::move(msg->content));
+	}
+	return output;
+}
+
+// Position in output of the response to request, or output.size() if there is none.
+auto find_response(std::vector< boost::json::object > const& output, boost::json::object const& request) -> std::size_t
+{
+	auto const it = std::ranges::find_if(output, [&](boost::json::object const& msg) {
+		return !msg.contains("method") && msg.contains("id") && msg.at("id") == request.at("id");
+		});
+	return std::size_t(it - output.begin());
+}
+
+auto response_result(std::vector< boost::json::object > const& output, boost::json::object const& request) -> boost::json::value const&
+{
+	auto const index = find_response(output, request);
+	assert(index < output.size() && output[index].contains("result"));
+	return output[index].at("result");
+}
+
+auto run_session(lsp_boot::ServerOptions const options, lsp_boot::LoggingSink logging_sink = {}, lsp_boot::SessionTraceWriter* const trace = nullptr) -> std::string
 {
 	std::stringstream in, out;
 
 	in << format_request("initialize", boost::json::object{
 		{ "processId", nullptr },
 		{ "rootUri", nullptr },
-		{ "capabilities", boost::json::object{} },
+		{ "capabilities", boost::json::object{
+			{ "window", boost::json::object{ { "workDoneProgress", true } } },
+			} },
+		});
+
+	// Accepting the progress token for the background job started on initialize
+	in << format_message(boost::json::object{
+		{ "jsonrpc", "2.0" },
+		{ "id", "lsp-boot/background/1" },
+		{ "result", nullptr },
 		});
 
 	// @todo: some basic response checking
 
+	in << format_notification("textDocument/didOpen", boost::json::object{
+		{ "textDocument", boost::json::object{
+			{ "uri", "file:///example.txt" },
+			{ "languageId", "plaintext" },
+			{ "version", 1 },
+			{ "text", "first line\nhello world\n" },
+			} },
+		});
+
+	// Consecutive changes, as when typing (candidates for coalescing)
+	in << format_notification("textDocument/didChange", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" }, { "version", 2 } } },
+		{ "contentChanges", boost::json::array{
+			boost::json::object{
+				{ "range", boost::json::object{
+					{ "start", boost::json::object{ { "line", 1 }, { "character", 6 } } },
+					{ "end", boost::json::object{ { "line", 1 }, { "character", 6 } } },
+					} },
+				{ "text", "brav" },
+				},
+			} },
+		});
+
+	in << format_notification("textDocument/didChange", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" }, { "version", 3 } } },
+		{ "contentChanges", boost::json::array{
+			boost::json::object{
+				{ "range", boost::json::object{
+					{ "start", boost::json::object{ { "line", 1 }, { "character", 10 } } },
+					{ "end", boost::json::object{ { "line", 1 }, { "character", 10 } } },
+					} },
+				{ "text", "e " },
+				},
+			} },
+		});
+
+	// Repeated, as by a client on a focus change (a candidate for the response cache)
+	for (auto repeat = 0; repeat < 2; ++repeat)
+	{
+		in << format_request("textDocument/hover", boost::json::object{
+			{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" } } },
+			{ "position", boost::json::object{ { "line", 1 }, { "character", 0 } } },
+			});
+	}
+
+	// Symbols streamed as partial results, with work done progress
+	in << format_request("textDocument/documentSymbol", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" } } },
+		{ "partialResultToken", "symbols-1" },
+		{ "workDoneToken", "work-1" },
+		});
+
+	in << format_request("textDocument/semanticTokens/full", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" } } },
+		});
+
+	in << format_notification("textDocument/didChange", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" }, { "version", 4 } } },
+		{ "contentChanges", boost::json::array{
+			boost::json::object{
+				{ "range", boost::json::object{
+					{ "start", boost::json::object{ { "line", 0 }, { "character", 0 } } },
+					{ "end", boost::json::object{ { "line", 0 }, { "character", 5 } } },
+					} },
+				{ "text", "1st" },
+				},
+			} },
+		});
+
+	// First result id assigned by the server is "1"
+	in << format_request("textDocument/semanticTokens/full/delta", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" } } },
+		{ "previousResultId", "1" },
+		});
+
+	in << format_request("$/lsp-boot/metrics");
+
 	in << format_request("shutdown");
 
 	in << format_notification("exit");
@@ -72,13 +254,21 @@ int main ()
 			return std::make_unique< ExampleImpl >(send_notify);
 			};
 
-		auto server = lsp_boot::Server(input_queue, output_queue, server_impl_init);
+		auto server = lsp_boot::Server(input_queue, output_queue, server_impl_init, logging_sink, {}, options);
 		auto server_thread = lsp_boot::Thread([&] {
 			server.run();
 			std::cerr << "Server execution completed." << std::endl;
 			});
 
-		auto connection = lsp_boot::StreamConnection(input_queue, output_queue, in, out, std::cerr);
+		auto connection = lsp_boot::StreamConnection(input_queue, output_queue, in, out, std::cerr, {
+			.metrics = &server.metrics_registry().output(),
+			}, {
+			.arena_pool = options.arena_pool,
+			});
+		if (trace != nullptr)
+		{
+			connection.record_to(*trace);
+		}
 		auto const result = connection.listen();
 		std::cerr << "StreamConnection completed." << std::endl;
 		assert(result == 0);
@@ -102,5 +292,1003 @@ int main ()
 	// Server should have exited
 	assert(server_fut.wait_for(0ms) == std::future_status::ready);
 
+	// Hover response reflects the incremental edit applied by the server's document store
+	assert(out.str().find("hello brave world") != std::string::npos);
+
+	// Delta support advertised on behalf of the implementation, full token data written alongside the DOM based part of the result,
+	// and only the changed token length sent in response to the delta request
+	assert(out.str().find("\"full\":{\"delta\":true}") != std::string::npos);
+	assert(out.str().find("\"result\":{\"resultId\":\"1\",\"data\":[0,0,10,0,0,1,0,17,0,0]}}") != std::string::npos);
+	assert(out.str().find("\"edits\":[{\"start\":2,\"deleteCount\":1,\"data\":[8]}],\"resultId\":\"2\"") != std::string::npos);
+
+	// A chunk per line streamed ahead of an empty final result, with work done progress ended by the framework
+	assert(out.str().find("{\"jsonrpc\":\"2.0\",\"method\":\"$/progress\",\"params\":{\"token\":\"symbols-1\",\"value\":[{\"name\":\"hello brave world\"") != std::string::npos);
+	assert(out.str().find("\"params\":{\"token\":\"work-1\",\"value\":{\"kind\":\"begin\",\"percentage\":0,\"title\":\"Collecting symbols\"}}") != std::string::npos);
+	assert(out.str().find("\"params\":{\"token\":\"work-1\",\"value\":{\"kind\":\"end\"}}") < out.str().find("\"result\":[]"));
+	assert(out.str().find("\"result\":[]") != std::string::npos);
+
+	// Background job started on initialize, with its progress token created by the server, and progress begun once the client accepted it
+	assert(out.str().find("\"id\":\"lsp-boot/background/1\",\"method\":\"window/workDoneProgress/create\"") != std::string::npos);
+	assert(out.str().find("\"params\":{\"token\":\"lsp-boot/background/1\",\"value\":{\"kind\":\"begin\",\"percentage\":") != std::string::npos);
+	assert(out.str().find("\"title\":\"Indexing\"") != std::string::npos);
+
+	// Metrics response includes the hover request's handler timings
+	assert(out.str().find("\"textDocument/hover\":{\"size_bytes\"") != std::string::npos);
+	assert(out.str().find("handler_us") != std::string::npos);
+
+	return out.str();
+}
+
+auto make_insertion(std::string_view const uri, int const version, unsigned const line, unsigned const character, std::string_view const text)
+{
+	auto const position = boost::json::object{ { "line", line }, { "character", character } };
+	return make_notification("textDocument/didChange", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", uri }, { "version", version } } },
+		{ "contentChanges", boost::json::array{
+			boost::json::object{
+				{ "range", boost::json::object{ { "start", position }, { "end", position } } },
+				{ "text", text },
+				},
+			} },
+		});
+}
+
+auto make_hover(std::string_view const uri, unsigned const line)
+{
+	return make_request("textDocument/hover", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", uri } } },
+		{ "position", boost::json::object{ { "line", line }, { "character", 0 } } },
+		});
+}
+
+// Consecutive didChange notifications already queued are folded into one, with the edits still applied in order
+auto run_coalescing_session()
+{
+	auto const hover = make_hover("file:///example.txt", 0);
+	auto coalesced = std::uint64_t{ 0 };
+	auto const output = run_queued_session({
+		make_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } }),
+		make_did_open("file:///example.txt", "hello world"),
+		make_insertion("file:///example.txt", 2, 0, 6, "b"),
+		make_insertion("file:///example.txt", 3, 0, 7, "rav"),
+		make_insertion("file:///example.txt", 4, 0, 10, "e "),
+		hover,
+		make_request("shutdown"),
+		make_notification("exit"),
+		}, { .coalesce_document_changes = true }, [&](lsp_boot::Server& server) {
+		coalesced = server.metrics_registry().coalesced_changes().load();
+		});
+
+	assert(coalesced == 2);
+	assert(response_result(output, hover).at("contents") == "hello brave world");
+}
+
+auto make_document_symbols(std::string_view const uri)
+{
+	return make_request("textDocument/documentSymbol", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", uri } } },
+		});
+}
+
+// An interactive request queued behind a bulk request for the same document is answered first
+auto run_prioritized_session()
+{
+	auto const symbols = make_document_symbols("file:///example.txt");
+	auto const hover = make_hover("file:///example.txt", 0);
+	auto const input = std::vector< boost::json::object >{
+		make_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } }),
+		make_did_open("file:///example.txt", "hello world"),
+		symbols,
+		hover,
+		make_request("shutdown"),
+		make_notification("exit"),
+		};
+
+	auto const prioritized = run_queued_session(input, { .prioritize_input = true });
+	assert(find_response(prioritized, hover) < find_response(prioritized, symbols));
+	assert(find_response(prioritized, symbols) < prioritized.size());
+
+	// Dispatched in order of arrival otherwise
+	auto const in_order = run_queued_session(input);
+	assert(find_response(in_order, symbols) < find_response(in_order, hover));
+}
+
+// A request which has waited past its deadline is answered with ServerCancelled rather than dispatched
+auto run_deadline_session()
+{
+	auto const hover = make_hover("file:///example.txt", 0);
+	auto stale = std::uint64_t{ 0 };
+	auto const output = run_queued_session({
+		make_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } }),
+		make_did_open("file:///example.txt", "hello world"),
+		hover,
+		make_request("shutdown"),
+		make_notification("exit"),
+		}, {
+			.request_schedule = [](lsp_boot::lsp::requests::Kinds const kind) {
+				return kind == lsp_boot::lsp::requests::Kinds::hover ? lsp_boot::RequestSchedule{ .deadline = 1ms } : lsp_boot::RequestSchedule{};
+				},
+		}, [&](lsp_boot::Server& server) {
+		stale = server.metrics_registry().stale_requests().load();
+		}, 1s);
+
+	auto const index = find_response(output, hover);
+	assert(index < output.size());
+	assert(output[index].at("error").at("code") == -32802);
+	assert(stale == 1);
+}
+
+// Diagnostics sent on the implementation's behalf: unchanged sets suppressed, rapid updates collapsed to the last, and max_delay bounding how long
+// updates are held back
+auto run_diagnostics_publisher()
+{
+	constexpr auto uri = "file:///example.txt"sv;
+	auto const diagnostic = [](std::string_view const message) {
+		return lsp_boot::lsp::Diagnostic{ .range = { { 0, 0 }, { 0, 5 } }, .message = std::string{ message } };
+		};
+	// Waits for count notifications to be sent, returning the first diagnostic's message from each.
+	auto const receive = [](lsp_boot::OutputQueue& queue, std::size_t const count) {
+		auto messages = std::vector< std::string >{};
+		for (int attempt = 0; messages.size() < count; ++attempt)
+		{
+			if (auto msg = queue.try_pop())
+			{
+				auto const& diagnostics = msg->content.at("params").at("diagnostics").as_array();
+				messages.emplace_back(diagnostics.empty() ? ""sv : std::string_view{ diagnostics.front().at("message").as_string() });
+				continue;
+			}
+			assert(attempt < 250);
+			std::this_thread::sleep_for(20ms);
+		}
+		return messages;
+		};
+
+	// A set identical to that last sent is suppressed, until the document's state is forgotten (on close)
+	{
+		auto queue = lsp_boot::OutputQueue{};
+		auto publisher = lsp_boot::DiagnosticsPublisher(queue, { .debounce = 0ms });
+		publisher.publish(uri, 1, { diagnostic("unused variable") });
+		assert(receive(queue, 1) == std::vector< std::string >{ "unused variable" });
+		publisher.publish(uri, 2, { diagnostic("unused variable") });
+		assert(publisher.suppressed_count() == 1);
+
+		publisher.forget(uri);
+		publisher.publish(uri, 1, { diagnostic("unused variable") });
+		assert(receive(queue, 1) == std::vector< std::string >{ "unused variable" });
+		assert(publisher.published_count() == 2);
+	}
+
+	// Updates in quick succession are collapsed into a single notification of the last set
+	{
+		auto queue = lsp_boot::OutputQueue{};
+		auto publisher = lsp_boot::DiagnosticsPublisher(queue, { .debounce = 200ms, .max_delay = 10s });
+		for (auto const message : { "first", "second", "third" })
+		{
+			publisher.publish(uri, 1, { diagnostic(message) });
+		}
+		assert(receive(queue, 1) == std::vector< std::string >{ "third" });
+		assert(publisher.suppressed_count() == 2);
+		std::this_thread::sleep_for(300ms);
+		assert(!queue.try_pop().has_value());
+	}
+
+	// Held back by the debounce alone, an update would not be sent within the wait allowed by receive
+	{
+		auto queue = lsp_boot::OutputQueue{};
+		auto publisher = lsp_boot::DiagnosticsPublisher(queue, { .debounce = 60s, .max_delay = 50ms });
+		publisher.publish(uri, 1, { diagnostic("first") });
+		publisher.publish(uri, 1, { diagnostic("second") });
+		assert(receive(queue, 1) == std::vector< std::string >{ "second" });
+	}
+
+	// All members are sent, with integer and string codes distinct from one another
+	{
+		namespace lsp = lsp_boot::lsp;
+		auto full = lsp::Diagnostic{
+			.range = { { 1, 2 }, { 1, 8 } },
+			.severity = lsp::ds_warning,
+			.message = "unused variable 'x'",
+			.source = "example",
+			.code = 1001,
+			.code_description = "https://example.com/1001",
+			.tags = { lsp::dt_unnecessary },
+			.related_information = { { .uri = std::string{ uri }, .range = { { 0, 0 }, { 0, 3 } }, .message = "declared here" } },
+			.data = boost::json::object{ { "fix", "remove" } },
+			};
+		assert(boost::json::value(full) == boost::json::parse(R"({
+			"range":{"start":{"line":1,"character":2},"end":{"line":1,"character":8}},
+			"severity":2,
+			"message":"unused variable 'x'",
+			"source":"example",
+			"code":1001,
+			"codeDescription":{"href":"https://example.com/1001"},
+			"tags":[1],
+			"relatedInformation":[{"location":{"uri":"file:///example.txt","range":{"start":{"line":0,"character":0},"end":{"line":0,"character":3}}},"message":"declared here"}],
+			"data":{"fix":"remove"}
+			})"));
+		assert(boost::json::value(diagnostic("minimal")) == boost::json::parse(R"({
+			"range":{"start":{"line":0,"character":0},"end":{"line":0,"character":5}},
+			"severity":1,
+			"message":"minimal"
+			})"));
+
+		auto queue = lsp_boot::OutputQueue{};
+		auto publisher = lsp_boot::DiagnosticsPublisher(queue, { .debounce = 0ms });
+		publisher.publish(uri, 1, { full });
+		assert(receive(queue, 1) == std::vector< std::string >{ "unused variable 'x'" });
+		full.code = "1001";
+		publisher.publish(uri, 2, { full });
+		assert(receive(queue, 1) == std::vector< std::string >{ "unused variable 'x'" });
+		assert(publisher.suppressed_count() == 0);
+	}
+}
+
+// Waits for condition to hold, failing if it doesn't within a few seconds.
+auto wait_until(std::function< bool() > const& condition)
+{
+	for (int attempt = 0; !condition(); ++attempt)
+	{
+		assert(attempt < 250);
+		std::this_thread::sleep_for(20ms);
+	}
+}
+
+auto run_work_stealing_pool()
+{
+	// Tasks queued behind a busy worker are started highest priority first
+	{
+		auto release = std::promise< void >{};
+		auto pool = lsp_boot::WorkStealingPool(1);
+		auto started = std::atomic< bool >{ false };
+		pool.submit([&started, released = release.get_future().share()] {
+			started = true;
+			released.wait();
+			});
+		wait_until([&] { return started.load(); });
+
+		auto mtx = std::mutex{};
+		auto order = std::vector< std::string >{};
+		auto const record = [&](std::string name) {
+			return [&mtx, &order, name = std::move(name)] {
+				auto lock = std::scoped_lock{ mtx };
+				order.push_back(name);
+				};
+			};
+		pool.submit(record("low"), lsp_boot::TaskPriority::low);
+		pool.submit(record("normal"));
+		pool.submit(record("high"), lsp_boot::TaskPriority::high);
+		release.set_value();
+		wait_until([&] {
+			auto lock = std::scoped_lock{ mtx };
+			return order.size() == 3;
+			});
+		assert((order == std::vector< std::string >{ "high", "normal", "low" }));
+	}
+
+	// Low priority tasks are held back while in the foreground, others aren't
+	{
+		auto pool = lsp_boot::WorkStealingPool(1);
+		auto low_done = std::atomic< bool >{ false };
+		auto normal_done = std::atomic< bool >{ false };
+		pool.enter_foreground();
+		assert(pool.foreground_busy());
+		pool.submit([&] { low_done = true; }, lsp_boot::TaskPriority::low);
+		pool.submit([&] { normal_done = true; });
+		wait_until([&] { return normal_done.load(); });
+		std::this_thread::sleep_for(100ms);
+		assert(!low_done);
+
+		pool.leave_foreground();
+		assert(!pool.foreground_busy());
+		wait_until([&] { return low_done.load(); });
+	}
+}
+
+auto run_background_scheduler()
+{
+	using Context = lsp_boot::BackgroundTaskContext;
+	constexpr auto uri = "file:///example.txt"sv;
+	auto const no_errors = [](std::string_view) {
+		assert(false);
+		};
+
+	// A task tied to a document is skipped if the document changes before the task starts
+	{
+		auto output_queue = lsp_boot::OutputQueue{};
+		auto release = std::promise< void >{};
+		auto scheduler = lsp_boot::BackgroundScheduler(1, output_queue, no_errors);
+		auto started = std::atomic< bool >{ false };
+		scheduler.submit([&started, released = release.get_future().share()](Context const&) {
+			started = true;
+			released.wait();
+			});
+		wait_until([&] { return started.load(); });
+
+		auto document_task_ran = std::atomic< bool >{ false };
+		auto later_task_ran = std::atomic< bool >{ false };
+		scheduler.submit([&](Context const&) { document_task_ran = true; }, { .document = std::string{ uri } });
+		scheduler.cancel_document(uri);
+		// At lower priority, so only started once the document's task has been taken
+		scheduler.submit([&](Context const&) { later_task_ran = true; }, { .priority = lsp_boot::TaskPriority::low });
+		release.set_value();
+		wait_until([&] { return later_task_ran.load(); });
+		assert(!document_task_ran);
+	}
+
+	// A running task sees the cancellation, while one submitted for the document afterwards is unaffected
+	{
+		auto output_queue = lsp_boot::OutputQueue{};
+		auto scheduler = lsp_boot::BackgroundScheduler(1, output_queue, no_errors);
+		auto started = std::atomic< bool >{ false };
+		auto cancelled = std::atomic< bool >{ false };
+		scheduler.submit([&](Context const& context) {
+			started = true;
+			while (!context.is_cancelled())
+			{
+				std::this_thread::sleep_for(1ms);
+			}
+			cancelled = true;
+			}, { .document = std::string{ uri } });
+		wait_until([&] { return started.load(); });
+		scheduler.cancel_document(uri);
+		wait_until([&] { return cancelled.load(); });
+
+		auto resubmitted_ran = std::atomic< bool >{ false };
+		scheduler.submit([&](Context const& context) { resubmitted_ran = !context.is_cancelled(); }, { .document = std::string{ uri } });
+		wait_until([&] { return resubmitted_ran.load(); });
+	}
+
+	// Tasks are asked to yield while a request is being handled
+	{
+		auto output_queue = lsp_boot::OutputQueue{};
+		auto scheduler = lsp_boot::BackgroundScheduler(1, output_queue, no_errors);
+		auto should_yield = std::atomic< int >{ -1 };
+		auto const submit_probe = [&] {
+			should_yield = -1;
+			scheduler.submit([&](Context const& context) { should_yield = context.should_yield() ? 1 : 0; });
+			wait_until([&] { return should_yield.load() != -1; });
+			return should_yield.load() == 1;
+			};
+		scheduler.enter_foreground();
+		assert(submit_probe());
+		scheduler.leave_foreground();
+		assert(!submit_probe());
+	}
+
+	// Returns the kinds of the $/progress notifications output
+	auto const progress_kinds = [](lsp_boot::OutputQueue& queue) {
+		auto kinds = std::vector< std::string >{};
+		while (auto msg = queue.try_pop())
+		{
+			assert(msg->content.at("method").as_string() == "$/progress");
+			kinds.emplace_back(msg->content.at("params").at("value").at("kind").as_string());
+		}
+		return kinds;
+		};
+	// Id of the window/workDoneProgress/create request made on starting a job
+	auto const progress_request_id = [](lsp_boot::OutputQueue& queue) {
+		auto const msg = queue.try_pop();
+		assert(msg.has_value() && msg->content.at("method").as_string() == "window/workDoneProgress/create");
+		return std::string{ msg->content.at("id").as_string() };
+		};
+
+	// Job progress begins once the client accepts the token, and ends after the job is finished
+	{
+		auto output_queue = lsp_boot::OutputQueue{};
+		auto scheduler = lsp_boot::BackgroundScheduler(0, output_queue, no_errors);
+		scheduler.enable_progress(true);
+		auto job = scheduler.start_job("Indexing");
+		auto const id = progress_request_id(output_queue);
+		assert(progress_kinds(output_queue).empty());
+		assert(scheduler.handle_progress_response(id, true));
+		assert(!scheduler.handle_progress_response(id, true));
+		assert(!scheduler.handle_progress_response("unknown", true));
+
+		// Run synchronously: completion of the first task reports 100%, which submitting the second can't take back
+		job.submit([](Context const&) {});
+		job.submit([](Context const&) {});
+		job.finish();
+		assert((progress_kinds(output_queue) == std::vector< std::string >{ "begin", "report", "end" }));
+	}
+
+	// Nothing is reported if the client rejects the token
+	{
+		auto output_queue = lsp_boot::OutputQueue{};
+		auto scheduler = lsp_boot::BackgroundScheduler(0, output_queue, no_errors);
+		scheduler.enable_progress(true);
+		auto job = scheduler.start_job("Indexing");
+		assert(scheduler.handle_progress_response(progress_request_id(output_queue), false));
+		job.submit([](Context const&) {});
+		job.finish();
+		assert(progress_kinds(output_queue).empty());
+	}
+}
+
+auto make_cancellation(boost::json::object const& request)
+{
+	return make_notification("$/cancelRequest", boost::json::object{ { "id", request.at("id") } });
+}
+
+// A request cancelled while still queued is answered as cancelled, without reaching the implementation
+auto run_queued_cancellation(lsp_boot::ServerOptions const& options)
+{
+	constexpr auto uri = "file:///example.txt"sv;
+	auto const hovers_started = CancellableImpl::hovers_started.load();
+	auto const hover = make_hover(uri, 0);
+	auto const output = run_queued_session< CancellableImpl >({
+		make_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } }),
+		make_did_open(uri, "hello world\n"),
+		hover,
+		make_cancellation(hover),
+		make_request("shutdown"),
+		make_notification("exit"),
+		}, options);
+
+	auto const index = find_response(output, hover);
+	assert(index < output.size() && output[index].at("error").at("code") == lsp_boot::lsp::error_codes::request_cancelled);
+	assert(CancellableImpl::hovers_started == hovers_started);
+}
+
+// A running handler sees its cancellation token flip. In synchronous mode, the check of the token polls for the cancellation;
+// with request workers, it's applied while the dispatching thread waits for the request to complete ahead of a didChange for the document.
+auto run_running_cancellation(lsp_boot::ServerOptions const& options)
+{
+	constexpr auto uri = "file:///example.txt"sv;
+	auto input_queue = lsp_boot::PendingInputQueue{};
+	auto output_queue = lsp_boot::OutputQueue{};
+	auto const push = [&](boost::json::object msg) {
+		input_queue.push(lsp_boot::ReceivedMessage{ .msg = std::move(msg), .received_time = std::chrono::system_clock::now() });
+		};
+
+	auto const hovers_started = CancellableImpl::hovers_started.load();
+	auto const hover = make_hover(uri, 0);
+	{
+		auto server = lsp_boot::Server(input_queue, output_queue, [](auto&& api) {
+			return std::make_unique< CancellableImpl >(api);
+			}, {}, {}, options);
+		auto server_thread = std::thread([&] {
+			server.run();
+			});
+
+		push(make_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } }));
+		push(make_did_open(uri, "hello world\n"));
+		push(hover);
+		push(make_insertion(uri, 2, 0, 0, "x"));
+		wait_until([&] { return CancellableImpl::hovers_started > hovers_started; });
+		push(make_cancellation(hover));
+		push(make_request("shutdown"));
+		push(make_notification("exit"));
+		server_thread.join();
+	}
+
+	auto output = std::vector< boost::json::object >{};
+	while (auto msg = output_queue.try_pop())
+	{
+		output.push_back(std::move(msg->content));
+	}
+	auto const index = find_response(output, hover);
+	assert(index < output.size() && output[index].at("error").at("message").as_string() == "Hover cancelled");
+}
+
+// An edit to the document means a miss for a request repeated afterwards, rather than a stale response
+auto run_response_cache_session()
+{
+	auto const hover_before = make_hover("file:///example.txt", 0);
+	auto const hover_repeated = make_hover("file:///example.txt", 0);
+	auto const hover_after = make_hover("file:///example.txt", 0);
+	auto hits = std::uint64_t{ 0 };
+	auto misses = std::uint64_t{ 0 };
+	auto const output = run_queued_session({
+		make_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } }),
+		make_did_open("file:///example.txt", "hello world"),
+		hover_before,
+		hover_repeated,
+		make_insertion("file:///example.txt", 2, 0, 6, "brave "),
+		hover_after,
+		make_request("shutdown"),
+		make_notification("exit"),
+		}, { .response_cache_bytes = 64 * 1024 }, [&](lsp_boot::Server& server) {
+		hits = server.metrics_registry().response_cache_hits().load();
+		misses = server.metrics_registry().response_cache_misses().load();
+		});
+
+	assert(response_result(output, hover_repeated).at("contents") == "hello world");
+	assert(response_result(output, hover_after).at("contents") == "hello brave world");
+	assert(hits == 1 && misses == 2);
+}
+
+// Least recently used entries evicted to keep within the budget
+auto run_response_cache_eviction()
+{
+	constexpr auto uri = "file:///example.txt"sv;
+	auto const key_for = [&](unsigned const line) {
+		return lsp_boot::ResponseCache::make_key("textDocument/hover", uri, 1, make_hover(uri, line));
+		};
+	auto const response = boost::json::value{ { "contents", "hello world" } };
+
+	// Entries for different lines are of the same size
+	auto const entry_size = [&] {
+		auto cache = lsp_boot::ResponseCache(64 * 1024);
+		cache.insert(key_for(0), response, {});
+		return cache.size_bytes();
+		}();
+	assert(entry_size > 0);
+
+	// Room for one entry only
+	{
+		auto cache = lsp_boot::ResponseCache(entry_size + entry_size / 2);
+		cache.insert(key_for(0), response, {});
+		cache.insert(key_for(1), response, {});
+		assert(!cache.find(key_for(0)).has_value());
+		assert(cache.find(key_for(1)).has_value());
+		assert(cache.size_bytes() == entry_size);
+	}
+
+	// Room for two, the entry found most recently being kept
+	{
+		auto cache = lsp_boot::ResponseCache(entry_size * 2 + entry_size / 2);
+		cache.insert(key_for(0), response, {});
+		cache.insert(key_for(1), response, {});
+		assert(cache.find(key_for(0)).has_value());
+		cache.insert(key_for(2), response, {});
+		assert(cache.find(key_for(0)).has_value());
+		assert(!cache.find(key_for(1)).has_value());
+		assert(cache.find(key_for(2)).has_value());
+	}
+
+	// A response exceeding the budget on its own is not cached
+	{
+		auto cache = lsp_boot::ResponseCache(entry_size - 1);
+		cache.insert(key_for(0), response, {});
+		assert(!cache.find(key_for(0)).has_value());
+		assert(cache.size_bytes() == 0);
+	}
+}
+
+// An implementation handling delta requests itself has its results passed through as returned
+auto run_impl_delta_session()
+{
+	auto const full = make_request("textDocument/semanticTokens/full", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" } } },
+		});
+	auto const delta = make_request("textDocument/semanticTokens/full/delta", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" } } },
+		{ "previousResultId", "impl-1" },
+		});
+	auto const output = run_queued_session< DeltaTokensImpl >({
+		make_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } }),
+		make_did_open("file:///example.txt", "hello world\n"),
+		full,
+		delta,
+		make_request("shutdown"),
+		make_notification("exit"),
+		});
+
+	assert(response_result(output, full) == boost::json::parse(R"({"resultId":"impl-1","data":[0,0,5,0,0]})"));
+	assert(response_result(output, delta) == boost::json::parse(R"({"resultId":"impl-2","edits":[{"start":2,"deleteCount":1,"data":[4]}]})"));
+}
+
+// Deferred results don't hold up the dispatch of further input, here including the notification completing them, and fail once abandoned
+auto run_deferred_session(lsp_boot::ServerOptions const& options)
+{
+	constexpr auto uri = "file:///example.txt"sv;
+	auto const hover = make_hover(uri, 0);
+	auto const symbols = make_document_symbols(uri);
+	auto const output = run_queued_session< DeferredResultsImpl >({
+		make_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } }),
+		make_did_open(uri, "hello world\n"),
+		hover,
+		symbols,
+		make_insertion(uri, 2, 0, 0, "x"),
+		make_request("shutdown"),
+		make_notification("exit"),
+		}, options);
+
+	assert(response_result(output, hover) == boost::json::parse(R"({"contents":"deferred"})"));
+	auto const symbols_response = find_response(output, symbols);
+	assert(symbols_response < find_response(output, hover));
+	assert(output[symbols_response].at("error").at("code") == lsp_boot::lsp::error_codes::internal_error);
+}
+
+// Integer array fields are written into the result wherever it is in the message, and reported if there's none
+auto run_output_writer_fields()
+{
+	auto const fields = [] {
+		return std::vector< lsp_boot::IntegerArrayField >{ { .key = "data", .values = { 1, 2, 3 } } };
+		};
+	auto serialize_metric = lsp_boot::Histogram{};
+	auto queue = lsp_boot::OutputQueue{};
+	auto first = lsp_boot::OutputMessage{ boost::json::object{ { "id", 1 }, { "result", boost::json::object{ { "resultId", "1" } } } }, fields() };
+	first.serialize_metric = &serialize_metric;
+	queue.push(std::move(first));
+	queue.push(lsp_boot::OutputMessage{ boost::json::object{ { "result", boost::json::object{} }, { "id", 2 } }, fields() });
+	queue.push(lsp_boot::OutputMessage{ boost::json::object{ { "id", 3 }, { "error", boost::json::object{ { "code", -32603 } } } }, fields() });
+
+	auto errors = std::vector< std::string >{};
+	auto writer = lsp_boot::BatchedOutputWriter({}, [&](std::string_view const message) {
+		errors.emplace_back(message);
+		});
+	// Already set, so that run just writes out what's queued
+	auto const shutdown = std::atomic< bool >{ true };
+	auto output = std::string{};
+	writer.run(queue, shutdown, [&](std::span< std::string_view const > const batch) {
+		for (auto const segment : batch)
+		{
+			output += segment;
+		}
+		});
+
+	assert(output.find("{\"id\":1,\"result\":{\"resultId\":\"1\",\"data\":[1,2,3]}}") != std::string::npos);
+	assert(output.find("{\"result\":{\"data\":[1,2,3]},\"id\":2}") != std::string::npos);
+	assert(output.find("{\"id\":3,\"error\":{\"code\":-32603}}") != std::string::npos);
+	assert(errors.size() == 1);
+	// Serialization time recorded against the message given a metric of its own
+	assert(serialize_metric.count() == 1);
+}
+
+// Edits of a rope spanning many chunks, including ones larger than a chunk and deletions across chunk boundaries, match those of a plain string
+auto run_text_rope()
+{
+	auto random = std::minstd_rand{ 42 };
+	auto const make_text = [&](std::size_t const length) {
+		auto text = std::string{};
+		while (text.size() < length)
+		{
+			text += std::format("line {}", random() % 1000);
+			text += random() % 4 == 0 ? "\r\n" : "\n";
+		}
+		text.resize(length);
+		return text;
+		};
+	auto const check = [](lsp_boot::TextRope const& rope, std::string const& model) {
+		assert(rope.size() == model.size());
+		assert(rope.str() == model);
+		assert(rope.line_count() == static_cast< std::size_t >(std::ranges::count(model, '\n')) + 1);
+		auto line = std::size_t{ 1 };
+		for (auto offset = model.find('\n'); offset != std::string::npos; offset = model.find('\n', offset + 1))
+		{
+			assert(rope.line_start(line++) == offset + 1);
+		}
+		assert(rope.line_start(line) == model.size());
+		};
+
+	auto model = make_text(5000);
+	auto rope = lsp_boot::TextRope{ model };
+	check(rope, model);
+
+	// Deleting across the boundary of the first chunk leaves the original untouched
+	auto const original = rope;
+	rope = rope.replace(1000, 100, "");
+	model.erase(1000, 100);
+	check(rope, model);
+	assert(original.size() == 5000);
+	assert(rope.substr(990, 20) == model.substr(990, 20));
+
+	for (auto i = 0; i < 200; ++i)
+	{
+		auto const offset = random() % (model.size() + 1);
+		auto const count = random() % 2000;
+		auto const text = make_text(random() % 1500);
+		rope = rope.replace(offset, count, text);
+		model.replace(offset, std::min< std::size_t >(count, model.size() - offset), text);
+		assert(rope.str() == model);
+		if (i % 20 == 0)
+		{
+			check(rope, model);
+		}
+	}
+	check(rope, model);
+
+	// Offsets and counts past the end are clamped
+	rope = rope.replace(model.size() + 100, 5, "end");
+	model += "end";
+	check(rope, model);
+	assert(rope.substr(model.size() - 3, 100) == "end");
+
+	rope = rope.replace(0, model.size() + 100, "");
+	assert(rope.empty());
+	assert(rope.line_count() == 1);
+}
+
+auto make_did_change(std::string_view const uri, int const version, boost::json::array changes)
+{
+	return make_notification("textDocument/didChange", boost::json::object{
+		{ "textDocument", boost::json::object{ { "uri", uri }, { "version", version } } },
+		{ "contentChanges", std::move(changes) },
+		});
+}
+
+auto make_ranged_change(unsigned const start_line, unsigned const start_character, unsigned const end_line, unsigned const end_character, std::string_view const text)
+{
+	return boost::json::object{
+		{ "range", boost::json::object{
+			{ "start", boost::json::object{ { "line", start_line }, { "character", start_character } } },
+			{ "end", boost::json::object{ { "line", end_line }, { "character", end_character } } },
+			} },
+		{ "text", text },
+		};
+}
+
+// Positions resolve by encoding, with line ends excluding their terminators and positions past the end clamped, across documents of many chunks
+auto run_document_store()
+{
+	using lsp_boot::lsp::Location;
+	using lsp_boot::lsp::notifications::DidOpenTextDocument;
+	using lsp_boot::lsp::notifications::DidChangeTextDocument;
+	using lsp_boot::PositionEncoding;
+
+	// A surrogate pair (4 bytes in UTF-8), then characters of 2 and 3 bytes in UTF-8 but a single UTF-16 code unit each
+	auto const text = std::string{ "a\xF0\x9F\x98\x80" "b\n" "\xC3\xBC\xE2\x82\xAC" "x\n" };
+	{
+		auto const snapshot = lsp_boot::DocumentSnapshot{ "file:///utf16.txt", 1, lsp_boot::TextRope{ text }, PositionEncoding::utf16 };
+		assert(snapshot.line_count() == 3);
+		assert(snapshot.offset_of(Location{ .line = 0, .character = 1 }) == 1);
+		assert(snapshot.offset_of(Location{ .line = 0, .character = 3 }) == 5);
+		assert(snapshot.offset_of(Location{ .line = 0, .character = 4 }) == 6);
+		assert(snapshot.offset_of(Location{ .line = 0, .character = 99 }) == 6);
+		assert(snapshot.offset_of(Location{ .line = 1, .character = 1 }) == 9);
+		assert(snapshot.offset_of(Location{ .line = 1, .character = 2 }) == 12);
+		assert(snapshot.offset_of(Location{ .line = 2, .character = 5 }) == text.size());
+		assert(snapshot.offset_of(Location{ .line = 5, .character = 0 }) == text.size());
+		assert(snapshot.line(1) == "\xC3\xBC\xE2\x82\xAC" "x");
+		assert(snapshot.line(5).empty());
+	}
+	{
+		auto const snapshot = lsp_boot::DocumentSnapshot{ "file:///utf8.txt", 1, lsp_boot::TextRope{ text }, PositionEncoding::utf8 };
+		assert(snapshot.offset_of(Location{ .line = 0, .character = 5 }) == 5);
+		assert(snapshot.offset_of(Location{ .line = 1, .character = 2 }) == 9);
+		assert(snapshot.offset_of(Location{ .line = 1, .character = 5 }) == 12);
+		assert(snapshot.offset_of(Location{ .line = 1, .character = 99 }) == 13);
+	}
+
+	auto store = lsp_boot::DocumentStore{};
+	auto const content = [&](std::string_view const uri) {
+		return store.snapshot(uri).value().content();
+		};
+
+	store.apply(DidOpenTextDocument{ make_did_open("file:///utf16.txt", text) });
+	store.apply(DidChangeTextDocument{ make_did_change("file:///utf16.txt", 2, {
+		make_ranged_change(0, 1, 0, 3, "e"),
+		make_ranged_change(1, 1, 1, 2, "E"),
+		}) });
+	assert(content("file:///utf16.txt") == "aeb\n\xC3\xBC" "Ex\n");
+	assert(store.version("file:///utf16.txt") == 2);
+
+	store.set_position_encoding(PositionEncoding::utf8);
+	store.apply(DidOpenTextDocument{ make_did_open("file:///utf8.txt", text) });
+	store.apply(DidChangeTextDocument{ make_did_change("file:///utf8.txt", 2, {
+		make_ranged_change(1, 2, 1, 5, "E"),
+		make_ranged_change(0, 1, 0, 5, ""),
+		}) });
+	assert(content("file:///utf8.txt") == "ab\n\xC3\xBC" "Ex\n");
+
+	// CRLF line ends, with the end of a line being before its '\r', and positions past the end of the document appending to it
+	store.apply(DidOpenTextDocument{ make_did_open("file:///crlf.txt", "one\r\ntwo\r\nthree") });
+	{
+		auto const snapshot = store.snapshot("file:///crlf.txt").value();
+		assert(snapshot.line_count() == 3);
+		assert(snapshot.line(0) == "one");
+		assert(snapshot.line(1) == "two");
+		assert(snapshot.line(2) == "three");
+		assert(snapshot.offset_of(Location{ .line = 0, .character = 99 }) == 3);
+		assert(snapshot.offset_of(Location{ .line = 1, .character = 0 }) == 5);
+	}
+	store.apply(DidChangeTextDocument{ make_insertion("file:///crlf.txt", 2, 0, 99, "!") });
+	assert(content("file:///crlf.txt") == "one!\r\ntwo\r\nthree");
+	store.apply(DidChangeTextDocument{ make_did_change("file:///crlf.txt", 3, {
+		make_ranged_change(0, 4, 1, 0, ""),
+		make_ranged_change(10, 0, 10, 0, "\r\ntail"),
+		}) });
+	assert(content("file:///crlf.txt") == "one!two\r\nthree\r\ntail");
+
+	// Full content replacement mixed with ranged changes, each applying to the content left by those preceding it
+	store.apply(DidChangeTextDocument{ make_did_change("file:///crlf.txt", 4, {
+		make_ranged_change(0, 0, 0, 0, "discarded"),
+		boost::json::object{ { "text", "fresh\ntext" } },
+		make_ranged_change(1, 0, 1, 0, "new "),
+		}) });
+	assert(content("file:///crlf.txt") == "fresh\nnew text");
+	assert(store.version("file:///crlf.txt") == 4);
+
+	// A document of several chunks, with an insertion larger than a chunk and a deletion spanning chunks
+	auto model = std::string{};
+	for (auto i = 0; i < 300; ++i)
+	{
+		model += std::format("line {:03}\n", i);
+	}
+	store.apply(DidOpenTextDocument{ make_did_open("file:///large.txt", model) });
+	auto const insertion = std::string(1500, 'x');
+	store.apply(DidChangeTextDocument{ make_did_change("file:///large.txt", 2, {
+		make_ranged_change(250, 4, 260, 4, ""),
+		make_ranged_change(100, 0, 100, 0, insertion),
+		make_ranged_change(50, 4, 150, 4, ""),
+		}) });
+	model.erase(250 * 9 + 4, 10 * 9);
+	model.insert(100 * 9, insertion);
+	model.erase(50 * 9 + 4, 100 * 9 + insertion.size());
+	assert(content("file:///large.txt") == model);
+	{
+		auto const snapshot = store.snapshot("file:///large.txt").value();
+		assert(snapshot.line_count() == 191);
+		assert(snapshot.line(50) == "line 150");
+		assert(snapshot.substr({ .start = { .line = 49, .character = 0 }, .end = { .line = 51, .character = 0 } }) == "line 049\nline 150\n");
+	}
+}
+
+#if defined(__linux__)
+// Concurrent clients of a single host, each served by its own session
+auto run_socket_sessions()
+{
+	auto const socket_path = (std::filesystem::temp_directory_path() / std::format("lsp-boot-basics-{}.sock", ::getpid())).string();
+	auto host = lsp_boot::SocketHost(socket_path, [](lsp_boot::SessionInit const& init) {
+		return std::unique_ptr< lsp_boot::Server >(new lsp_boot::Server(init.input_queue, init.output_queue, [](auto&& api) {
+			return std::make_unique< ExampleImpl >(api);
+			}, {}, {}, init.server_options));
+		}, std::cerr, { .request_workers = 2 });
+	auto host_result = std::async(std::launch::async, [&] {
+		return host.run();
+		});
+
+	auto const connect_client = [&] {
+		auto address = ::sockaddr_un{ .sun_family = AF_UNIX };
+		socket_path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+		auto const fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		assert(fd >= 0);
+		for (int attempt = 0; ::connect(fd, reinterpret_cast< ::sockaddr const* >(&address), sizeof(address)) != 0; ++attempt)
+		{
+			assert(attempt < 250);
+			std::this_thread::sleep_for(20ms);
+		}
+		return fd;
+		};
+
+	auto const send_session = [](int const fd, std::string_view const text) {
+		auto const session = format_request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } })
+			+ format_notification("textDocument/didOpen", boost::json::object{
+				{ "textDocument", boost::json::object{
+					{ "uri", "file:///example.txt" },
+					{ "languageId", "plaintext" },
+					{ "version", 1 },
+					{ "text", text },
+					} },
+				})
+			+ format_request("textDocument/hover", boost::json::object{
+				{ "textDocument", boost::json::object{ { "uri", "file:///example.txt" } } },
+				{ "position", boost::json::object{ { "line", 0 }, { "character", 0 } } },
+				})
+			+ format_request("shutdown")
+			+ format_notification("exit");
+		for (auto remaining = std::string_view{ session }; !remaining.empty(); )
+		{
+			auto const written = ::write(fd, remaining.data(), remaining.size());
+			assert(written > 0);
+			remaining.remove_prefix(std::size_t(written));
+		}
+		};
+
+	// The session ends, closing the connection, once the server exits.
+	auto const receive_all = [](int const fd) {
+		auto received = std::string{};
+		char buffer[4096];
+		while (true)
+		{
+			auto const count = ::read(fd, buffer, sizeof(buffer));
+			assert(count >= 0);
+			if (count == 0)
+			{
+				break;
+			}
+			received.append(buffer, std::size_t(count));
+		}
+		::close(fd);
+		return received;
+		};
+
+	auto const first = connect_client();
+	auto const second = connect_client();
+	send_session(first, "first client");
+	send_session(second, "second client");
+
+	// Each session has its own document store
+	assert(receive_all(second).find("\"contents\":\"second client\"") != std::string::npos);
+	assert(receive_all(first).find("\"contents\":\"first client\"") != std::string::npos);
+
+	host.stop();
+	assert(host_result.wait_for(5s) == std::future_status::ready);
+	assert(host_result.get() == 0);
+	assert(host.session_count() == 0);
+	assert(!std::filesystem::exists(socket_path));
+}
+#endif
+
+int main ()
+{
+	run_session({});
+
+	// Concurrent request execution
+	run_session({ .request_workers = 2 });
+
+	// Verbose logging, written from the background logging thread, which also serializes the message payloads
+	{
+		auto records = std::vector< std::string >{};
+		run_session({ .log_level = lsp_boot::LogLevel::trace }, [&](lsp_boot::LogOutputCallbackView callback) {
+			auto stream = std::ostringstream{};
+			callback(lsp_boot::LogOutputIter{ stream });
+			assert(!stream.str().empty());
+			records.push_back(std::move(stream).str());
+			});
+		// Server destruction flushes all records
+		assert(!records.empty());
+		assert(std::ranges::any_of(records, [](std::string const& record) {
+			return record.find("\"method\":\"initialize\"") != std::string::npos;
+			}));
+	}
+
+	// Background tasks run on a pool of workers
+	run_session({ .background_workers = 2 });
+	run_work_stealing_pool();
+	run_background_scheduler();
+
+	// Queued didChange notifications folded together, with the edits still applied in order
+	run_session({ .coalesce_document_changes = true });
+	run_coalescing_session();
+
+	// Input dispatched by priority class, with ordering relative to the document's notifications kept
+	run_session({ .prioritize_input = true });
+	run_prioritized_session();
+
+	// Requests past their deadline dropped
+	run_deadline_session();
+
+	// Cancelled requests answered as such, whether still queued or already running
+	for (auto const& options : { lsp_boot::ServerOptions{}, lsp_boot::ServerOptions{ .request_workers = 2 } })
+	{
+		run_queued_cancellation(options);
+		run_running_cancellation(options);
+	}
+
+	// Repeated hover on the unchanged document answered from the response cache
+	{
+		auto const output = run_session({ .response_cache_bytes = 64 * 1024 });
+		assert(output.find("\"response_cache\":{\"hits\":1,") != std::string::npos);
+	}
+	run_response_cache_session();
+	run_response_cache_eviction();
+
+	// Messages parsed, and results built, in pooled arenas
+	{
+		auto arena_pool = lsp_boot::MessageArenaPool{};
+		run_session({ .arena_pool = &arena_pool });
+		assert(arena_pool.arenas_created() > 0);
+	}
+
+	// Traffic recorded in both directions, and read back as framed messages
+	{
+		auto trace_stream = std::stringstream{};
+		{
+			auto trace = lsp_boot::SessionTraceWriter(trace_stream);
+			run_session({}, {}, &trace);
+		}
+		auto const records = lsp_boot::read_session_trace(trace_stream);
+		assert(records.has_value() && !records->empty());
+		assert(records->front().direction == lsp_boot::TraceDirection::input);
+		assert(records->front().framed.starts_with("Content-Length: "));
+		assert(std::ranges::any_of(*records, [](lsp_boot::TraceRecord const& record) {
+			return record.direction == lsp_boot::TraceDirection::output && record.framed.find("\"capabilities\"") != std::string::npos;
+			}));
+	}
+
+	run_impl_delta_session();
+	run_deferred_session({});
+	run_deferred_session({ .request_workers = 2 });
+	run_output_writer_fields();
+	run_text_rope();
+	run_document_store();
+	run_diagnostics_publisher();
+
+#if defined(__linux__)
+	run_socket_sessions();
+#endif
+
 	return 0;
 }
@@ -1,30 +1,260 @@
 
 module;
 
+#include <cassert>
 #include <concepts>
+#include <expected>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
 export module example_impl;
 
 import lsp_boot;
+import lsp_boot.semantic_tokens;
+import lsp_boot.ext_mod_wrap.boost.json;
 
 export class ExampleImpl
 {
 public:
-	ExampleImpl(lsp_boot::ServerImplAPI& /* api */)
+	ExampleImpl(lsp_boot::ServerImplAPI& api) : api{ api }
 	{
 	}
 
 	auto operator() (lsp_boot::lsp::requests::Initialize&& msg) -> lsp_boot::Server::RequestResult
 	{
-		return {};
+		// Stand-in for workspace indexing, reported to the client as server initiated progress, and finished on shutdown.
+		// Runs synchronously without background workers.
+		indexing = api.start_background_job("Indexing");
+		indexing.submit([](lsp_boot::BackgroundTaskContext const& context) {
+			assert(!context.is_cancelled());
+			});
+
+		return lsp_boot::Server::RequestSuccessResult{ boost::json::object{
+			{ "capabilities", boost::json::object{
+				{ "semanticTokensProvider", boost::json::object{
+					{ "legend", boost::json::object{ { "tokenTypes", boost::json::array{ "comment" } }, { "tokenModifiers", boost::json::array{} } } },
+					{ "full", true },
+					} },
+				} },
+			} };
 	}
 
 	auto operator() (lsp_boot::lsp::requests::Shutdown&& msg) -> lsp_boot::Server::RequestResult
 	{
+		indexing.finish();
 		return {};
 	}
 
+	// Responds with the content of the hovered line, as held by the server's document store.
+	auto operator() (lsp_boot::lsp::requests::Hover&& msg) -> lsp_boot::Server::RequestResult
+	{
+		auto const params = msg.typed_params();
+		auto const document = params ? api.document(params->uri) : std::nullopt;
+		if (!document)
+		{
+			return lsp_boot::Server::RequestSuccessResult{ nullptr };
+		}
+		return lsp_boot::Server::RequestSuccessResult{ boost::json::object({ { "contents", document->line(params->position.line) } }, api.json_storage()) };
+	}
+
+	// One token spanning each non-empty line. Delta requests are handled by the framework, using this full result.
+	auto operator() (lsp_boot::lsp::requests::SemanticTokensFull&& msg) -> lsp_boot::Server::RequestResult
+	{
+		auto const params = msg.typed_params();
+		auto const document = params ? api.document(params->uri) : std::nullopt;
+
+		auto tokens = std::vector< std::tuple< unsigned, unsigned, unsigned, unsigned, unsigned > >{};
+		for (unsigned line = 0; document && line < document->line_count(); ++line)
+		{
+			if (auto const length = document->line(line).size(); length > 0)
+			{
+				tokens.emplace_back(line, 0u, unsigned(length), 0u, 0u);
+			}
+		}
+
+		return lsp_boot::Server::RequestSuccessResult{
+			.json = boost::json::object{},
+			.integer_arrays = { { "data", lsp_boot::generate_semantic_token_deltas(tokens) } },
+			};
+	}
+
+	// A string symbol per non-empty line, streamed line by line when the client supplies a partial result token.
+	auto operator() (lsp_boot::lsp::requests::DocumentSymbols&& msg) -> lsp_boot::Server::RequestResult
+	{
+		auto const params = msg.typed_params();
+		auto const document = params ? api.document(params->uri) : std::nullopt;
+		auto const partial_results = api.partial_results();
+		auto const progress = api.work_done_progress();
+
+		// A fresh arena per call, if arenas are in use, so taken once for all the values making up the result and the streamed chunks.
+		auto const storage = api.json_storage();
+
+		auto const line_count = document ? document->line_count() : 0;
+		progress.begin("Collecting symbols", 0);
+		auto symbols = boost::json::array(storage);
+		for (unsigned line = 0; line < line_count; ++line)
+		{
+			auto const text = document->line(line);
+			if (text.empty())
+			{
+				continue;
+			}
+
+			auto const range = boost::json::value(lsp_boot::lsp::Range{ { line, 0 }, { line, unsigned(text.size()) } });
+			auto symbol = boost::json::object({
+				{ "name", text },
+				{ "kind", int(lsp_boot::lsp::sk_string) },
+				{ "range", range },
+				{ "selectionRange", range },
+				}, storage);
+			if (partial_results.is_active())
+			{
+				partial_results.send(boost::json::array({ std::move(symbol) }, storage));
+			}
+			else
+			{
+				symbols.push_back(std::move(symbol));
+			}
+			progress.report((line + 1) * 100 / line_count);
+		}
+
+		// Work done progress is ended by the framework, ahead of the response.
+		return lsp_boot::Server::RequestSuccessResult{ std::move(symbols) };
+	}
+
 	auto pump() -> void
 	{
 	}
+
+private:
+	lsp_boot::ServerImplAPI& api;
+	lsp_boot::BackgroundJob indexing;
+};
+
+// Handles delta requests itself, issuing its own result ids, rather than leaving them to the framework.
+export class DeltaTokensImpl
+{
+public:
+	DeltaTokensImpl(lsp_boot::ServerImplAPI&)
+	{
+	}
+
+	auto operator() (lsp_boot::lsp::requests::Initialize&& msg) -> lsp_boot::Server::RequestResult
+	{
+		return lsp_boot::Server::RequestSuccessResult{ boost::json::object{
+			{ "capabilities", boost::json::object{
+				{ "semanticTokensProvider", boost::json::object{
+					{ "legend", boost::json::object{ { "tokenTypes", boost::json::array{ "comment" } }, { "tokenModifiers", boost::json::array{} } } },
+					{ "full", boost::json::object{ { "delta", true } } },
+					} },
+				} },
+			} };
+	}
+
+	auto operator() (lsp_boot::lsp::requests::SemanticTokensFull&& msg) -> lsp_boot::Server::RequestResult
+	{
+		return lsp_boot::Server::RequestSuccessResult{ boost::json::object{
+			{ "resultId", "impl-1" },
+			{ "data", boost::json::array{ 0, 0, 5, 0, 0 } },
+			} };
+	}
+
+	auto operator() (lsp_boot::lsp::requests::SemanticTokensFullDelta&& msg) -> lsp_boot::Server::RequestResult
+	{
+		return lsp_boot::Server::RequestSuccessResult{ boost::json::object{
+			{ "resultId", "impl-2" },
+			{ "edits", boost::json::array{ boost::json::object{ { "start", 2 }, { "deleteCount", 1 }, { "data", boost::json::array{ 4 } } } } },
+			} };
+	}
+
+	auto pump() -> void
+	{
+	}
+};
+
+// Defers its hover results, completing them when the document next changes, as if they were waiting on further input.
+// Document symbols results are deferred and then abandoned.
+export class DeferredResultsImpl
+{
+public:
+	DeferredResultsImpl(lsp_boot::ServerImplAPI&)
+	{
+	}
+
+	auto operator() (lsp_boot::lsp::requests::Hover&& msg) -> lsp_boot::Server::PendingRequestResult
+	{
+		auto [result, completion] = lsp_boot::Server::defer_result();
+		auto lock = std::scoped_lock{ mtx };
+		pending_hovers.push_back(std::move(completion));
+		return std::move(result);
+	}
+
+	auto operator() (lsp_boot::lsp::requests::DocumentSymbols&& msg) -> lsp_boot::Server::PendingRequestResult
+	{
+		return lsp_boot::Server::defer_result().first;
+	}
+
+	auto operator() (lsp_boot::lsp::notifications::DidChangeTextDocument&& msg) -> lsp_boot::Server::NotificationResult
+	{
+		auto lock = std::scoped_lock{ mtx };
+		for (auto const& complete : pending_hovers)
+		{
+			complete(lsp_boot::Server::RequestSuccessResult{ boost::json::object{ { "contents", "deferred" } } });
+		}
+		pending_hovers.clear();
+		return lsp_boot::Server::NotificationSuccessResult{};
+	}
+
+	auto pump() -> void
+	{
+	}
+
+private:
+	std::mutex mtx;
+	std::vector< lsp_boot::Server::RequestCompletion > pending_hovers;
+};
+
+// Hover handling waits for the request to be cancelled, failing with RequestCancelled once it is, or with a null result if that doesn't happen
+// within a few seconds.
+export class CancellableImpl
+{
+public:
+	CancellableImpl(lsp_boot::ServerImplAPI& api) : api{ api }
+	{
+	}
+
+	auto operator() (lsp_boot::lsp::requests::Hover&& msg) -> lsp_boot::Server::RequestResult
+	{
+		hovers_started.fetch_add(1);
+		auto const token = api.cancellation_token();
+		auto const give_up = std::chrono::steady_clock::now() + std::chrono::seconds{ 5 };
+		while (!token.is_cancelled())
+		{
+			if (std::chrono::steady_clock::now() > give_up)
+			{
+				return lsp_boot::Server::RequestSuccessResult{ nullptr };
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+		}
+		return std::unexpected(lsp_boot::Server::ResponseError{
+			{ "code", lsp_boot::lsp::error_codes::request_cancelled },
+			{ "message", "Hover cancelled" },
+			});
+	}
+
+	auto pump() -> void
+	{
+	}
+
+	// Across all instances.
+	static inline auto hovers_started = std::atomic< int >{ 0 };
+
+private:
+	lsp_boot::ServerImplAPI& api;
 };
@@ -0,0 +1,109 @@
+
+// Micro-benchmark of method name dispatch: the generated DispatchTable against a linear comparison chain over the same names
+// (equivalent to the if/else chains previously used by the server).
+// Usage: driver [lookup-count]
+
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <format>
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+#undef NDEBUG
+#include <cassert>
+
+import lsp_boot.lsp;
+import lsp_boot.dispatch_table;
+
+using namespace std::string_view_literals;
+
+namespace
+{
+	using RequestTable = lsp_boot::DispatchTable< lsp_boot::lsp::Request >;
+	using NotificationTable = lsp_boot::DispatchTable< lsp_boot::lsp::Notification >;
+
+	static_assert(RequestTable::find(lsp_boot::lsp::requests::Initialize::name) == 0);
+	static_assert(RequestTable::find(lsp_boot::lsp::requests::SemanticTokensRange::name) == RequestTable::message_count - 1);
+	static_assert(NotificationTable::find(lsp_boot::lsp::notifications::DidChangeTextDocument::name).has_value());
+	static_assert(!RequestTable::find("textDocument/hove").has_value());
+	static_assert(!NotificationTable::find("$/cancelRequest").has_value());
+
+	template < typename Table >
+	auto linear_find(std::string_view const method) -> std::optional< std::size_t >
+	{
+		for (std::size_t i = 0; i < Table::message_count; ++i)
+		{
+			if (Table::name(i) == method)
+			{
+				return i;
+			}
+		}
+		return std::nullopt;
+	}
+
+	// Methods as they'd arrive off the wire (not compile time constants), weighted towards the frequent ones and including some unknowns.
+	template < typename Table >
+	auto make_workload()
+	{
+		auto methods = std::vector< std::string >{};
+		for (std::size_t i = 0; i < Table::message_count; ++i)
+		{
+			methods.emplace_back(Table::name(i));
+		}
+		methods.emplace_back(Table::name(Table::message_count - 1));
+		methods.emplace_back(Table::name(Table::message_count - 1));
+		methods.emplace_back("$/setTrace");
+		methods.emplace_back("textDocument/completion");
+		return methods;
+	}
+
+	template < typename Table, typename Find >
+	auto measure(std::vector< std::string > const& methods, std::size_t const lookup_count, Find&& find)
+	{
+		std::size_t checksum = 0;
+		auto const start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < lookup_count; ++i)
+		{
+			auto const method = std::string_view{ methods[i % methods.size()] };
+			checksum += find(method).value_or(Table::message_count);
+		}
+		std::chrono::duration< double, std::nano > const elapsed = std::chrono::steady_clock::now() - start;
+		return std::pair{ elapsed.count() / lookup_count, checksum };
+	}
+
+	template < typename Table >
+	auto run_suite(std::string_view const name, std::size_t const lookup_count)
+	{
+		auto const methods = make_workload< Table >();
+		for (auto const& method : methods)
+		{
+			assert(Table::find(method) == linear_find< Table >(method));
+		}
+
+		auto const [linear_ns, linear_sum] = measure< Table >(methods, lookup_count, linear_find< Table >);
+		auto const [table_ns, table_sum] = measure< Table >(methods, lookup_count, [](std::string_view const method) {
+			return Table::find(method);
+			});
+		assert(linear_sum == table_sum);
+
+		std::cout << std::format("{} ({} message types)", name, Table::message_count) << std::endl;
+		std::cout << std::format("  linear chain:    {:8.2f} ns/lookup", linear_ns) << std::endl;
+		std::cout << std::format("  dispatch table:  {:8.2f} ns/lookup", table_ns) << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto const lookup_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000ull;
+	assert(lookup_count > 0);
+
+	run_suite< RequestTable >("Requests", lookup_count);
+	run_suite< NotificationTable >("Notifications", lookup_count);
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+// Comparison of output paths for responses carrying large integer arrays (semantic tokens): building a boost::json::array and serializing
+// the DOM, against passing the values as an IntegerArrayField for the output writer to format directly. Also times token delta encoding,
+// sequential against parallel.
+// Usage: driver [token-count] [response-count]
+
+#include <cstddef>
+#include <utility>
+#include <cstdint>
+#include <string_view>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <span>
+#include <format>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#undef NDEBUG
+#include <cassert>
+
+import lsp_boot;
+import lsp_boot.semantic_tokens;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace
+{
+	using Token = std::tuple< std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t >;
+
+	auto generate_tokens(std::size_t const token_count)
+	{
+		auto tokens = std::vector< Token >{};
+		tokens.reserve(token_count);
+		std::uint32_t line = 0;
+		std::uint32_t column = 0;
+		for (std::size_t i = 0; i < token_count; ++i)
+		{
+			if (i % 7 == 0)
+			{
+				++line;
+				column = 4;
+			}
+			tokens.emplace_back(line, column, std::uint32_t(3 + i % 11), std::uint32_t(i % 5), std::uint32_t(i % 3));
+			column += 16;
+		}
+		return tokens;
+	}
+
+	auto make_response(std::size_t const id, boost::json::object&& result) -> boost::json::object
+	{
+		return boost::json::object{
+			{ "jsonrpc", "2.0" },
+			{ "id", id },
+			{ "result", std::move(result) },
+			};
+	}
+
+	struct BenchResult
+	{
+		std::chrono::duration< double > elapsed;
+		std::string output;
+	};
+
+	// make_message produces the i'th queued message. Timing covers message construction as well as output, as avoiding the DOM is the point.
+	auto run_bench(std::size_t const response_count, auto&& make_message) -> BenchResult
+	{
+		auto queue = lsp_boot::OutputQueue{};
+		auto shutdown = std::atomic< bool >{ false };
+		auto writer = lsp_boot::BatchedOutputWriter{};
+		auto result = BenchResult{};
+
+		auto const start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < response_count; ++i)
+		{
+			queue.push(make_message(i));
+		}
+
+		std::size_t written = 0;
+		writer.run(queue, shutdown, [&](std::span< std::string_view const > const batch) {
+			for (auto const segment : batch)
+			{
+				result.output += segment;
+			}
+			written += batch.size();
+			if (written == response_count)
+			{
+				shutdown = true;
+			}
+			});
+		result.elapsed = std::chrono::steady_clock::now() - start;
+		return result;
+	}
+
+	auto measure_encoding(std::vector< Token > const& tokens, auto&& encode)
+	{
+		auto const start = std::chrono::steady_clock::now();
+		auto data = encode(tokens);
+		std::chrono::duration< double > const elapsed = std::chrono::steady_clock::now() - start;
+		return std::pair{ elapsed, std::move(data) };
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto const token_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200'000ull;
+	auto const response_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20ull;
+	assert(response_count > 0);
+
+	auto const tokens = generate_tokens(token_count);
+
+	auto const [sequential_time, data] = measure_encoding(tokens, [](auto const& input) {
+		return lsp_boot::generate_semantic_token_deltas(input);
+		});
+	auto const [parallel_time, parallel_data] = measure_encoding(tokens, [](auto const& input) {
+		return lsp_boot::generate_semantic_token_deltas_parallel(input);
+		});
+	assert(data == parallel_data);
+
+	auto const dom_result = run_bench(response_count, [&](std::size_t const i) {
+		return lsp_boot::OutputMessage{ make_response(i, boost::json::object{
+			{ "resultId", "1" },
+			{ "data", boost::json::array(data.begin(), data.end()) },
+			}) };
+		});
+
+	auto const direct_result = run_bench(response_count, [&](std::size_t const i) {
+		return lsp_boot::OutputMessage{
+			make_response(i, boost::json::object{ { "resultId", "1" } }),
+			{ { "data", data } },
+			};
+		});
+
+	assert(dom_result.output == direct_result.output);
+
+	auto const report = [&](std::string_view const name, BenchResult const& result) {
+		auto const seconds = result.elapsed.count();
+		std::cout << std::format("{:>20}: {:8.2f} ms/response, {:8.1f} MB/s",
+			name,
+			seconds * 1000.0 / response_count,
+			result.output.size() / seconds / (1024.0 * 1024.0)) << std::endl;
+		};
+
+	std::cout << std::format("{} tokens, {} responses of {:.1f} KB", token_count, response_count, dom_result.output.size() / response_count / 1024.0) << std::endl;
+	report("boost::json::array", dom_result);
+	report("IntegerArrayField", direct_result);
+	std::cout << std::format("{:>20}: {:8.2f} ms", "encode sequential", sequential_time.count() * 1000.0) << std::endl;
+	std::cout << std::format("{:>20}: {:8.2f} ms", "encode parallel", parallel_time.count() * 1000.0) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+
+// Micro-benchmark of params decoding for frequently handled messages: typed_params against walking the JSON with throwing lookups
+// (as handlers and the document store previously did).
+// Usage: driver [iteration-count]
+
+// workaround: MSVC modules template specialization and boost::system::error_code
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <boost/json/value_to.hpp>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <format>
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+#undef NDEBUG
+#include <cassert>
+
+import lsp_boot.lsp;
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace
+{
+	namespace lsp = lsp_boot::lsp;
+
+	auto make_message(std::string_view const method, boost::json::object&& params) -> lsp::RawMessage
+	{
+		return boost::json::object{
+			{ "jsonrpc", "2.0" },
+			{ "method", method },
+			{ "params", std::move(params) },
+			};
+	}
+
+	auto make_did_change() -> lsp::notifications::DidChangeTextDocument
+	{
+		auto changes = boost::json::array{};
+		for (std::uint32_t i = 0; i < 4; ++i)
+		{
+			changes.push_back(boost::json::object{
+				{ "range", boost::json::object{
+					{ "start", boost::json::object{ { "line", i * 10 }, { "character", 4 } } },
+					{ "end", boost::json::object{ { "line", i * 10 }, { "character", 12 } } },
+					} },
+				{ "rangeLength", 8 },
+				{ "text", "replacement text\n" },
+				});
+		}
+		return make_message(lsp::notifications::DidChangeTextDocument::name, boost::json::object{
+			{ "textDocument", boost::json::object{ { "uri", "file:///bench.cpp" }, { "version", 42 } } },
+			{ "contentChanges", std::move(changes) },
+			});
+	}
+
+	auto make_hover() -> lsp::requests::Hover
+	{
+		return make_message(lsp::requests::Hover::name, boost::json::object{
+			{ "textDocument", boost::json::object{ { "uri", "file:///bench.cpp" } } },
+			{ "position", boost::json::object{ { "line", 120 }, { "character", 17 } } },
+			});
+	}
+
+	auto walk_did_change(lsp::notifications::DidChangeTextDocument const& msg) -> std::size_t
+	{
+		auto const& params = msg.params().as_object();
+		auto const& text_document = params.at(lsp::keys::text_document).as_object();
+		auto checksum = std::string_view{ text_document.at(lsp::keys::uri).as_string() }.size()
+			+ std::size_t(boost::json::value_to< std::int64_t >(text_document.at(lsp::keys::version)));
+		for (auto const& change : params.at(lsp::keys::content_changes).as_array())
+		{
+			auto const& change_obj = change.as_object();
+			checksum += std::string_view{ change_obj.at(lsp::keys::text).as_string() }.size();
+			if (auto const range_js = change_obj.if_contains(lsp::keys::range))
+			{
+				checksum += lsp::Range::from_json(*range_js).end.character;
+			}
+		}
+		return checksum;
+	}
+
+	auto typed_did_change(lsp::notifications::DidChangeTextDocument const& msg) -> std::size_t
+	{
+		auto const params = msg.typed_params();
+		auto checksum = params->uri.size() + std::size_t(params->version);
+		for (auto const& change : params->content_changes)
+		{
+			checksum += change.text.size();
+			if (change.range)
+			{
+				checksum += change.range->end.character;
+			}
+		}
+		return checksum;
+	}
+
+	auto walk_hover(lsp::requests::Hover const& msg) -> std::size_t
+	{
+		auto const& params = msg.params().as_object();
+		auto const uri = std::string_view{ params.at(lsp::keys::text_document).as_object().at(lsp::keys::uri).as_string() };
+		auto const position = lsp::Location::from_json(params.at(lsp::keys::position));
+		return uri.size() + position.line + position.character;
+	}
+
+	auto typed_hover(lsp::requests::Hover const& msg) -> std::size_t
+	{
+		auto const params = msg.typed_params();
+		return params->uri.size() + params->position.line + params->position.character;
+	}
+
+	auto measure(std::size_t const iteration_count, auto const& msg, auto&& decode)
+	{
+		std::size_t checksum = 0;
+		auto const start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < iteration_count; ++i)
+		{
+			checksum += decode(msg);
+		}
+		std::chrono::duration< double, std::nano > const elapsed = std::chrono::steady_clock::now() - start;
+		return std::pair{ elapsed.count() / iteration_count, checksum };
+	}
+
+	auto run_suite(std::string_view const name, std::size_t const iteration_count, auto const& msg, auto&& walk, auto&& typed)
+	{
+		auto const [walk_ns, walk_sum] = measure(iteration_count, msg, walk);
+		auto const [typed_ns, typed_sum] = measure(iteration_count, msg, typed);
+		assert(walk_sum == typed_sum);
+
+		std::cout << name << std::endl;
+		std::cout << std::format("  json lookups:  {:8.2f} ns/message", walk_ns) << std::endl;
+		std::cout << std::format("  typed_params:  {:8.2f} ns/message", typed_ns) << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto const iteration_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000ull;
+	assert(iteration_count > 0);
+
+	// Malformed params are reported as such, rather than throwing.
+	auto const malformed = lsp::requests::Hover{ make_message(lsp::requests::Hover::name, boost::json::object{ { "position", 1 } }) };
+	assert(!malformed.typed_params());
+
+	run_suite("textDocument/didChange", iteration_count, make_did_change(), walk_did_change, typed_did_change);
+	run_suite("textDocument/hover", iteration_count, make_hover(), walk_hover, typed_hover);
+
+	return 0;
+}
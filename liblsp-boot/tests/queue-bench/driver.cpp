@@ -0,0 +1,136 @@
+
+// Micro-benchmark of the lock-free MpscQueue against the mutex based SyncedQueue.
+// Measures throughput with one and several producers, and wake up latency of a blocked consumer.
+// Usage: driver [message-count] [latency-samples]
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#undef NDEBUG
+#include <cassert>
+
+import lsp_boot.mpsc_queue;
+import lsp_boot.synced_queue;
+import lsp_boot.utility;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	struct Payload
+	{
+		std::uint64_t sequence;
+		std::chrono::steady_clock::time_point pushed;
+	};
+
+	template < typename Queue >
+	auto measure_throughput(std::size_t const producer_count, std::size_t const message_count, bool const batched)
+	{
+		auto queue = Queue{};
+		auto const per_producer = message_count / producer_count;
+		auto const total = per_producer * producer_count;
+
+		auto const start = std::chrono::steady_clock::now();
+		{
+			auto producers = std::vector< std::thread >{};
+			for (std::size_t p = 0; p < producer_count; ++p)
+			{
+				producers.emplace_back([&] {
+					for (std::size_t i = 0; i < per_producer; ++i)
+					{
+						queue.push(Payload{ i, {} });
+					}
+					});
+			}
+
+			std::size_t received = 0;
+			auto batch = std::vector< Payload >{};
+			while (received < total)
+			{
+				if (batched)
+				{
+					batch.clear();
+					if (auto value = queue.pop_with_abort([] { return false; }); value.has_value())
+					{
+						batch.push_back(std::move(*value));
+						queue.drain(batch);
+					}
+					received += batch.size();
+				}
+				else
+				{
+					queue.pop_with_abort([] { return false; });
+					++received;
+				}
+			}
+
+			for (auto& producer : producers)
+			{
+				producer.join();
+			}
+		}
+		std::chrono::duration< double > const elapsed = std::chrono::steady_clock::now() - start;
+		return total / elapsed.count();
+	}
+
+	// Producer pushes at intervals long enough for the consumer to block each time; reports percentiles of push to pop latency.
+	template < typename Queue >
+	auto measure_wakeup_latency(std::size_t const samples)
+	{
+		auto queue = Queue{};
+		auto latencies = std::vector< std::chrono::nanoseconds >{};
+		latencies.reserve(samples);
+
+		{
+			auto consumer = lsp_boot::Thread([&] {
+				for (std::size_t i = 0; i < samples; ++i)
+				{
+					auto const value = queue.pop_with_abort([] { return false; });
+					latencies.push_back(std::chrono::steady_clock::now() - value->pushed);
+				}
+				});
+
+			for (std::size_t i = 0; i < samples; ++i)
+			{
+				std::this_thread::sleep_for(200us);
+				queue.push(Payload{ i, std::chrono::steady_clock::now() });
+			}
+		}
+
+		std::ranges::sort(latencies);
+		auto const percentile = [&](double const p) {
+			return std::chrono::duration< double, std::micro >(latencies[std::size_t(p * (latencies.size() - 1))]).count();
+			};
+		return std::format("p50 {:7.2f} us, p99 {:7.2f} us, max {:7.2f} us", percentile(0.5), percentile(0.99), percentile(1.0));
+	}
+
+	template < typename Queue >
+	auto run_suite(std::string_view const name, std::size_t const message_count, std::size_t const latency_samples)
+	{
+		std::cout << name << std::endl;
+		std::cout << std::format("  1 producer:             {:12.0f} msgs/s", measure_throughput< Queue >(1, message_count, false)) << std::endl;
+		std::cout << std::format("  1 producer (drain):     {:12.0f} msgs/s", measure_throughput< Queue >(1, message_count, true)) << std::endl;
+		std::cout << std::format("  4 producers (drain):    {:12.0f} msgs/s", measure_throughput< Queue >(4, message_count, true)) << std::endl;
+		std::cout << std::format("  wake up latency:        {}", measure_wakeup_latency< Queue >(latency_samples)) << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto const message_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000ull;
+	auto const latency_samples = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000ull;
+	assert(message_count > 0 && latency_samples > 0);
+
+	run_suite< lsp_boot::SyncedQueue< Payload > >("SyncedQueue", message_count, latency_samples);
+	run_suite< lsp_boot::MpscQueue< Payload > >("MpscQueue", message_count, latency_samples);
+
+	return 0;
+}
@@ -0,0 +1,567 @@
+
+// Replays a session trace (see SessionTraceWriter, StreamConnection::record_to) through Server with a stub implementation, reporting per-method
+// latency percentiles, throughput and allocation counts. Input messages are fed either at their originally recorded times, or as fast as possible.
+// Traces are either read from a file, or synthesized: "typing" (bursts of single character edits interleaved with the requests an editor issues
+// as the user types) or "large-open" (opening, querying and closing multi-megabyte documents).
+// Usage: driver [typing|large-open|<trace-file>] [original|max] [handler-us] [save-trace-file]
+
+// workaround: MSVC modules template specialization and boost::system::error_code
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <boost/json/value_to.hpp>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <optional>
+#include <string_view>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <map>
+#include <unordered_map>
+#include <span>
+#include <sstream>
+#include <fstream>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#undef NDEBUG
+#include <cassert>
+
+import lsp_boot;
+import lsp_boot.histogram;
+import lsp_boot.semantic_tokens;
+import lsp_boot.ext_mod_wrap.boost.json;
+import lsp_boot.utility;
+import bench_support;
+
+using namespace std::string_view_literals;
+using namespace std::chrono_literals;
+
+namespace
+{
+	namespace lsp = lsp_boot::lsp;
+
+	struct StubConfig
+	{
+		// Time spent busy in each request handler, standing in for the implementation's own work.
+		std::chrono::microseconds request_work{ 100 };
+		// Semantic tokens generated per document line.
+		std::uint32_t tokens_per_line = 4;
+	};
+
+	auto simulate_work(std::chrono::microseconds const duration)
+	{
+		auto const until = std::chrono::steady_clock::now() + duration;
+		while (std::chrono::steady_clock::now() < until)
+		{
+		}
+	}
+
+	/**
+	 * Responds to the requests of the synthetic traces with results of representative shape and size, after a configurable amount of busy work.
+	 * Document content is maintained by the server's document store.
+	 */
+	class StubImpl
+	{
+	public:
+		StubImpl(lsp_boot::ServerImplAPI& api, StubConfig const& config) : api{ api }, config{ config }
+		{
+		}
+
+		auto operator() (lsp::requests::Initialize&& msg) -> lsp_boot::Server::RequestResult
+		{
+			return lsp_boot::Server::RequestSuccessResult{ boost::json::object{
+				{ "capabilities", boost::json::object{
+					{ "hoverProvider", true },
+					{ "documentSymbolProvider", true },
+					{ "inlayHintProvider", true },
+					{ "semanticTokensProvider", boost::json::object{
+						{ "legend", boost::json::object{ { "tokenTypes", boost::json::array{ "variable" } }, { "tokenModifiers", boost::json::array{} } } },
+						{ "full", true },
+						} },
+					} },
+				} };
+		}
+
+		auto operator() (lsp::requests::Shutdown&& msg) -> lsp_boot::Server::RequestResult
+		{
+			return {};
+		}
+
+		auto operator() (lsp::requests::Hover&& msg) -> lsp_boot::Server::RequestResult
+		{
+			simulate_work(config.request_work);
+
+			auto const params = msg.typed_params();
+			auto const document = params ? api.document(params->uri) : std::nullopt;
+			if (!document || params->position.line >= document->line_count())
+			{
+				return lsp_boot::Server::RequestSuccessResult{ nullptr };
+			}
+			return lsp_boot::Server::RequestSuccessResult{ boost::json::object({ { "contents", document->line(params->position.line) } }, api.json_storage()) };
+		}
+
+		auto operator() (lsp::requests::SemanticTokensFull&& msg) -> lsp_boot::Server::RequestResult
+		{
+			simulate_work(config.request_work);
+
+			auto const params = msg.typed_params();
+			auto const document = params ? api.document(params->uri) : std::nullopt;
+			auto const line_count = document ? std::uint32_t(document->line_count()) : 0u;
+
+			auto tokens = std::vector< std::tuple< std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t > >{};
+			tokens.reserve(std::size_t(line_count) * config.tokens_per_line);
+			for (std::uint32_t line = 0; line < line_count; ++line)
+			{
+				for (std::uint32_t index = 0; index < config.tokens_per_line; ++index)
+				{
+					tokens.emplace_back(line, index * 8, 4u, 0u, 0u);
+				}
+			}
+
+			return lsp_boot::Server::RequestSuccessResult{
+				.json = boost::json::object{},
+				.integer_arrays = { { "data", lsp_boot::generate_semantic_token_deltas(tokens) } },
+				};
+		}
+
+		auto operator() (lsp::requests::InlayHint&& msg) -> lsp_boot::Server::RequestResult
+		{
+			simulate_work(config.request_work);
+			return lsp_boot::Server::RequestSuccessResult{ boost::json::array(api.json_storage()) };
+		}
+
+		auto operator() (lsp::requests::DocumentSymbols&& msg) -> lsp_boot::Server::RequestResult
+		{
+			simulate_work(config.request_work);
+			return lsp_boot::Server::RequestSuccessResult{ boost::json::array(api.json_storage()) };
+		}
+
+		auto pump() -> void
+		{
+		}
+
+	private:
+		lsp_boot::ServerImplAPI& api;
+		StubConfig config;
+	};
+
+	/**
+	 * Writes a synthetic session, the client side only, with messages spaced out as they would be by an editor.
+	 */
+	class TraceBuilder
+	{
+	public:
+		explicit TraceBuilder(lsp_boot::SessionTraceWriter& writer) : writer{ writer }
+		{
+			request("initialize", boost::json::object{ { "capabilities", boost::json::object{} } });
+			notify("initialized", boost::json::object{});
+		}
+
+		auto request(std::string_view const method, boost::json::object params) -> void
+		{
+			send(boost::json::object{
+				{ "jsonrpc", "2.0" },
+				{ "id", next_id++ },
+				{ "method", method },
+				{ "params", std::move(params) },
+				});
+		}
+
+		auto notify(std::string_view const method, boost::json::object params) -> void
+		{
+			send(boost::json::object{
+				{ "jsonrpc", "2.0" },
+				{ "method", method },
+				{ "params", std::move(params) },
+				});
+		}
+
+		auto wait(std::chrono::microseconds const duration) -> void
+		{
+			offset += duration;
+		}
+
+		auto finish() -> void
+		{
+			request("shutdown", {});
+			notify("exit", {});
+		}
+
+	private:
+		auto send(boost::json::object const& msg) -> void
+		{
+			writer.record(lsp_boot::TraceDirection::input, offset, format_message(msg));
+		}
+
+	private:
+		lsp_boot::SessionTraceWriter& writer;
+		std::chrono::microseconds offset{};
+		std::uint64_t next_id = 0;
+	};
+
+	auto text_document(std::string_view const uri) -> boost::json::object
+	{
+		return { { "uri", uri } };
+	}
+
+	auto position(std::uint32_t const line, std::uint32_t const character) -> boost::json::object
+	{
+		return { { "line", line }, { "character", character } };
+	}
+
+	auto range(std::uint32_t const start_line, std::uint32_t const end_line) -> boost::json::object
+	{
+		return { { "start", position(start_line, 0) }, { "end", position(end_line, 0) } };
+	}
+
+	auto generate_source(std::size_t const bytes) -> std::string
+	{
+		auto text = std::string{};
+		text.reserve(bytes + 64);
+		for (std::size_t line = 0; text.size() < bytes; ++line)
+		{
+			text += std::format("\tauto value_{} = compute(\"input\", {});\n", line, line % 97);
+		}
+		return text;
+	}
+
+	// Bursts of keystrokes a few tens of milliseconds apart, each followed by the inlay hints for the visible range, with semantic tokens
+	// and a hover once the user pauses.
+	auto generate_typing_trace(lsp_boot::SessionTraceWriter& writer)
+	{
+		constexpr auto uri = "file:///typing.cpp"sv;
+		constexpr std::size_t burst_count = 20;
+		constexpr std::size_t keystrokes_per_burst = 24;
+		constexpr auto keystroke_interval = 30ms;
+		constexpr auto pause = 400ms;
+
+		auto trace = TraceBuilder(writer);
+		trace.notify("textDocument/didOpen", boost::json::object{
+			{ "textDocument", boost::json::object{
+				{ "uri", uri },
+				{ "languageId", "cpp" },
+				{ "version", 0 },
+				{ "text", generate_source(64 * 1024) },
+				} },
+			});
+		trace.request("textDocument/semanticTokens/full", { { "textDocument", text_document(uri) } });
+
+		std::int64_t version = 0;
+		for (std::uint32_t burst = 0; burst < burst_count; ++burst)
+		{
+			auto const line = burst * 37 % 1000;
+			for (std::uint32_t keystroke = 0; keystroke < keystrokes_per_burst; ++keystroke)
+			{
+				trace.wait(keystroke_interval);
+				auto const at = position(line, keystroke);
+				trace.notify("textDocument/didChange", boost::json::object{
+					{ "textDocument", boost::json::object{ { "uri", uri }, { "version", ++version } } },
+					{ "contentChanges", boost::json::array{ boost::json::object{
+						{ "range", boost::json::object{ { "start", at }, { "end", at } } },
+						{ "text", std::string(1, char('a' + keystroke % 26)) },
+						} } },
+					});
+				trace.request("textDocument/inlayHint", {
+					{ "textDocument", text_document(uri) },
+					{ "range", range(line > 30 ? line - 30 : 0, line + 30) },
+					});
+			}
+
+			trace.wait(pause);
+			trace.request("textDocument/semanticTokens/full", { { "textDocument", text_document(uri) } });
+			trace.request("textDocument/hover", { { "textDocument", text_document(uri) }, { "position", position(line, 2) } });
+		}
+
+		trace.finish();
+	}
+
+	// Multi-megabyte documents opened one after another, each queried as an editor would on opening a file, and then closed.
+	auto generate_large_open_trace(lsp_boot::SessionTraceWriter& writer)
+	{
+		constexpr std::size_t document_count = 8;
+		constexpr std::size_t document_bytes = 4 * 1024 * 1024;
+		constexpr auto interval = 250ms;
+
+		auto const text = generate_source(document_bytes);
+
+		auto trace = TraceBuilder(writer);
+		for (std::size_t index = 0; index < document_count; ++index)
+		{
+			auto const uri = std::format("file:///large_{}.cpp", index);
+			trace.notify("textDocument/didOpen", boost::json::object{
+				{ "textDocument", boost::json::object{
+					{ "uri", uri },
+					{ "languageId", "cpp" },
+					{ "version", 0 },
+					{ "text", text },
+					} },
+				});
+			trace.request("textDocument/documentSymbol", { { "textDocument", text_document(uri) } });
+			trace.request("textDocument/semanticTokens/full", { { "textDocument", text_document(uri) } });
+			trace.request("textDocument/inlayHint", { { "textDocument", text_document(uri) }, { "range", range(0, 60) } });
+			trace.request("textDocument/hover", { { "textDocument", text_document(uri) }, { "position", position(10, 6) } });
+
+			trace.wait(interval);
+			trace.notify("textDocument/didClose", { { "textDocument", text_document(uri) } });
+		}
+
+		trace.finish();
+	}
+
+	/**
+	 * Decodes a recorded framed message, using a MessageReader as the fd transport would, such that parse time and size are recorded.
+	 */
+	auto decode(lsp_boot::MessageReader& reader, std::string_view framed) -> lsp_boot::ReceivedMessage
+	{
+		while (true)
+		{
+			auto const buffer = reader.prepare();
+			auto const count = std::min(buffer.size(), framed.size());
+			framed.copy(buffer.data(), count);
+			reader.commit(count);
+			framed.remove_prefix(count);
+
+			auto result = reader.next_message();
+			assert(result.has_value());
+			if (*result)
+			{
+				assert(framed.empty());
+				return std::move(**result);
+			}
+			assert(!framed.empty());
+		}
+	}
+
+	/**
+	 * Request id text (as serialized) to the method and the time at which the request was fed, for matching up responses.
+	 */
+	class PendingRequests
+	{
+	public:
+		auto add(std::string id, std::string_view const method) -> void
+		{
+			auto lock = std::lock_guard{ mtx };
+			requests.insert_or_assign(std::move(id), std::pair{ std::string{ method }, std::chrono::steady_clock::now() });
+		}
+
+		auto complete(std::string_view const id) -> std::optional< std::pair< std::string, std::chrono::steady_clock::duration > >
+		{
+			auto lock = std::lock_guard{ mtx };
+			auto const it = requests.find(std::string{ id });
+			if (it == requests.end())
+			{
+				return std::nullopt;
+			}
+			auto result = std::pair{ std::move(it->second.first), std::chrono::steady_clock::now() - it->second.second };
+			requests.erase(it);
+			return result;
+		}
+
+	private:
+		std::mutex mtx;
+		std::unordered_map< std::string, std::pair< std::string, std::chrono::steady_clock::time_point > > requests;
+	};
+
+	// Responses are written by the server with the id immediately following the jsonrpc member.
+	auto response_id(std::string_view const framed) -> std::optional< std::string_view >
+	{
+		constexpr auto prefix = "{\"jsonrpc\":\"2.0\",\"id\":"sv;
+		auto const content_start = framed.find("\r\n\r\n");
+		if (content_start == std::string_view::npos || !framed.substr(content_start + 4).starts_with(prefix))
+		{
+			return std::nullopt;
+		}
+		auto const id = framed.substr(content_start + 4 + prefix.size());
+		return id.substr(0, id.find(','));
+	}
+
+	struct ReplayResult
+	{
+		std::chrono::duration< double > elapsed;
+		std::size_t input_messages = 0;
+		std::size_t input_bytes = 0;
+		std::size_t output_messages = 0;
+		std::size_t output_bytes = 0;
+		std::uint64_t allocations = 0;
+		std::uint64_t allocated_bytes = 0;
+		// Time from a request being fed to its response being written, by method.
+		std::map< std::string, lsp_boot::Histogram > latency;
+		std::string server_metrics;
+	};
+
+	auto replay(std::span< lsp_boot::TraceRecord const > const trace, bool const original_speed, StubConfig const& config) -> ReplayResult
+	{
+		auto result = ReplayResult{};
+
+		auto input_queue = lsp_boot::PendingInputQueue{};
+		auto output_queue = lsp_boot::OutputQueue{};
+		auto pending = PendingRequests{};
+		auto responses_written = std::atomic< std::size_t >{ 0 };
+		auto requests_fed = std::size_t{ 0 };
+
+		auto server = lsp_boot::Server(input_queue, output_queue, [&](auto&& api) {
+			return std::make_unique< StubImpl >(api, config);
+			});
+
+		auto const start_allocations = allocation_count();
+		auto const start_bytes = allocated_bytes();
+		auto const start = std::chrono::steady_clock::now();
+		{
+			auto output_shutdown = std::atomic< bool >{ false };
+			auto writer = lsp_boot::BatchedOutputWriter({ .metrics = &server.metrics_registry().output() });
+			auto output_thread = lsp_boot::Thread([&] {
+				writer.run(output_queue, output_shutdown, [&](std::span< std::string_view const > const batch) {
+					for (auto const segment : batch)
+					{
+						++result.output_messages;
+						result.output_bytes += segment.size();
+						if (auto const id = response_id(segment))
+						{
+							if (auto const completed = pending.complete(*id))
+							{
+								result.latency[completed->first].record(std::uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(completed->second).count()));
+								++responses_written;
+							}
+						}
+					}
+					});
+				});
+
+			{
+				auto server_thread = lsp_boot::Thread([&] {
+					server.run();
+					});
+
+				auto reader = lsp_boot::MessageReader{};
+				for (auto const& record : trace)
+				{
+					if (record.direction != lsp_boot::TraceDirection::input)
+					{
+						continue;
+					}
+					if (original_speed)
+					{
+						std::this_thread::sleep_until(start + record.offset);
+					}
+
+					auto msg = decode(reader, record.framed);
+					++result.input_messages;
+					result.input_bytes += record.framed.size();
+					if (auto const id = msg.msg.if_contains("id"); id && msg.msg.contains("method"))
+					{
+						pending.add(boost::json::serialize(*id), std::string_view{ msg.msg.at("method").as_string() });
+						++requests_fed;
+					}
+					input_queue.push(std::move(msg));
+				}
+
+				// The server exits on the trace's exit notification, having queued all of its responses.
+			}
+
+			for (auto waited = 0ms; responses_written < requests_fed && waited < 10s; waited += 1ms)
+			{
+				std::this_thread::sleep_for(1ms);
+			}
+			assert(responses_written == requests_fed);
+
+			output_shutdown = true;
+			output_queue.notify();
+		}
+		result.elapsed = std::chrono::steady_clock::now() - start;
+		result.allocations = allocation_count() - start_allocations;
+		result.allocated_bytes = allocated_bytes() - start_bytes;
+		result.server_metrics = server.metrics_registry().format_report();
+		return result;
+	}
+
+	auto report(ReplayResult const& result)
+	{
+		constexpr auto microseconds_per_nanosecond = 1e-3;
+
+		std::cout << std::format("{} input messages ({:.1f} MB), {} output messages ({:.1f} MB) in {:.1f} ms",
+			result.input_messages, result.input_bytes / (1024.0 * 1024.0),
+			result.output_messages, result.output_bytes / (1024.0 * 1024.0),
+			result.elapsed.count() * 1000.0) << std::endl;
+		std::cout << std::format("throughput: {:.0f} messages/s, {:.1f} MB/s",
+			result.input_messages / result.elapsed.count(),
+			result.input_bytes / (1024.0 * 1024.0) / result.elapsed.count()) << std::endl;
+		std::cout << std::format("allocations: {:.1f}/message, {:.0f} bytes/message",
+			double(result.allocations) / result.input_messages,
+			double(result.allocated_bytes) / result.input_messages) << std::endl;
+
+		std::cout << "Request latency, fed to written (p50/p90/p99/max, us):" << std::endl;
+		for (auto const& [method, histogram] : result.latency)
+		{
+			std::cout << std::format("  {}: count={} {:.1f}/{:.1f}/{:.1f}/{:.1f}",
+				method,
+				histogram.count(),
+				histogram.quantile(0.5) * microseconds_per_nanosecond,
+				histogram.quantile(0.9) * microseconds_per_nanosecond,
+				histogram.quantile(0.99) * microseconds_per_nanosecond,
+				histogram.max() * microseconds_per_nanosecond) << std::endl;
+		}
+
+		std::cout << result.server_metrics << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto const source = argc > 1 ? std::string_view{ argv[1] } : "typing"sv;
+	auto const original_speed = argc > 2 && std::string_view{ argv[2] } == "original"sv;
+	auto const config = StubConfig{
+		.request_work = std::chrono::microseconds{ argc > 3 ? std::strtoll(argv[3], nullptr, 10) : 100ll },
+		};
+
+	auto trace_stream = std::stringstream{};
+	if (source == "typing"sv || source == "large-open"sv)
+	{
+		auto writer = lsp_boot::SessionTraceWriter(trace_stream);
+		if (source == "typing"sv)
+		{
+			generate_typing_trace(writer);
+		}
+		else
+		{
+			generate_large_open_trace(writer);
+		}
+
+		if (argc > 4)
+		{
+			auto file = std::ofstream(argv[4], std::ios::binary);
+			file << trace_stream.rdbuf();
+			trace_stream.seekg(0);
+		}
+	}
+	else
+	{
+		auto file = std::ifstream(std::string{ source }, std::ios::binary);
+		if (!file)
+		{
+			std::cerr << std::format("Unable to open trace file '{}'", source) << std::endl;
+			return 1;
+		}
+		trace_stream << file.rdbuf();
+	}
+
+	auto const trace = lsp_boot::read_session_trace(trace_stream);
+	if (!trace)
+	{
+		std::cerr << "Malformed session trace" << std::endl;
+		return 1;
+	}
+
+	std::cout << std::format("Replaying '{}' at {} speed, {} us per request", source, original_speed ? "original" : "maximum", config.request_work.count()) << std::endl;
+	report(replay(*trace, original_speed, config));
+
+	return 0;
+}
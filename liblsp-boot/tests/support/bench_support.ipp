@@ -0,0 +1,80 @@
+
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <format>
+#include <atomic>
+
+export module bench_support;
+
+import lsp_boot.ext_mod_wrap.boost.json;
+
+namespace
+{
+	std::atomic< std::uint64_t > allocations = 0;
+	std::atomic< std::uint64_t > allocation_bytes = 0;
+}
+
+// Counting replacements of the global allocation functions (the aligned forms are left as default, being paired among themselves).
+// Replacements must be attached to the global module, hence the linkage specification.
+extern "C++"
+{
+	auto operator new(std::size_t const size) -> void*
+	{
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+		if (auto const ptr = std::malloc(size > 0 ? size : 1))
+		{
+			return ptr;
+		}
+		throw std::bad_alloc{};
+	}
+
+	auto operator new[](std::size_t const size) -> void*
+	{
+		return operator new(size);
+	}
+
+	auto operator delete(void* const ptr) noexcept -> void
+	{
+		std::free(ptr);
+	}
+
+	auto operator delete[](void* const ptr) noexcept -> void
+	{
+		std::free(ptr);
+	}
+
+	auto operator delete(void* const ptr, std::size_t) noexcept -> void
+	{
+		std::free(ptr);
+	}
+
+	auto operator delete[](void* const ptr, std::size_t) noexcept -> void
+	{
+		std::free(ptr);
+	}
+}
+
+/**
+ * Number of calls made so far to the (non-aligned) global allocation functions, and the total bytes requested.
+ */
+export auto allocation_count() -> std::uint64_t
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+export auto allocated_bytes() -> std::uint64_t
+{
+	return allocation_bytes.load(std::memory_order_relaxed);
+}
+
+export auto format_message(boost::json::value const& js) -> std::string
+{
+	auto const content = boost::json::serialize(js);
+	return std::format("Content-Length: {}\r\n\r\n{}", content.length(), content);
+}
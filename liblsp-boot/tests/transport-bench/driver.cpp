@@ -0,0 +1,165 @@
+
+// Throughput comparison of the iostream and fd based transports' input paths.
+// Usage: driver [message-count] [large-content-bytes]
+
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include <string_view>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+#undef NDEBUG
+#include <cassert>
+
+import lsp_boot;
+import lsp_boot.ext_mod_wrap.boost.json;
+import lsp_boot.utility;
+import bench_support;
+
+using namespace std::string_view_literals;
+
+namespace
+{
+	// Mix of small requests and didChange notifications carrying large (escape heavy) document text.
+	auto generate_session(std::size_t const message_count, std::size_t const large_content_bytes)
+	{
+		auto text = std::string{};
+		text.reserve(large_content_bytes);
+		while (text.size() < large_content_bytes)
+		{
+			text += "\tauto value = compute(\"input\", 42);\n";
+		}
+
+		auto session = std::string{};
+		for (std::size_t i = 0; i < message_count; ++i)
+		{
+			if (i % 4 == 0)
+			{
+				session += format_message(boost::json::object{
+					{ "jsonrpc", "2.0" },
+					{ "method", "textDocument/didChange" },
+					{ "params", boost::json::object{
+						{ "textDocument", boost::json::object{ { "uri", "file:///bench.cpp" }, { "version", i } } },
+						{ "contentChanges", boost::json::array{ boost::json::object{ { "text", text } } } },
+						} },
+					});
+			}
+			else
+			{
+				session += format_message(boost::json::object{
+					{ "jsonrpc", "2.0" },
+					{ "id", i },
+					{ "method", "textDocument/hover" },
+					{ "params", boost::json::object{
+						{ "textDocument", boost::json::object{ { "uri", "file:///bench.cpp" } } },
+						{ "position", boost::json::object{ { "line", i % 1000 }, { "character", 4 } } },
+						} },
+					});
+			}
+		}
+		return session;
+	}
+
+	struct BenchResult
+	{
+		std::chrono::duration< double > elapsed;
+		std::size_t received;
+	};
+
+	// run_connection constructs and runs a connection to completion over the given queues.
+	auto run_bench(auto&& run_connection) -> BenchResult
+	{
+		auto input_queue = lsp_boot::PendingInputQueue{};
+		auto output_queue = lsp_boot::OutputQueue{};
+		auto error = std::ostringstream{};
+
+		auto const start = std::chrono::steady_clock::now();
+		auto const result = run_connection(input_queue, output_queue, error);
+		auto const elapsed = std::chrono::steady_clock::now() - start;
+		assert(result == 0);
+
+		std::size_t received = 0;
+		while (input_queue.try_pop())
+		{
+			++received;
+		}
+		return { elapsed, received };
+	}
+
+	auto report(std::string_view const name, BenchResult const& result, std::size_t const bytes)
+	{
+		auto const seconds = result.elapsed.count();
+		std::cout << std::format("{:>18}: {:8.1f} ms, {:10.0f} msgs/s, {:8.1f} MB/s",
+			name,
+			seconds * 1000.0,
+			result.received / seconds,
+			bytes / seconds / (1024.0 * 1024.0)) << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto const message_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000ull;
+	auto const large_content_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64ull * 1024;
+
+	auto const session = generate_session(message_count, large_content_bytes);
+
+	// Distinct per process, so that concurrent runs don't collide.
+#if defined(_WIN32)
+	auto const process_id = ::_getpid();
+#else
+	auto const process_id = ::getpid();
+#endif
+	auto const session_path = std::filesystem::temp_directory_path() / std::format("lsp-boot-transport-bench-{}.bin", process_id);
+	{
+		auto file = std::ofstream(session_path, std::ios::binary);
+		file.write(session.data(), session.size());
+	}
+
+	auto const stream_result = run_bench([&](auto& in_queue, auto& out_queue, auto& error) {
+		auto in = std::istringstream(session);
+		auto out = std::ostringstream{};
+		return lsp_boot::StreamConnection(in_queue, out_queue, in, out, error).listen();
+		});
+
+	auto const fd_result = run_bench([&](auto& in_queue, auto& out_queue, auto& error) {
+#if defined(_WIN32)
+		auto const fd = ::_open(session_path.string().c_str(), _O_RDONLY | _O_BINARY);
+#else
+		auto const fd = ::open(session_path.c_str(), O_RDONLY);
+#endif
+		assert(fd >= 0);
+		auto const result = lsp_boot::FdConnection(in_queue, out_queue, fd, -1, error).listen();
+#if defined(_WIN32)
+		::_close(fd);
+#else
+		::close(fd);
+#endif
+		return result;
+		});
+
+	std::filesystem::remove(session_path);
+
+	std::cout << std::format("{} messages, {:.1f} MB", message_count, session.size() / (1024.0 * 1024.0)) << std::endl;
+	report("StreamConnection", stream_result, session.size());
+	report("FdConnection", fd_result, session.size());
+
+	assert(stream_result.received == message_count);
+	assert(fd_result.received == message_count);
+
+	return 0;
+}